@@ -1,4 +1,4 @@
-use matcher::{Matcher, Order, Side, Symbol, SymbolMetadata};
+use matcher::{Matcher, Order, Side, Symbol, SymbolMetadata, TimeInForce};
 use orderbook::EventHandlerBuilder;
 
 fn main() {
@@ -31,6 +31,8 @@ fn main() {
                 price: 62805.05,
                 size: 0.001,
                 side: Side::Bid,
+                time_in_force: TimeInForce::Gtc,
+                post_only: false,
             },
         ),
         (
@@ -39,6 +41,8 @@ fn main() {
                 price: 62805.05,
                 size: 0.002,
                 side: Side::Ask,
+                time_in_force: TimeInForce::Gtc,
+                post_only: false,
             },
         ),
     ];
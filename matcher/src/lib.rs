@@ -3,7 +3,10 @@ use orderbook::{Orderbook, OrderbookError};
 pub mod handler;
 mod symbol_table;
 
-pub use orderbook::{ffi, EventHandlerBuilder, OrderEvent, Side, TradeEvent};
+pub use orderbook::{
+    ffi, Event, EventHandlerBuilder, LevelUpdateEvent, MassCancelEvent, OrderEvent, Side,
+    TimeInForce, TradeEvent, TriggerType,
+};
 pub use symbol_table::{Symbol, SymbolTable};
 
 #[derive(Debug, Clone, Copy)]
@@ -27,6 +30,8 @@ pub struct Order {
     pub size: f64,
     pub price: f64,
     pub side: Side,
+    pub time_in_force: TimeInForce,
+    pub post_only: bool, // limit maker, rejected rather than taking liquidity
 }
 
 impl Order {
@@ -42,6 +47,8 @@ impl Order {
             price: rng.gen_range(price_range),
             size: rng.gen_range(size_range),
             side: rng.gen(),
+            time_in_force: TimeInForce::Gtc,
+            post_only: false,
         }
     }
 }
@@ -110,7 +117,10 @@ impl Matcher {
         metadata: SymbolMetadata,
         eh: &mut ffi::event_handler,
     ) {
-        let ob = Orderbook::new()
+        // order ids come from a sequential generator, look them up directly
+        let mut config = unsafe { ffi::orderbook_config_default() };
+        config.order_index_pages = 1024;
+        let ob = Orderbook::with_config(config)
             .with_id(symbol.into())
             .with_event_handler(eh);
         self.books.insert(symbol, SymbolEntry { ob, metadata });
@@ -175,46 +185,24 @@ impl Matcher {
         } else {
             let price = scale_float(order.price, book.metadata.price_precision);
 
-            // If price is equals to current best on the other side, execute it
-            match book.ob.best(order.side.inverse()) {
-                Some(best) if best.price == price => {
-                    let remaining_size = book.ob.execute(
-                        order_id,
-                        order.side,
-                        size,
-                        std::cmp::min(best.volume, size),
-                        false,
-                    );
-
-                    // let the remaining go through as limit order
-                    if remaining_size > 0 {
-                        book.ob.limit(orderbook::ffi::order {
-                            order_id,
-                            price,
-                            size: remaining_size,
-                            cum_filled_size: size - remaining_size,
-                            side: order.side.into(),
-                            limit: std::ptr::null_mut(),
-                            prev: std::ptr::null_mut(),
-                            next: std::ptr::null_mut(),
-                            user_data: std::ptr::null_mut(),
-                        });
-                    }
-                }
-                _ => {
-                    book.ob.limit(orderbook::ffi::order {
-                        order_id,
-                        price,
-                        size,
-                        cum_filled_size: 0,
-                        side: order.side.into(),
-                        limit: std::ptr::null_mut(),
-                        prev: std::ptr::null_mut(),
-                        next: std::ptr::null_mut(),
-                        user_data: std::ptr::null_mut(),
-                    });
-                }
-            }
+            // crosses every level up to the price, then rests or cancels the remainder
+            book.ob.place(
+                orderbook::ffi::order {
+                    order_id,
+                    price,
+                    size,
+                    cum_filled_size: 0,
+                    side: order.side.into(),
+                    ring_slot: 0,
+                    limit: std::ptr::null_mut(),
+                    queue_slot: 0,
+                    prev: std::ptr::null_mut(),
+                    next: std::ptr::null_mut(),
+                    user_data: std::ptr::null_mut(),
+                },
+                order.time_in_force,
+                order.post_only,
+            );
         }
 
         Ok(())
@@ -42,7 +42,9 @@ fn process_messages(ob: &mut Orderbook, msgs: Vec<Message>) {
                         "ask" => orderbook::Side::Ask.into(),
                         _ => unreachable!(),
                     },
+                    ring_slot: 0,
                     limit: std::ptr::null_mut(),
+                    queue_slot: 0,
                     prev: std::ptr::null_mut(),
                     next: std::ptr::null_mut(),
                     user_data: std::ptr::null_mut(),
@@ -4,6 +4,7 @@
 #include "orderbook.h"
 #include "tests/orderbook_message.h"
 #include "uint64_hashmap.h"
+#include "uint64_swissmap.h"
 
 #define DATA "data/l3_orderbook_100k.ndjson"
 
@@ -88,4 +89,119 @@ UBENCH_F(uint64_hashmap_benchmark, insert_100k_entries) {
   }
 }
 
+#define MAP_BENCHMARK_KEYS 1'000'000
+
+/**
+ * Head-to-head of the order id maps with a million live orders, keys are the
+ * order ids looked up in a shuffled order.
+ */
+struct uint64_map_benchmark {
+  struct uint64_hashmap hashmap;
+  struct uint64_swissmap swissmap;
+  uint64_t* keys;
+};
+
+UBENCH_F_SETUP(uint64_map_benchmark) {
+  ubench_fixture->hashmap = uint64_hashmap_new();
+  ubench_fixture->swissmap = uint64_swissmap_new();
+  ubench_fixture->keys = malloc(sizeof(uint64_t) * MAP_BENCHMARK_KEYS);
+
+  for (uint64_t i = 0; i < MAP_BENCHMARK_KEYS; i++) {
+    ubench_fixture->keys[i] = i + 1;
+    uint64_hashmap_put(&ubench_fixture->hashmap, i + 1, ubench_fixture);
+    uint64_swissmap_put(&ubench_fixture->swissmap, i + 1, ubench_fixture);
+  }
+
+  srand(42);
+  for (int i = MAP_BENCHMARK_KEYS - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    uint64_t tmp = ubench_fixture->keys[i];
+    ubench_fixture->keys[i] = ubench_fixture->keys[j];
+    ubench_fixture->keys[j] = tmp;
+  }
+}
+
+UBENCH_F_TEARDOWN(uint64_map_benchmark) {
+  uint64_hashmap_free(&ubench_fixture->hashmap);
+  uint64_swissmap_free(&ubench_fixture->swissmap);
+  free(ubench_fixture->keys);
+}
+
+UBENCH_F(uint64_map_benchmark, hashmap_get_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++)
+    UBENCH_DO_NOTHING(
+        uint64_hashmap_get(&ubench_fixture->hashmap, ubench_fixture->keys[i]));
+}
+
+UBENCH_F(uint64_map_benchmark, swissmap_get_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++)
+    UBENCH_DO_NOTHING(uint64_swissmap_get(&ubench_fixture->swissmap,
+                                          ubench_fixture->keys[i]));
+}
+
+UBENCH_F(uint64_map_benchmark, hashmap_get_missing_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++) {
+    uint64_t key = ubench_fixture->keys[i] + MAP_BENCHMARK_KEYS;
+    UBENCH_DO_NOTHING(uint64_hashmap_get(&ubench_fixture->hashmap, key));
+  }
+}
+
+UBENCH_F(uint64_map_benchmark, swissmap_get_missing_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++) {
+    uint64_t key = ubench_fixture->keys[i] + MAP_BENCHMARK_KEYS;
+    UBENCH_DO_NOTHING(uint64_swissmap_get(&ubench_fixture->swissmap, key));
+  }
+}
+
+// cancel an order and place a new one, the map stays at a million entries
+UBENCH_F(uint64_map_benchmark, hashmap_remove_put_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++) {
+    uint64_t key = ubench_fixture->keys[i];
+    uint64_hashmap_remove(&ubench_fixture->hashmap, key);
+    uint64_hashmap_put(&ubench_fixture->hashmap, key, ubench_fixture);
+  }
+}
+
+UBENCH_F(uint64_map_benchmark, swissmap_remove_put_1m) {
+  for (int i = 0; i < MAP_BENCHMARK_KEYS; i++) {
+    uint64_t key = ubench_fixture->keys[i];
+    uint64_swissmap_remove(&ubench_fixture->swissmap, key);
+    uint64_swissmap_put(&ubench_fixture->swissmap, key, ubench_fixture);
+  }
+}
+
+UBENCH(uint64_map_benchmark, hashmap_put_1m) {
+  struct uint64_hashmap map = uint64_hashmap_new();
+  for (uint64_t key = 1; key <= MAP_BENCHMARK_KEYS; key++)
+    uint64_hashmap_put(&map, key, &map);
+  uint64_hashmap_free(&map);
+}
+
+UBENCH(uint64_map_benchmark, swissmap_put_1m) {
+  struct uint64_swissmap map = uint64_swissmap_new();
+  for (uint64_t key = 1; key <= MAP_BENCHMARK_KEYS; key++)
+    uint64_swissmap_put(&map, key, &map);
+  uint64_swissmap_free(&map);
+}
+
+#define MONOTONIC_LEVELS 10'000
+
+UBENCH(limit_tree_benchmark, monotonic_rising_10k_levels) {
+  struct orderbook orderbook = orderbook_new();
+  struct orderbook* ob = &orderbook;
+
+  // a trending market, every new bid improves on the best
+  for (int i = 1; i <= MONOTONIC_LEVELS; i++)
+    orderbook_limit(ob, (struct order){.order_id = i,
+                                       .side = SIDE_BID,
+                                       .price = i,
+                                       .size = 1});
+
+  // sweep the whole side, removing the best level each time
+  orderbook_execute(ob, MONOTONIC_LEVELS + 1, SIDE_ASK, MONOTONIC_LEVELS,
+                    MONOTONIC_LEVELS, true);
+
+  orderbook_free(ob);
+}
+
 UBENCH_MAIN();
\ No newline at end of file
@@ -94,7 +94,9 @@ fn main() {
         size: 10,
         cum_filled_size: 0,
         side: Side::Bid.into(),
+        ring_slot: 0,
         limit: null_mut(),
+        queue_slot: 0,
         prev: null_mut(),
         next: null_mut(),
         user_data: null_mut(),
@@ -0,0 +1,60 @@
+#ifndef DEPTH_PUBLISHER_H
+#define DEPTH_PUBLISHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "depth_snapshot.h"
+#include "limit.h"
+#include "limit_tree.h"
+
+#define DEPTH_PUBLISHER_NAME_MAX 255
+
+/**
+ * Keeps the `depth` best levels of a book in a shared memory segment, see
+ * `struct depth_snapshot` for the layout and `depth_reader_open()` to map it
+ * from another process.
+ *
+ * The book tells it of every level it changes with `depth_publisher_touch()`,
+ * and only the sides where a level within the published depth changed are
+ * walked again once the operation is over, in `depth_publisher_flush()`. Of
+ * those, only the levels that differ from the published ones are written.
+ */
+struct depth_publisher {
+  struct depth_snapshot* snapshot;  // the segment, mapped read-write
+  size_t size;                      // bytes mapped
+  char name[DEPTH_PUBLISHER_NAME_MAX + 1];
+  bool touched[2];  // a published level of the side changed since the flush
+};
+
+/**
+ * Creates the segment `name`, eg. "/orderbook-1", replacing any segment of
+ * that name left behind, with room for `depth` levels a side.
+ */
+struct depth_publisher depth_publisher_new(const char* name,
+                                           uint64_t book_id,
+                                           uint32_t depth);
+
+/**
+ * Marks the segment closed and unlinks it. Readers that have it mapped keep
+ * the last levels published.
+ */
+void depth_publisher_free(struct depth_publisher* publisher);
+
+/**
+ * Notes that the level at `price` on `side` changed, in O(1).
+ */
+void depth_publisher_touch(struct depth_publisher* publisher,
+                           enum side side,
+                           uint64_t price);
+
+/**
+ * Publishes the best levels of the sides touched since the last flush, or of
+ * both with `all` set.
+ */
+void depth_publisher_flush(struct depth_publisher* publisher,
+                           struct limit_tree* bid,
+                           struct limit_tree* ask,
+                           bool all);
+
+#endif
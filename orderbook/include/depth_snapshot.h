@@ -0,0 +1,80 @@
+#ifndef DEPTH_SNAPSHOT_H
+#define DEPTH_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEPTH_SNAPSHOT_MAGIC 0x3148545045444f42  // "BODEPTH1" little endian
+#define DEPTH_READER_RETRIES (1 << 20)  // an update is far shorter than this
+
+/**
+ * A price level as published, see `struct depth_snapshot`
+ */
+struct depth_level {
+  uint64_t price;
+  uint64_t volume;
+  uint64_t order_count;
+};
+
+/**
+ * The `depth` best levels of each side of a book, laid out in a POSIX shared
+ * memory segment by a `depth_publisher` for other processes to map. Nothing
+ * in it is a pointer, so it reads the same wherever it is mapped.
+ *
+ * Updates are under a seqlock like `struct top_of_book`: the publisher bumps
+ * `sequence` to an odd number, rewrites the levels and bumps it to even
+ * again, and a reader retries whenever it saw an odd sequence or the
+ * sequence moved while it was copying.
+ */
+struct depth_snapshot {
+  uint64_t magic;   // `DEPTH_SNAPSHOT_MAGIC` once the segment is set up
+  uint64_t book_id;
+  uint32_t depth;   // levels each side has room for
+  bool closed;      // the publisher is gone, nothing more will be published
+
+  _Alignas(64) uint64_t sequence;  // odd while an update is being written
+  uint32_t count[2];               // levels in use, by `enum side`
+
+  // `depth` bids, highest first, then `depth` asks, lowest first
+  _Alignas(64) struct depth_level levels[];
+};
+
+/**
+ * Bytes of a segment with room for `depth` levels a side
+ */
+size_t depth_snapshot_size(uint32_t depth);
+
+/**
+ * A segment mapped read only by a consumer
+ */
+struct depth_reader {
+  const struct depth_snapshot* snapshot;  // NULL if not open
+  size_t size;                            // bytes mapped
+};
+
+/**
+ * Maps the segment `name` published with `depth_publisher_new()`. Returns
+ * false if there is no such segment, or it is not set up yet, in which case
+ * it can be retried later.
+ */
+bool depth_reader_open(const char* name, struct depth_reader* reader);
+void depth_reader_close(struct depth_reader* reader);
+
+/**
+ * Copies the last update published to `levels`, which has room for
+ * `2 * snapshot->depth` levels and is laid out like `snapshot->levels`, the
+ * levels of each side in use to `count` and the sequence of the update, which
+ * grows by 2 with every update, to `sequence`. Does not make any system call.
+ *
+ * Returns false without a consistent copy if the publisher closed the segment
+ * halfway through an update, or no update could be read in
+ * `DEPTH_READER_RETRIES` attempts, eg. because the publisher died halfway
+ * through one. It can be retried later.
+ */
+bool depth_reader_read(const struct depth_reader* reader,
+                       struct depth_level* levels,
+                       uint32_t count[2],
+                       uint64_t* sequence);
+
+#endif
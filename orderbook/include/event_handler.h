@@ -6,7 +6,8 @@
 
 enum reject_reason {
   REJECT_REASON_NO_ERROR,  // 0 so it is the default if unspecified
-  REJECT_REASON_NO_LIQUIDITY
+  REJECT_REASON_NO_LIQUIDITY,
+  REJECT_REASON_WOULD_CROSS,  // a post only order would have taken liquidity
 };
 
 enum order_status {
@@ -16,6 +17,8 @@ enum order_status {
   ORDER_STATUS_FILLED,
   ORDER_STATUS_PARTIALLY_FILLED,
   ORDER_STATUS_PARTIALLY_FILLED_CANCELLED,
+  ORDER_STATUS_PENDING_TRIGGER,  // held back until its trigger price trades
+  ORDER_STATUS_TRIGGERED,        // released, placed right after this event
 };
 
 struct order_event {
@@ -34,6 +37,47 @@ struct trade_event {
   // TODO: seller_user_data
 };
 
+/**
+ * Summary of the orders of one side removed by a mass cancel, emitted instead
+ * of a cancelled order event per order when asked for.
+ */
+struct mass_cancel_event {
+  enum side side;
+  uint64_t order_count;  // orders cancelled
+  uint64_t size;         // total remaining size of those orders
+};
+
+/**
+ * New state of a price level changed by an operation, a market-by-price delta.
+ * A level that has been emptied is reported with a volume and count of 0.
+ */
+struct level_update_event {
+  enum side side;
+  uint64_t price;
+  uint64_t volume;       // total size resting at the level
+  uint64_t order_count;  // orders resting at the level
+};
+
+enum event_type {
+  EVENT_TYPE_ORDER,
+  EVENT_TYPE_TRADE,
+  EVENT_TYPE_MASS_CANCEL,
+  EVENT_TYPE_LEVEL_UPDATE,
+};
+
+/**
+ * Any kind of event, as handed over in a batch.
+ */
+struct event {
+  enum event_type type;
+  union {
+    struct order_event order_event;
+    struct trade_event trade_event;
+    struct mass_cancel_event mass_cancel_event;
+    struct level_update_event level_update_event;
+  };
+};
+
 struct event_handler {
   void (*handle_order_event)(uint64_t ob_id,
                              struct order_event event,
@@ -41,12 +85,46 @@ struct event_handler {
   void (*handle_trade_event)(uint64_t ob_id,
                              struct trade_event event,
                              void* user_data);
+  void (*handle_mass_cancel_event)(uint64_t ob_id,
+                                   struct mass_cancel_event event,
+                                   void* user_data);
+  void (*handle_level_update_event)(uint64_t ob_id,
+                                    struct level_update_event event,
+                                    void* user_data);
   void*
       user_data;  // a place to store extra information, useful for passing
                   // closures across FFI boundaries, idea taken from
                   // https://adventures.michaelfbryan.com/posts/rust-closures-in-ffi/
+
+  // Batch mode, used instead of the handlers above when `handle_batch` is set.
+  // Every event of an operation is appended to `batch` and they are handed
+  // over in a single call once it returns, or earlier if `batch` fills up.
+  void (*handle_batch)(uint64_t ob_id,
+                       struct event* events,
+                       uint32_t n,
+                       void* user_data);
+  struct event* batch;      // buffer provided by the caller, not empty
+  uint32_t batch_capacity;  // events that fit in `batch`
+  uint32_t batch_len;       // events appended since the last call
+
+  // Emit a `level_update_event` for each level changed by an operation, once
+  // with its state at the end and after the other events of the operation.
+  // Off by default since tracking the levels costs a little on every change.
+  bool level_updates;
 };
 
 struct event_handler event_handler_new();
 
+/**
+ * Creates an event handler in batch mode, `batch` must outlive the handler
+ * and hold at least one event.
+ */
+struct event_handler event_handler_with_batch(
+    void (*handle_batch)(uint64_t ob_id,
+                         struct event* events,
+                         uint32_t n,
+                         void* user_data),
+    struct event* batch,
+    uint32_t batch_capacity);
+
 #endif
@@ -2,15 +2,21 @@
 #define LIMIT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "object_pool.h"
+#include "order_fenwick.h"
+#include "order_ring.h"
+
 /**
  * Order side
  */
 enum side { SIDE_BID, SIDE_ASK };
 
 /**
- * Order at each limit level
+ * Order at each limit level. The fields from `limit` on are cold, they are
+ * not even allocated for the orders of a book with `compact_orders` set.
  */
 struct order {
   uint64_t order_id;
@@ -18,14 +24,25 @@ struct order {
   uint64_t size;
   uint64_t cum_filled_size;
   enum side side;
+  uint32_t ring_slot;  // position in the `ring` of the limit, if it has one
+
   struct limit* limit;  // backlink to the containing limit
+  uint32_t queue_slot;  // arrival slot in the `queue` of the limit
   void* user_data;      // extra metadata eg. user_id, etc.
 
-  // orders are organised as a linked list
+  // orders are organised as a linked list, unless the limit has a ring
   struct order* prev;
   struct order* next;
 };
 
+// bytes of an order in a book with `compact_orders` set
+#define ORDER_HOT_SIZE offsetof(struct order, limit)
+
+/**
+ * Node colour of a limit in the red-black tree
+ */
+enum limit_color { LIMIT_COLOR_BLACK, LIMIT_COLOR_RED };
+
 /**
  * Limit level identified by price
  */
@@ -36,12 +53,48 @@ struct limit {
   struct order* order_tail;  // end of the orders (newest) - last to execute
   uint64_t order_count;      // total orders in the limit
 
-  // limits are organised as a binary search tree
+  // the orders in arrival order instead of linked to each other, when the
+  // orderbook has `order_rings` set, on the same cache line as the above
+  struct order_ring ring;
+
+  // limits are organised as a red-black tree
+  struct limit* parent;
   struct limit* left;
   struct limit* right;
+  enum limit_color color;
+
+  // red-black tree limits are also threaded in price order
+  struct limit* prev;  // limit with the next lower price
+  struct limit* next;  // limit with the next higher price
+
+  // totals of the red-black subtree rooted at the limit, the limit included,
+  // only kept up to date when the tree has `aggregates` set
+  uint64_t subtree_volume;
+  uint64_t subtree_order_count;
+  uint64_t subtree_cost;  // sum of price * volume
+
+  // orders and volume by arrival slot, only kept when the orderbook has
+  // `queue_positions` set
+  struct order_fenwick queue;
 };
 
-void limit_free(struct limit* limit);
+/**
+ * Deallocates the orders queued at `limit`, they are returned to `order_pool`
+ * or to the system if it is NULL, and its `queue`. The limit itself is not
+ * deallocated.
+ */
+void limit_free(struct limit* limit, struct object_pool* order_pool);
 struct limit limit_default();
 
+/**
+ * Deallocates the `queue` and `ring` of `limit`, without its orders.
+ */
+void limit_free_queues(struct limit* limit);
+
+/**
+ * Returns the order queued after `order` at `limit`, or NULL if it is the
+ * newest, whether the limit links its orders or has a ring.
+ */
+struct order* limit_next_order(struct limit* limit, struct order* order);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef LIMIT_BPTREE_H
+#define LIMIT_BPTREE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "limit.h"
+
+#define LIMIT_BPTREE_INNER_KEYS 7
+#define LIMIT_BPTREE_LEAF_KEYS 6
+#define LIMIT_BPTREE_MAX_HEIGHT 32
+
+/**
+ * A node of the B+tree, two cache lines. The first line holds the sorted
+ * price keys which is all a search compares against, the second line holds
+ * where the search goes next (children for inner nodes, limits for leaves).
+ */
+struct limit_bptree_node {
+  uint64_t keys[LIMIT_BPTREE_INNER_KEYS];  // sorted prices
+  uint8_t count;                           // keys in use
+  bool leaf;
+
+  union {
+    // inner node, `children[i]` holds the prices in [keys[i - 1], keys[i])
+    struct limit_bptree_node* children[LIMIT_BPTREE_INNER_KEYS + 1];
+    // leaf node, `limits[i]` is the limit at `keys[i]`
+    struct {
+      struct limit* limits[LIMIT_BPTREE_LEAF_KEYS];
+      struct limit_bptree_node* prev;  // leaf with the lower prices
+      struct limit_bptree_node* next;  // leaf with the higher prices
+    };
+  };
+} __attribute__((aligned(64)));
+
+/**
+ * B+tree of limits keyed by price, leaves are linked in price order so the
+ * best limit and ordered traversal only touch the leaves.
+ *
+ * Removal does not merge underfull nodes, a node is only unlinked once it
+ * becomes empty. Books add and remove the same price region over and over, so
+ * merging would mostly be undone by the next split.
+ */
+struct limit_bptree {
+  struct limit_bptree_node* root;
+  struct limit_bptree_node* head;  // leaf with the lowest prices
+  struct limit_bptree_node* tail;  // leaf with the highest prices
+  uint64_t size;                   // total limits in the tree
+  uint32_t height;                 // levels including the leaves
+
+  // position of the last lookup, ordered traversal continues from it
+  struct limit_bptree_node* cursor;
+  uint8_t cursor_index;
+};
+
+struct limit_bptree limit_bptree_new();
+
+/**
+ * Deallocates the nodes of the tree. Note that the limits are not deallocated.
+ */
+void limit_bptree_free(struct limit_bptree* tree);
+
+/**
+ * Adds `limit` keyed by its price. Returns false if the price already exists.
+ */
+bool limit_bptree_insert(struct limit_bptree* tree, struct limit* limit);
+
+/**
+ * Removes `limit` from the tree, the limit itself is not deallocated.
+ */
+void limit_bptree_remove(struct limit_bptree* tree, struct limit* limit);
+
+struct limit* limit_bptree_min(struct limit_bptree* tree);
+struct limit* limit_bptree_max(struct limit_bptree* tree);
+
+/**
+ * Returns the limit with the lowest price > `price`, or NULL.
+ */
+struct limit* limit_bptree_higher(struct limit_bptree* tree, uint64_t price);
+
+/**
+ * Returns the limit with the highest price < `price`, or NULL.
+ */
+struct limit* limit_bptree_lower(struct limit_bptree* tree, uint64_t price);
+
+#endif
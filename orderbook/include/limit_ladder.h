@@ -0,0 +1,94 @@
+#ifndef LIMIT_LADDER_H
+#define LIMIT_LADDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "limit.h"
+
+#define LIMIT_LADDER_MIN_CAPACITY 64
+#define LIMIT_LADDER_MAX_LEVELS 6  // 64^6 slots is more than enough
+
+/**
+ * A dense price ladder, a ring of limit slots covering a window of
+ * `capacity` ticks starting at `base`. The limit for price `p` lives in slot
+ * `(p / tick) & (capacity - 1)` so the window can be moved without touching
+ * the slots.
+ *
+ * Occupied slots are tracked by a 64-ary bitmap hierarchy, level 0 has a bit
+ * per slot and each bit in level `k` says whether word `i` in level `k - 1`
+ * is non-zero. Finding the next occupied slot is a few `ctz` / `clz`.
+ */
+struct limit_ladder {
+  uint64_t tick;         // price increment between two slots
+  uint64_t base;         // lowest price covered by the window
+  uint32_t capacity;     // total slots, always a power of 2
+  uint32_t size;         // occupied slots
+  uint8_t levels;        // levels in the bitmap hierarchy
+  struct limit* slots;   // ring of limits indexed by price
+  uint64_t* bitmap[LIMIT_LADDER_MAX_LEVELS];  // occupancy bitmap hierarchy
+};
+
+struct limit_ladder limit_ladder_new(uint64_t tick, uint32_t capacity);
+void limit_ladder_free(struct limit_ladder* ladder);
+
+/**
+ * Empties the ladder keeping its slots, only the occupancy bitmaps are
+ * cleared since a slot is initialised again when it is next inserted.
+ */
+void limit_ladder_clear(struct limit_ladder* ladder);
+
+/**
+ * Returns the base of the window centered around `price`.
+ */
+uint64_t limit_ladder_base(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Move the window so that it is centered around `price`. The occupied slots
+ * that fall outside the new window must have been removed first, the others
+ * stay where they are.
+ */
+void limit_ladder_anchor(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Whether `price` falls on the tick grid within the current window.
+ */
+bool limit_ladder_contains(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Whether `limit` is one of the ladder slots (as opposed to a heap limit).
+ */
+bool limit_ladder_owns(struct limit_ladder* ladder, struct limit* limit);
+
+/**
+ * Returns the occupied limit at `price` or NULL, `price` must be contained in
+ * the window.
+ */
+struct limit* limit_ladder_get(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Marks the slot for `price` as occupied and returns it as an empty limit,
+ * `price` must be contained in the window.
+ */
+struct limit* limit_ladder_insert(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Marks the slot of `limit` as free again. Note that the orders in the limit
+ * are not deallocated.
+ */
+void limit_ladder_remove(struct limit_ladder* ladder, struct limit* limit);
+
+struct limit* limit_ladder_min(struct limit_ladder* ladder);
+struct limit* limit_ladder_max(struct limit_ladder* ladder);
+
+/**
+ * Returns the occupied limit with the lowest price > `price`, or NULL.
+ */
+struct limit* limit_ladder_higher(struct limit_ladder* ladder, uint64_t price);
+
+/**
+ * Returns the occupied limit with the highest price < `price`, or NULL.
+ */
+struct limit* limit_ladder_lower(struct limit_ladder* ladder, uint64_t price);
+
+#endif
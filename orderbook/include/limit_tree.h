@@ -2,23 +2,144 @@
 #define LIMIT_TREE_H
 
 #include "limit.h"
-#include "uint64_hashmap.h"
+#include "limit_bptree.h"
+#include "limit_ladder.h"
+#include "uint64_swissmap.h"
+
+/**
+ * Backend used to index the limits of a tree
+ */
+enum limit_tree_kind {
+  LIMIT_TREE_KIND_RB_TREE,  // red-black tree keyed by price
+  LIMIT_TREE_KIND_LADDER,   // dense ladder, red-black tree outside the window
+  LIMIT_TREE_KIND_BPTREE,   // cache-line-wide B+tree keyed by price
+};
 
 struct limit_tree {
   enum side side;      // indicate whether bid / ask
   struct limit* best;  // the best limit level (best bid / ask)
-  struct uint64_hashmap price_limit_map;  // keeping track of price levels
+  struct uint64_swissmap price_limit_map;  // keeping track of price levels
+
+  struct limit* root;     // root of the limit tree
+  struct limit* lowest;   // lowest priced limit in the red-black tree
+  struct limit* highest;  // highest priced limit in the red-black tree
+  uint64_t size;          // total limits in the tree
+
+  struct limit_ladder* ladder;  // dense ladder, only for the ladder backend
+  struct limit_bptree* bptree;  // B+tree, used instead of `root` if set
+
+  // keep the `subtree_*` totals of the red-black tree for depth queries in
+  // O(log n), only honoured by the red-black backend
+  bool aggregates;
 
-  struct limit* root;  // root of the limit tree
-  uint64_t size;       // total limits in the tree
+  // the orders have no `limit` backlink, see `ORDER_HOT_SIZE`
+  bool compact_orders;
+
+  // pools owned by the orderbook, limits and orders use malloc if NULL
+  struct object_pool* limit_pool;
+  struct object_pool* order_pool;
 };
 
 struct limit_tree limit_tree_new(enum side side);
+struct limit_tree limit_tree_new_ladder(enum side side,
+                                        uint64_t tick,
+                                        uint32_t capacity);
+struct limit_tree limit_tree_new_bptree(enum side side);
+
+/**
+ * Deallocates the tree and every limit in it, without recursing. The orders
+ * and heap limits of a tree with pools are left in them, for the owner of the
+ * pools to free whole.
+ */
 void limit_tree_free(struct limit_tree* tree);
+
+/**
+ * Deallocates what indexes the limits of the tree but none of the limits and
+ * orders, for when the pools they came from are freed whole.
+ */
+void limit_tree_free_index(struct limit_tree* tree);
+
+/**
+ * Drops every limit and order in the tree at once, leaving it empty with the
+ * same backend and pools. Cheaper than removing the limits one at a time since
+ * nothing is unlinked or rebalanced, and the price map and ladder keep their
+ * memory for the next limits. The orders are never visited, the caller
+ * releases them or resets the pool they came from. With `release` set the
+ * heap limits are handed back to their pool one at a time, for a pool shared
+ * with another tree, otherwise they are not visited either.
+ */
+void limit_tree_clear(struct limit_tree* tree, bool release);
 void limit_tree_update_best(struct limit_tree*, struct limit*);
 void limit_tree_add(struct limit_tree*, struct limit*);
+
+/**
+ * Removes and deallocates `limit`. If it is the best limit, the best moves to
+ * its neighbour in O(1) so emptying the top of the book never searches the
+ * tree.
+ */
 void limit_tree_remove(struct limit_tree*, struct limit*);
 struct limit* limit_tree_min(struct limit_tree*);
 struct limit* limit_tree_max(struct limit_tree*);
 
-#endif
\ No newline at end of file
+/**
+ * Returns the limit at `price` or NULL if there is none.
+ */
+struct limit* limit_tree_get(struct limit_tree*, uint64_t price);
+
+/**
+ * Creates an empty limit at `price` and adds it to the tree, the limit is
+ * taken from the ladder if the price falls in its window, otherwise it is
+ * allocated on the heap. A price on the tick grid within half a window of the
+ * best first slides the window over to it, moving the levels that leave the
+ * window to the heap, so that limits other than the new one may move. Returns
+ * the new limit. There must not be a limit at `price` already.
+ */
+struct limit* limit_tree_insert(struct limit_tree*, uint64_t price);
+
+/**
+ * Returns the limit with the lowest price >= `price` or NULL if there is none.
+ */
+struct limit* limit_tree_ceil(struct limit_tree*, uint64_t price);
+
+/**
+ * Adds `volume` and `order_count` to the `subtree_*` totals of `limit` and of
+ * its ancestors, after the caller changed the limit itself by as much. Only
+ * needed when the tree has `aggregates` set.
+ */
+void limit_tree_aggregate(struct limit_tree*,
+                          struct limit*,
+                          int64_t volume,
+                          int64_t order_count);
+
+/**
+ * Returns the total volume of the limits priced at `price` or better, ie. at or
+ * above it for bids and at or below it for asks.
+ */
+uint64_t limit_tree_volume_to(struct limit_tree*, uint64_t price);
+
+/**
+ * How much of a size the tree can fill, walking from the best limit.
+ */
+struct limit_tree_fill {
+  uint64_t size;         // less than asked for if the tree runs out
+  uint64_t worst_price;  // price of the last limit needed, 0 if none
+  uint64_t cost;         // sum of price * size filled, wraps on overflow
+};
+
+/**
+ * Returns what it takes to fill `size` from the best limit onwards.
+ */
+struct limit_tree_fill limit_tree_cost_to_fill(struct limit_tree*,
+                                               uint64_t size);
+
+/**
+ * Returns the limit with the next higher price or NULL if it is the highest.
+ */
+struct limit* limit_tree_next(struct limit_tree*, struct limit*);
+
+/**
+ * Returns the limit with the next lower price or NULL if it is the lowest.
+ */
+struct limit* limit_tree_prev(struct limit_tree*, struct limit*);
+
+#endif
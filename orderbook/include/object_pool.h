@@ -0,0 +1,82 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A block of objects carved out by the pool
+ */
+struct object_pool_slab {
+  struct object_pool_slab* next;  // slab allocated before this one
+  uint64_t capacity;              // objects in the slab
+  bool borrowed;                  // memory the pool does not own or free
+  _Alignas(max_align_t) unsigned char objects[];
+};
+
+/**
+ * Free-list pool of fixed size objects. Objects are carved out of slabs which
+ * are only returned to the system by `object_pool_free()`, so once the pool
+ * has grown to the working set, allocating and releasing is a pointer swap.
+ */
+struct object_pool {
+  size_t object_size;  // bytes per object, rounded up for alignment
+  void* free_list;     // released objects, linked through their first word
+
+  struct object_pool_slab* slabs;  // newest slab first
+  unsigned char* fresh;            // next never used object in the newest slab
+  unsigned char* fresh_end;        // end of the newest slab
+  struct object_pool_slab* spare;  // slabs emptied by a reset, not yet reused
+
+  uint64_t capacity;          // objects in all slabs, the peak in use
+  uint64_t in_use;            // objects handed out and not yet released
+  uint64_t allocations;       // total calls to `object_pool_alloc()`
+  uint64_t slab_allocations;  // slabs allocated, ie. calls to `malloc()`
+};
+
+/**
+ * Creates a pool of objects of `object_size` bytes with room for
+ * `initial_capacity` objects up front. The pool grows by doubling once they
+ * are all in use.
+ */
+struct object_pool object_pool_new(size_t object_size,
+                                   uint64_t initial_capacity);
+
+/**
+ * Returns the bytes a slab of `capacity` objects of `object_size` bytes
+ * takes, see `object_pool_adopt()`.
+ */
+size_t object_pool_slab_size(size_t object_size, uint64_t capacity);
+
+/**
+ * Carve the next objects out of `memory` instead of a slab of its own, eg.
+ * memory reserved up front on huge pages. It must be aligned to `max_align_t`
+ * and is never freed by the pool, so it has to outlive it. Whatever is left
+ * of the current slab is skipped until `object_pool_reset()`, so this is
+ * meant for a pool created with no initial capacity.
+ */
+void object_pool_adopt(struct object_pool* pool, void* memory, size_t bytes);
+
+/**
+ * Deallocates every slab, including objects that are still in use.
+ */
+void object_pool_free(struct object_pool* pool);
+
+/**
+ * Releases every object at once without touching them, they must no longer be
+ * in use. New objects are carved from the slabs again, newest first.
+ */
+void object_pool_reset(struct object_pool* pool);
+
+/**
+ * Returns an uninitialised object from the pool.
+ */
+void* object_pool_alloc(struct object_pool* pool);
+
+/**
+ * Returns `object` to the pool, it must have come from `object_pool_alloc()`.
+ */
+void object_pool_release(struct object_pool* pool, void* object);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ORDER_FENWICK_H
+#define ORDER_FENWICK_H
+
+#include <stdint.h>
+
+/**
+ * Totals of a range of slots
+ */
+struct order_fenwick_sum {
+  uint64_t volume;
+  uint64_t count;
+};
+
+/**
+ * A Fenwick tree over the arrival slots of the orders queued at a limit. Each
+ * order takes the next slot when it joins the queue and keeps it while it
+ * rests, so the totals of the slots before it are the orders and volume
+ * ahead of it. Both adding to a slot and summing up a prefix are O(log n).
+ *
+ * Slots are only handed out at the back, the ones freed at the front by fills
+ * and cancels are reclaimed by `order_fenwick_reset()` once all of them are
+ * used up, which is up to the owner of the queue since it has to hand out the
+ * slots again to the orders still resting.
+ */
+struct order_fenwick {
+  struct order_fenwick_sum* nodes;  // partial sums, indexed from 1
+  uint32_t capacity;                // slots, a power of 2 or 0 before use
+  uint32_t len;                     // slots handed out so far
+};
+
+void order_fenwick_free(struct order_fenwick* fenwick);
+
+/**
+ * Empties the tree and resizes it to `capacity` slots, rounded up to a power
+ * of 2.
+ */
+void order_fenwick_reset(struct order_fenwick* fenwick, uint32_t capacity);
+
+/**
+ * Hands out the next slot to an order of `volume`, there must be one left.
+ */
+uint32_t order_fenwick_push(struct order_fenwick* fenwick, uint64_t volume);
+
+/**
+ * Adds `volume` and `count` to the totals of `slot`.
+ */
+void order_fenwick_add(struct order_fenwick* fenwick,
+                       uint32_t slot,
+                       int64_t volume,
+                       int64_t count);
+
+/**
+ * Returns the totals of the slots before `slot`.
+ */
+struct order_fenwick_sum order_fenwick_prefix(struct order_fenwick* fenwick,
+                                              uint32_t slot);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "limit.h"
+
+#define ORDER_INDEX_PAGE_BITS 10
+#define ORDER_INDEX_PAGE_SIZE (1 << ORDER_INDEX_PAGE_BITS)  // ids per page
+
+struct order_index_page {
+  uint32_t count;  // orders in the page
+  struct order* orders[ORDER_INDEX_PAGE_SIZE];
+};
+
+/**
+ * A direct-mapped index for dense, mostly increasing order ids, such as the
+ * ones handed out by a sequential id generator. A window of `capacity` pages
+ * covers the ids from page `base` onwards and order `id` lives in
+ * `pages[(id >> ORDER_INDEX_PAGE_BITS) & (capacity - 1)]` at offset
+ * `id & (ORDER_INDEX_PAGE_SIZE - 1)`, so a lookup is two loads and no hashing.
+ *
+ * The window only moves forward. An id past its end slides it over the pages
+ * at the front that have emptied out, and each of those is reused as is for
+ * the page that takes its place in the ring. An id that cannot be placed,
+ * behind the window or ahead of it while a resting order pins the front page,
+ * is left for the caller to index elsewhere.
+ */
+struct order_index {
+  uint64_t base;                    // first page covered by the window
+  uint32_t capacity;                // pages in the window, a power of 2
+  uint64_t size;                    // orders in the index
+  struct order_index_page** pages;  // ring of pages, allocated on first use
+};
+
+struct order_index order_index_new(uint32_t capacity);
+void order_index_free(struct order_index* index);
+
+/**
+ * Unindexes every order, the pages are kept and the window stays where it is.
+ */
+void order_index_clear(struct order_index* index);
+
+/**
+ * Index `order` by `order_id`, returns false if the id falls outside of the
+ * window and it could not be moved to cover it.
+ */
+bool order_index_put(struct order_index* index,
+                     uint64_t order_id,
+                     struct order* order);
+
+/**
+ * Returns the order indexed by `order_id`, or NULL.
+ */
+struct order* order_index_get(struct order_index* index, uint64_t order_id);
+
+/**
+ * Returns and unindexes the order indexed by `order_id`, or NULL.
+ */
+struct order* order_index_remove(struct order_index* index, uint64_t order_id);
+
+/**
+ * Brings the entry for `order_id` in cache, returns false if it is outside of
+ * the window.
+ */
+bool order_index_prefetch(struct order_index* index, uint64_t order_id);
+
+#endif
@@ -1,10 +0,0 @@
-#ifndef ORDER_METADATA_H
-#define ORDER_METADATA_H
-
-#include "limit.h"
-
-struct order_metadata {
-  struct order* order;
-};
-
-#endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef ORDER_RING_H
+#define ORDER_RING_H
+
+#include <stdint.h>
+
+struct order;
+
+#define ORDER_RING_PREFETCH 4  // slots ahead of the head brought in cache
+
+/**
+ * A growable ring of the orders queued at a limit, oldest first, used instead
+ * of linking the orders to each other. Walking the queue reads consecutive
+ * slots rather than following a pointer stored in each order, so the orders
+ * coming up are known, and can be prefetched, before they are reached.
+ *
+ * Each order keeps its position in `ring_slot`. Positions only ever increase
+ * and the slot of a position is `position & (capacity - 1)`. An order that
+ * leaves from the middle of the queue leaves a tombstone (NULL) in its slot,
+ * the head and the tail move past tombstones right away. Once the ring is
+ * full it is compacted in place, or doubled if at least half of it is still
+ * in use, which updates the positions of the orders moved. An order itself
+ * never moves, so pointers to it stay valid.
+ */
+struct order_ring {
+  struct order** slots;  // tombstones and slots past `tail` are NULL or stale
+  uint32_t capacity;     // a power of 2
+  uint32_t head;         // position of the oldest order
+  uint32_t tail;         // position the next order takes
+  uint32_t size;         // orders in the ring
+};
+
+struct order_ring order_ring_new();
+void order_ring_free(struct order_ring* ring);
+
+/**
+ * Appends `order` to the back of the queue.
+ */
+void order_ring_push(struct order_ring* ring, struct order* order);
+
+/**
+ * Takes `order` out of the queue, wherever it is.
+ */
+void order_ring_remove(struct order_ring* ring, struct order* order);
+
+/**
+ * Returns the oldest order, or NULL if the ring is empty.
+ */
+struct order* order_ring_first(struct order_ring* ring);
+
+/**
+ * Returns the newest order, or NULL if the ring is empty.
+ */
+struct order* order_ring_last(struct order_ring* ring);
+
+/**
+ * Returns the order queued after `order`, or NULL if it is the newest.
+ */
+struct order* order_ring_next(struct order_ring* ring, struct order* order);
+
+/**
+ * Brings the order `ORDER_RING_PREFETCH` slots after `position` in cache, it
+ * may be a tombstone or past the tail in which case nothing is fetched.
+ */
+static inline void order_ring_prefetch(const struct order_ring* ring,
+                                       uint32_t position) {
+  __builtin_prefetch(
+      ring->slots[(position + ORDER_RING_PREFETCH) & (ring->capacity - 1)]);
+}
+
+#endif
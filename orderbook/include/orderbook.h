@@ -4,10 +4,17 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "depth_publisher.h"
 #include "event_handler.h"
 #include "limit.h"
 #include "limit_tree.h"
-#include "uint64_hashmap.h"
+#include "object_pool.h"
+#include "order_index.h"
+#include "orderbook_fork.h"
+#include "page_reservation.h"
+#include "top_of_book.h"
+#include "trigger_book.h"
+#include "uint64_swissmap.h"
 
 enum orderbook_error {
   OBERR_OKAY = 0,                 // Successful
@@ -15,12 +22,72 @@ enum orderbook_error {
   OBERR_INVALID_ORDER_SIZE = -2,  // Order size <= 0
 };
 
+enum time_in_force {
+  TIME_IN_FORCE_GTC,  // rest whatever is not filled right away
+  TIME_IN_FORCE_IOC,  // cancel whatever is not filled right away
+  TIME_IN_FORCE_FOK,  // fill entirely right away or reject
+};
+
+struct orderbook_config {
+  enum limit_tree_kind limit_tree_kind;  // backend used for both sides
+  uint64_t ladder_tick;                  // price increment between slots
+  uint32_t ladder_capacity;              // slots per side, a power of 2
+  uint32_t order_pool_capacity;          // orders allocated up front
+  uint32_t limit_pool_capacity;          // limits allocated up front
+  bool incremental_rehash;               // spread map resizes over calls
+  uint32_t order_index_pages;            // direct-mapped id pages, 0 for none
+  bool depth_aggregates;                 // O(log n) depth, red-black tree only
+  bool queue_positions;                  // O(log n) queue positions
+  bool order_rings;                      // queue orders in rings, not lists
+  bool compact_orders;                   // pool only `ORDER_HOT_SIZE` bytes
+  uint32_t order_map_capacity;           // ids the order map holds up front
+  uint32_t level_map_capacity;           // prices each side holds up front
+  bool huge_pages;                       // map the above up front, pre-faulted
+  bool lock_memory;                      // and `mlock` it, with `huge_pages`
+};
+
 struct orderbook {
   uint64_t id;  // id for this orderbook, helpful when there are many orderbooks
   struct limit_tree* bid;
   struct limit_tree* ask;
-  struct uint64_hashmap order_metadata_map;
+  struct uint64_swissmap order_map;  // order id to the order in the book
+
+  // sequential order ids are looked up directly in here, when configured, and
+  // only those outside of its window go in `order_map`
+  struct order_index* order_index;
   struct event_handler* handler;
+
+  // levels changed by the current operation, when the handler wants updates
+  uint64_t* level_updates;  // side and price of each, in the order changed
+  uint32_t level_updates_len, level_updates_capacity;
+  struct uint64_swissmap level_update_set;  // the same, to only add each once
+
+  // stop and take profit orders waiting for the last price to reach them
+  struct trigger_book* triggers;
+  uint64_t last_price;  // price of the last trade, 0 before the first one
+
+  // the best bid and ask as of the end of the last operation, for other
+  // threads to read with `top_of_book_read()`. It is allocated on its own so
+  // that it stays put when the book is moved.
+  struct top_of_book* top_of_book;
+  struct depth_publisher* depth_publisher;  // shared memory depth, if set
+
+  // keep a Fenwick tree of each level's queue, see `orderbook_queue_position()`
+  bool queue_positions;
+  bool order_rings;  // queue the orders of each level in an `order_ring`
+
+  // only the hot fields of the orders are allocated, and the cold ones they
+  // need are looked up instead, see `ORDER_HOT_SIZE`
+  bool compact_orders;
+  struct uint64_swissmap user_data_map;  // order id to its `user_data`, if set
+
+  // orders and heap limits of both sides are recycled through these pools
+  struct object_pool* order_pool;
+  struct object_pool* limit_pool;
+
+  // where the pools and maps were first carved out of, with `huge_pages` set
+  // the pages it ended up on are reported in `reservation.kind`
+  struct page_reservation reservation;
 };
 
 /**
@@ -29,6 +96,61 @@ struct orderbook {
  */
 struct orderbook orderbook_new();
 
+/**
+ * Returns the configuration used by `orderbook_new()`, a red-black tree on
+ * both sides with pools for 4096 orders and 1024 limits.
+ */
+struct orderbook_config orderbook_config_default();
+
+/**
+ * Returns the default configuration with the pools and maps sized for
+ * `expected_orders` resting orders over `expected_levels` levels per side, so
+ * that neither grows until the book gets deeper than that. With `huge_pages`
+ * set as well, all of them are mapped and faulted in up front:
+ *
+ ```
+ struct orderbook_config config = orderbook_config_sized(1 << 20, 4096);
+ config.huge_pages = true;
+ struct orderbook ob = orderbook_new_with_config(config);
+ if (ob.reservation.kind == PAGE_KIND_NORMAL)
+   fprintf(stderr, "no huge pages, %zu bytes on normal pages\n",
+           ob.reservation.size);
+ ```
+ *
+ * Huge pages are taken from the ones reserved in the system first, see
+ * `/proc/sys/vm/nr_hugepages`, then transparent huge pages, then normal pages.
+ * `lock_memory` also keeps them from being swapped out, within
+ * `RLIMIT_MEMLOCK`, and `reservation.locked` reports whether it did.
+ */
+struct orderbook_config orderbook_config_sized(uint32_t expected_orders,
+                                               uint32_t expected_levels);
+
+/**
+ * Returns the bytes mapped up front for a book created with `config` and
+ * `huge_pages` set, before rounding up to whole huge pages.
+ */
+size_t orderbook_reserved_size(struct orderbook_config config);
+
+/**
+ * Creates a new orderbook with the given configuration. For example, to index
+ * the 4096 ticks around the market with a dense ladder:
+ *
+ ```
+ struct orderbook_config config = orderbook_config_default();
+ config.limit_tree_kind = LIMIT_TREE_KIND_LADDER;
+ config.ladder_tick = 1;
+ config.ladder_capacity = 4096;
+ struct orderbook ob = orderbook_new_with_config(config);
+ ```
+ *
+ * `compact_orders` pools 40 bytes an order instead of the whole struct, about
+ * 1.4x the orders per MB of full orders, 1.6x with `order_index_pages` set on
+ * both. In exchange it turns `order_rings` on and `queue_positions` off, and
+ * cancels and amends look the level of an order up by price, as the order has
+ * no link to it.
+ */
+struct orderbook orderbook_new_with_config(struct orderbook_config config);
+
 /**
  * Set an event handler to handle orderbook events such as partial fills, etc.
  */
@@ -36,7 +158,25 @@ void orderbook_set_event_handler(struct orderbook* ob,
                                  struct event_handler* handler);
 
 /**
- * Deallocates memory used by the given book.
+ * Keep the best levels of the book in the shared memory segment of
+ * `publisher` from now on, or stop with NULL. The levels are published right
+ * away, then at the end of every operation that changed a level within the
+ * depth of the segment. The publisher stays the caller's to free.
+ *
+ * For example, to publish the top 20 levels for other processes to read with
+ * `depth_reader_open()`:
+ *
+ ```
+ struct depth_publisher publisher = depth_publisher_new("/ob-1", ob.id, 20);
+ orderbook_set_depth_publisher(&ob, &publisher);
+ ```
+ */
+void orderbook_set_depth_publisher(struct orderbook* ob,
+                                   struct depth_publisher* publisher);
+
+/**
+ * Deallocates memory used by the given book. The orders and limits are handed
+ * back with the slabs of the pools they came from, without visiting them.
  */
 void orderbook_free(struct orderbook* ob);
 
@@ -60,7 +200,42 @@ uint64_t orderbook_execute(struct orderbook* ob,
                            bool is_market);
 
 /**
- * Cancel a limit order.
+ * Place a limit order in a single pass. It is matched against every level of
+ * the other side that crosses its price, and whatever is left then rests in
+ * the book (GTC) or is cancelled (IOC). A FOK order is rejected with
+ * `REJECT_REASON_NO_LIQUIDITY` unless it can be filled entirely, and a
+ * `post_only` (limit maker) order is rejected with `REJECT_REASON_WOULD_CROSS`
+ * if it would take any liquidity, either way before anything is matched.
+ *
+ * Returns the size that has not been filled, including the part left to rest.
+ */
+uint64_t orderbook_place(struct orderbook* ob,
+                         struct order order,
+                         enum time_in_force time_in_force,
+                         bool post_only);
+
+/**
+ * Place a stop or take profit order. It is held back in the trigger book with
+ * an `ORDER_STATUS_PENDING_TRIGGER` event until a trade at or beyond
+ * `trigger_price`, then emits `ORDER_STATUS_TRIGGERED` and is placed as a
+ * market order or, for the limit types, as a GTC limit order at `order.price`.
+ *
+ * A stop buy and a take profit sell trigger once the last price rises to
+ * `trigger_price`, a stop sell and a take profit buy once it falls to it. A
+ * trigger already crossed by the last price is placed right away.
+ *
+ * Triggers are activated at the end of `orderbook_execute()` and
+ * `orderbook_place()`, one at a time in the order the price went past them,
+ * and the trades of each can activate more. The whole cascade runs in the
+ * same call.
+ */
+void orderbook_place_trigger(struct orderbook* ob,
+                             struct order order,
+                             enum trigger_type type,
+                             uint64_t trigger_price);
+
+/**
+ * Cancel a limit order, or a stop / take profit order that is still pending.
  *
  * `OBERR_OKAY` - successful operation.
  * `OBERR_ORDER_NOT_FOUND` - order id does not exist.
@@ -68,6 +243,64 @@ uint64_t orderbook_execute(struct orderbook* ob,
 enum orderbook_error orderbook_cancel(struct orderbook* ob,
                                       const uint64_t order_id);
 
+/**
+ * Cancel every order in the book. Each level is dropped with all of its orders
+ * at once instead of cancelling them one by one, and a cancelled order event
+ * is still emitted per order, best price first, unless `summarise` is set in
+ * which case a single `mass_cancel_event` is emitted per side instead.
+ *
+ * Cancelling the whole book also resets the id index and the pools wholesale,
+ * so with `summarise` set the orders are not visited at all.
+ *
+ * Pending stop and take profit orders are cancelled too, after the resting
+ * orders of their side and in the same summary, so none of them can fire
+ * into the emptied book later on.
+ *
+ * Returns the number of orders cancelled.
+ */
+uint64_t orderbook_cancel_all(struct orderbook* ob, bool summarise);
+
+/**
+ * Empties the book for reuse, eg. by the next run of a simulation, as if it
+ * had just been created with the same configuration and event handler. No
+ * event is emitted and the pending triggers are dropped too.
+ *
+ * The orders and limits are not visited, the pools, maps and index keep their
+ * memory so that refilling the book to the same depth allocates nothing. Only
+ * with `order_rings` or `queue_positions` set are the levels walked, to
+ * deallocate their queues.
+ */
+void orderbook_reset(struct orderbook* ob);
+
+/**
+ * Cancel every order on one side of the book, pending triggers included, see
+ * `orderbook_cancel_all()`.
+ */
+uint64_t orderbook_cancel_side(struct orderbook* ob,
+                               enum side side,
+                               bool summarise);
+
+/**
+ * Cancel the orders on one side priced from `min_price` to `max_price`, both
+ * inclusive, see `orderbook_cancel_all()`. The events come lowest price first.
+ * Pending triggers have no place in the book and are not covered.
+ */
+uint64_t orderbook_cancel_range(struct orderbook* ob,
+                                enum side side,
+                                uint64_t min_price,
+                                uint64_t max_price,
+                                bool summarise);
+
+/**
+ * Cancel the orders whose `user_data` is `user_data`, eg. every order of a
+ * user that disconnected, see `orderbook_cancel_all()`. There is no index by
+ * owner so every resting order is visited, but only the matching ones are
+ * taken out of their levels. Pending triggers of the owner are cancelled too.
+ */
+uint64_t orderbook_cancel_owner(struct orderbook* ob,
+                                void* user_data,
+                                bool summarise);
+
 /**
  * Amend a limit order.
  *
@@ -79,6 +312,44 @@ enum orderbook_error orderbook_amend_size(struct orderbook* ob,
                                           const uint64_t order_id,
                                           uint64_t size);
 
+enum ob_command_type {
+  OB_COMMAND_LIMIT,       // `orderbook_limit()`
+  OB_COMMAND_MARKET,      // `orderbook_execute()` for a market order
+  OB_COMMAND_PLACE,       // `orderbook_place()`
+  OB_COMMAND_CANCEL,      // `orderbook_cancel()`
+  OB_COMMAND_AMEND_SIZE,  // `orderbook_amend_size()`
+};
+
+/**
+ * A single operation in a batch, the fields it does not take are ignored.
+ */
+struct ob_command {
+  enum ob_command_type type;
+  enum side side;
+  uint64_t order_id;
+  uint64_t price;
+  uint64_t size;
+  enum time_in_force time_in_force;  // place only
+  bool post_only;                    // place only
+};
+
+struct ob_result {
+  enum orderbook_error error;  // cancel and amend, `OBERR_OKAY` otherwise
+  uint64_t remaining_size;     // market and place, the size not filled
+};
+
+/**
+ * Process `n` commands in order, exactly as if each had been called on its
+ * own, and write the result of `commands[i]` to `results[i]` unless `results`
+ * is NULL. The index entries and orders of the cancels and amends coming up
+ * are prefetched a few commands ahead, so that they are in cache by the time
+ * they are processed.
+ */
+void orderbook_process_batch(struct orderbook* ob,
+                             const struct ob_command* commands,
+                             size_t n,
+                             struct ob_result* results);
+
 /**
  * Read the top N bids or asks from the book. Note that the limits will be
  * written to the buffer provided, it is the caller's responsibility to make
@@ -97,6 +368,73 @@ uint32_t orderbook_top_n(struct orderbook* ob,
                          const uint32_t n,
                          struct limit* buffer);
 
+/**
+ * Returns the volume an order on `side` priced at `price` could take right
+ * away, ie. the total of the other side's levels that cross `price`.
+ *
+ * With `depth_aggregates` set on a red-black book this is summed up from the
+ * tree in O(log n), otherwise the crossing levels are walked one by one.
+ */
+uint64_t orderbook_volume_to_price(struct orderbook* ob,
+                                   enum side side,
+                                   uint64_t price);
+
+/**
+ * Returns what it would take a market order on `side` to fill `size`, without
+ * matching anything: the size the other side can fill, the worst price it
+ * reaches and the total cost, so that the average price is `cost / size`.
+ * See `orderbook_volume_to_price()` for when this is O(log n).
+ */
+struct limit_tree_fill orderbook_cost_to_fill(struct orderbook* ob,
+                                              enum side side,
+                                              uint64_t size);
+
+/**
+ * Returns a copy of the `depth` best levels on each side of the book, or of
+ * every level if `depth` is 0, to simulate executions against without
+ * touching the book. Only the price and volume of the levels are copied, so
+ * this is O(depth) and the orders are never visited. The copy is made on the
+ * calling thread, so a full fork with `depth` 0 holds up the matching for
+ * O(levels) on a deep book, prefer the depth the simulations can reach.
+ *
+ * The fork can be handed to another thread while the book keeps matching, and
+ * cloned there with `orderbook_fork_clone()` to try several executions from
+ * the same point. Free it with `orderbook_fork_free()`.
+ *
+ * For example, to see where a market buy for 1000 would leave the asks:
+ *
+ ```
+ struct orderbook_fork fork = orderbook_fork(&ob, 64);
+ orderbook_fork_execute(&fork, SIDE_BID, 1000);
+ orderbook_fork_top_n(&fork, SIDE_ASK, 5, asks);
+ orderbook_fork_free(&fork);
+ ```
+ */
+struct orderbook_fork orderbook_fork(struct orderbook* ob, uint32_t depth);
+
+/**
+ * Where a resting order stands in the queue of its level
+ */
+struct queue_position {
+  uint64_t orders_ahead;  // orders at the same price that will fill first
+  uint64_t volume_ahead;  // their remaining size
+};
+
+/**
+ * Write how much is queued ahead of a resting order to `position`.
+ *
+ * With `queue_positions` set each level keeps a Fenwick tree over the arrival
+ * of its orders and this is O(log n), at the cost of an O(log n) update on
+ * every append, fill, amend and cancel. Otherwise the queue is walked from
+ * the front.
+ *
+ * `OBERR_OKAY` - successful operation.
+ * `OBERR_ORDER_NOT_FOUND` - order id does not exist or is not resting.
+ */
+enum orderbook_error orderbook_queue_position(struct orderbook* ob,
+                                              uint64_t order_id,
+                                              struct queue_position* position);
+
 /**
  * Prints the orderbook state, it will allocate a string. Once it returns,
  * it is the caller's responsibility to deallocate it after use with `free`.
@@ -0,0 +1,92 @@
+#ifndef ORDERBOOK_FORK_H
+#define ORDERBOOK_FORK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "limit.h"
+#include "limit_tree.h"
+
+/**
+ * A price level as the fork sees it
+ */
+struct orderbook_fork_level {
+  uint64_t price;
+  uint64_t volume;  // what is left of it after the simulated executions
+};
+
+/**
+ * The levels of both sides at the time of the fork, best first. Shared by a
+ * fork and all its clones, and never written to after it is taken.
+ */
+struct orderbook_snapshot;
+
+/**
+ * A copy of a book to simulate executions against, eg. to see where a large
+ * market order would leave the book, without touching the book itself.
+ *
+ * The levels are copied once when the book is forked, the orders are not
+ * copied at all. A fork then only keeps what its own executions took off the
+ * top of each side: the levels fully taken and what was taken from the next
+ * one. Clones share the levels of the fork they came from, so branching off a
+ * fork is O(1) and copies nothing else.
+ *
+ * A fork does not point into its book, so it can be handed to another thread
+ * and used there while the book keeps matching. A fork and its clones can be
+ * used and freed from different threads, as long as each one is used by one
+ * thread at a time.
+ */
+struct orderbook_fork {
+  struct orderbook_snapshot* snapshot;
+
+  // the first `taken[side]` levels of each side have been taken, and
+  // `taken_volume[side]` of the one after them
+  uint32_t taken[2];
+  uint64_t taken_volume[2];
+  uint64_t last_price;  // of the last simulated trade, else of the book
+};
+
+/**
+ * Copies the `depth` best levels of each side, or all of them if `depth` is
+ * 0, see `orderbook_fork()`.
+ */
+struct orderbook_fork orderbook_fork_new(struct limit_tree* bid,
+                                         struct limit_tree* ask,
+                                         uint32_t depth);
+
+/**
+ * Returns a fork that starts where `fork` is, sharing its levels.
+ */
+struct orderbook_fork orderbook_fork_clone(struct orderbook_fork* fork);
+
+/**
+ * Drops the fork, the levels go once the last fork sharing them is freed.
+ */
+void orderbook_fork_free(struct orderbook_fork* fork);
+
+/**
+ * Simulates a market order on `side` for `size` against the other side of
+ * the fork, taking from its best levels. Returns the size filled, the worst
+ * price reached and the total cost, see `orderbook_cost_to_fill()`.
+ */
+struct limit_tree_fill orderbook_fork_execute(struct orderbook_fork* fork,
+                                              enum side side,
+                                              uint64_t size);
+
+/**
+ * Returns what `orderbook_fork_execute()` would, without taking anything.
+ */
+struct limit_tree_fill orderbook_fork_cost_to_fill(struct orderbook_fork* fork,
+                                                   enum side side,
+                                                   uint64_t size);
+
+/**
+ * Writes the best `n` levels left on `side` of the fork to `buffer`, best
+ * first, and returns how many were written. See `orderbook_top_n()`.
+ */
+uint32_t orderbook_fork_top_n(struct orderbook_fork* fork,
+                              enum side side,
+                              uint32_t n,
+                              struct orderbook_fork_level* buffer);
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * Template for a variant of `orderbook_execute()` compiled against an event
+ * sink known at compile time. Emitting an event is a macro instead of a call
+ * through `struct event_handler`, so the compiler can inline the sink into
+ * the match loop, or drop it entirely if the macro is empty. Define the sink
+ * and include this header, eg.
+ *
+ *  #define ORDERBOOK_SINK_EXECUTE orderbook_execute_counting
+ *  #define ORDERBOOK_SINK_ORDER_EVENT(ob, event) order_events++
+ *  #define ORDERBOOK_SINK_TRADE_EVENT(ob, event) trade_events++
+ *  #include "orderbook_sink.h"
+ *
+ * defines a static `orderbook_execute_counting()` with the same parameters
+ * and semantics as `orderbook_execute()`, which is itself built on an
+ * instance of this template, and the match loop on its own in a `_match`
+ * suffixed function. Such a variant records the last price but does not
+ * activate stop and take profit orders, the ones it crosses are left for the
+ * next `orderbook_execute()` or `orderbook_place()`.
+ * `ORDERBOOK_SINK_FLUSH(ob)` is optional and runs once the operation is done,
+ * `ORDERBOOK_SINK_LEVEL_CHANGED(ob, side, price)` is optional too and runs
+ * whenever a fill changes the volume of a level.
+ * The book is published to its top of book and depth publisher readers before
+ * the flush, like `orderbook_execute()` does it.
+ * `ORDERBOOK_SINK_PUBLISH(ob)` replaces that.
+ * The macros are undefined again at the end, so the header can be included
+ * once per sink. Note that a sink building a `struct event` needs another
+ * name than `event` for the macro parameter.
+ */
+
+#ifndef ORDERBOOK_SINK_H
+#define ORDERBOOK_SINK_H
+
+#include "orderbook.h"
+
+void _orderbook_unindex_order(struct orderbook* ob, uint64_t order_id);
+void _orderbook_publish(struct orderbook* ob);
+
+#define _ORDERBOOK_SINK_CAT(a, b) a##b
+#define _ORDERBOOK_SINK_NAME(a, b) _ORDERBOOK_SINK_CAT(a, b)
+
+#endif
+
+#if !defined(ORDERBOOK_SINK_EXECUTE) || \
+    !defined(ORDERBOOK_SINK_ORDER_EVENT) || !defined(ORDERBOOK_SINK_TRADE_EVENT)
+#error "define the sink before including orderbook_sink.h"
+#endif
+
+#ifndef ORDERBOOK_SINK_FLUSH
+#define ORDERBOOK_SINK_FLUSH(ob)
+#endif
+
+#ifndef ORDERBOOK_SINK_LEVEL_CHANGED
+#define ORDERBOOK_SINK_LEVEL_CHANGED(ob, side, price)
+#endif
+
+#ifndef ORDERBOOK_SINK_PUBLISH
+#define ORDERBOOK_SINK_PUBLISH(ob) _orderbook_publish(ob)
+#endif
+
+#ifndef ORDERBOOK_SINK_LINKAGE
+#define ORDERBOOK_SINK_LINKAGE static
+#endif
+
+#define ORDERBOOK_SINK_MATCH \
+  _ORDERBOOK_SINK_NAME(ORDERBOOK_SINK_EXECUTE, _match)
+
+/**
+ * Matches an order against the opposite side `tree`, level by level for as
+ * long as they cross `price`, until `execute_size` is filled. Emits the fill
+ * events and returns the size filled.
+ */
+static inline uint64_t ORDERBOOK_SINK_MATCH(struct orderbook* ob,
+                                            struct limit_tree* tree,
+                                            const uint64_t order_id,
+                                            const enum side side,
+                                            const uint64_t size,
+                                            uint64_t execute_size,
+                                            const uint64_t price) {
+  uint64_t cum_filled_size = 0;  // cumulative filled size
+
+  // keep matching until no liquidity left or the order is fulfilled
+  while (tree->best != NULL && execute_size > 0 &&
+         (side == SIDE_BID ? tree->best->price <= price
+                           : tree->best->price >= price)) {
+    struct order* match = tree->best->order_head;  // always match top in queue
+    if (tree->best->ring.slots != NULL)  // the ring knows what comes next
+      order_ring_prefetch(&tree->best->ring, match->ring_slot);
+    // fill only available size
+    uint64_t fill_size =
+        execute_size < match->size ? execute_size : match->size;
+
+    // fill order
+    match->size -= fill_size;
+    execute_size -= fill_size;
+    match->cum_filled_size += fill_size;
+    cum_filled_size += fill_size;
+    tree->best->volume -= fill_size;  // update limit volume
+    if (tree->aggregates)
+      limit_tree_aggregate(tree, tree->best, -(int64_t)fill_size, 0);
+    ob->last_price = match->price;    // for the triggers
+    if (ob->queue_positions)
+      order_fenwick_add(&tree->best->queue, match->queue_slot,
+                        -(int64_t)fill_size, match->size == 0 ? -1 : 0);
+    ORDERBOOK_SINK_LEVEL_CHANGED(ob, tree->side, match->price);
+
+    // emit order event for order in book
+    struct order_event maker = {
+        .status = match->size == 0 ? ORDER_STATUS_FILLED
+                                   : ORDER_STATUS_PARTIALLY_FILLED,
+        .order_id = match->order_id,
+        .side = match->side,
+        .filled_size = fill_size,
+        .cum_filled_size = match->cum_filled_size,
+        .remaining_size = match->size,
+        .price = match->price};
+    ORDERBOOK_SINK_ORDER_EVENT(ob, maker);
+    // emit order event for the incoming order
+    struct order_event taker = {
+        .status = (size - cum_filled_size) == 0 ? ORDER_STATUS_FILLED
+                                                : ORDER_STATUS_PARTIALLY_FILLED,
+        .order_id = order_id,
+        .side = side,
+        .filled_size = fill_size,
+        .cum_filled_size = cum_filled_size,
+        .remaining_size = size - cum_filled_size,
+        .price = match->price};
+    ORDERBOOK_SINK_ORDER_EVENT(ob, taker);
+    // emit trade event
+    struct trade_event trade = {
+        .size = fill_size,
+        .side = side,
+        .price = match->price,
+        .buyer_order_id = side == SIDE_BID ? order_id : match->order_id,
+        .seller_order_id = side == SIDE_BID ? match->order_id : order_id};
+    ORDERBOOK_SINK_TRADE_EVENT(ob, trade);
+
+    if (match->size == 0) {  // order in book is fully filled
+
+      if (tree->best->order_count == 1) {  // limit has no other orders
+
+        _orderbook_unindex_order(ob, match->order_id);  // unindex
+        limit_tree_remove(tree, tree->best);            // next best moves up
+
+      } else {  // limit still has other orders
+
+        _orderbook_unindex_order(ob, match->order_id);  // unindex
+        if (tree->best->ring.slots != NULL) {  // past any tombstones
+          order_ring_remove(&tree->best->ring, match);
+          tree->best->order_head = order_ring_first(&tree->best->ring);
+        } else {
+          tree->best->order_head = match->next;  // next in queue moves up
+          tree->best->order_head->prev = NULL;   // remove dangling pointer
+        }
+        object_pool_release(ob->order_pool, match);  // free filled order
+        tree->best->order_count--;            // decrement limit order count
+        if (tree->aggregates)
+          limit_tree_aggregate(tree, tree->best, 0, -1);
+      }
+    }
+  }
+
+  return cum_filled_size;
+}
+
+ORDERBOOK_SINK_LINKAGE uint64_t ORDERBOOK_SINK_EXECUTE(struct orderbook* ob,
+                                                       const uint64_t order_id,
+                                                       const enum side side,
+                                                       const uint64_t size,
+                                                       uint64_t execute_size,
+                                                       bool is_market) {
+  struct limit_tree* tree;
+  switch (side) {
+    case SIDE_BID:
+      tree = ob->ask;
+      break;
+    case SIDE_ASK:
+      tree = ob->bid;
+      break;
+    default:
+      fprintf(stderr, "received unrecognised order side");
+      exit(1);
+  }
+
+  // reject if no liquidity
+  if (tree->best == NULL) {
+    struct order_event rejected = {
+        .status = ORDER_STATUS_REJECTED,
+        .order_id = order_id,
+        .side = side,
+        .filled_size = 0,
+        .cum_filled_size = 0,
+        .remaining_size = execute_size,
+        .price = 0,
+        .reject_reason = REJECT_REASON_NO_LIQUIDITY};
+    ORDERBOOK_SINK_ORDER_EVENT(ob, rejected);
+    ORDERBOOK_SINK_FLUSH(ob);
+    return execute_size;
+  }
+
+  // emit order event created
+  struct order_event created = {
+      .status = ORDER_STATUS_CREATED,
+      .order_id = order_id,
+      .side = side,
+      .filled_size = 0,
+      .cum_filled_size = 0,
+      .remaining_size = size,
+      .price = !is_market && tree->best != NULL ? tree->best->price : 0};
+  ORDERBOOK_SINK_ORDER_EVENT(ob, created);
+
+  // the fills do not tell the depth publisher which levels they change, but
+  // they all start from the best one
+  if (ob->depth_publisher != NULL)
+    depth_publisher_touch(ob->depth_publisher, tree->side, tree->best->price);
+
+  uint64_t cum_filled_size =
+      ORDERBOOK_SINK_MATCH(ob, tree, order_id, side, size, execute_size,
+                           side == SIDE_BID ? UINT64_MAX : 0);
+  execute_size -= cum_filled_size;
+
+  // not enough liquidity to fulfill market order
+  if (is_market && execute_size > 0) {
+    struct order_event cancelled = {
+        .status = ORDER_STATUS_PARTIALLY_FILLED_CANCELLED,
+        .order_id = order_id,
+        .side = side,
+        .filled_size = 0,
+        .cum_filled_size = cum_filled_size,
+        .remaining_size = execute_size,
+        .price = 0};
+    ORDERBOOK_SINK_ORDER_EVENT(ob, cancelled);
+  }
+
+  ORDERBOOK_SINK_PUBLISH(ob);
+  ORDERBOOK_SINK_FLUSH(ob);
+  return size - cum_filled_size;
+}
+
+#undef ORDERBOOK_SINK_EXECUTE
+#undef ORDERBOOK_SINK_MATCH
+#undef ORDERBOOK_SINK_ORDER_EVENT
+#undef ORDERBOOK_SINK_TRADE_EVENT
+#undef ORDERBOOK_SINK_FLUSH
+#undef ORDERBOOK_SINK_LEVEL_CHANGED
+#undef ORDERBOOK_SINK_PUBLISH
+#undef ORDERBOOK_SINK_LINKAGE
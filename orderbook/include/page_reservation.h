@@ -0,0 +1,52 @@
+#ifndef PAGE_RESERVATION_H
+#define PAGE_RESERVATION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PAGE_RESERVATION_HUGE_PAGE_SIZE (2 << 20)  // 2MB, the x86-64 default
+#define PAGE_RESERVATION_ALIGN 64                  // of every allocation
+
+/**
+ * Pages backing a reservation, from what is always available to the best
+ */
+enum page_kind {
+  PAGE_KIND_NORMAL,       // normal pages, huge pages are not available
+  PAGE_KIND_TRANSPARENT,  // advised `MADV_HUGEPAGE`, with THP not `never`
+  PAGE_KIND_HUGETLB,      // explicit huge pages, `MAP_HUGETLB`
+};
+
+/**
+ * A region of memory mapped up front and handed out with a bump pointer. It
+ * is on explicit huge pages if the system has some reserved, otherwise on
+ * transparent huge pages if they are enabled and can be advised, otherwise on
+ * normal pages, and `kind` tells which. Every page is written to before it
+ * is handed out, so none of them faults later on.
+ *
+ * Allocations are never freed on their own, the whole region is unmapped by
+ * `page_reservation_free()`.
+ */
+struct page_reservation {
+  unsigned char* base;  // start of the mapping, NULL if none
+  size_t size;          // bytes mapped, a multiple of the huge page size
+  size_t used;          // bytes handed out
+  enum page_kind kind;  // pages the region ended up on
+  bool locked;          // `mlock` succeeded, the pages are never swapped out
+};
+
+/**
+ * Maps at least `bytes` and pre-faults them. With `lock` set the region is
+ * also `mlock`ed, which can fail under `RLIMIT_MEMLOCK` and leaves `locked`
+ * unset without failing the reservation.
+ */
+struct page_reservation page_reservation_new(size_t bytes, bool lock);
+void page_reservation_free(struct page_reservation* reservation);
+
+/**
+ * Returns `bytes` of zeroed memory aligned to `PAGE_RESERVATION_ALIGN`, or
+ * NULL if the region does not have that much left.
+ */
+void* page_reservation_alloc(struct page_reservation* reservation,
+                             size_t bytes);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TOP_OF_BOOK_H
+#define TOP_OF_BOOK_H
+
+#include <stdint.h>
+
+#include "limit.h"
+
+/**
+ * Best level of one side as last published, all 0 if the side is empty
+ */
+struct top_of_book_level {
+  uint64_t price;
+  uint64_t volume;
+  uint64_t order_count;
+};
+
+/**
+ * A consistent read of a `top_of_book`, see `top_of_book_read()`
+ */
+struct top_of_book_quote {
+  struct top_of_book_level bid;
+  struct top_of_book_level ask;
+  uint64_t sequence;  // of the update read, grows by 2 with every update
+};
+
+/**
+ * The best bid and ask of a book, published by the matching thread under a
+ * seqlock for any number of threads to poll. The writer bumps `sequence` to
+ * an odd number, writes the levels and bumps it to even again. A reader
+ * retries whenever it saw an odd sequence, or the sequence moved while it
+ * was copying. Readers never write to it, so they never slow down the
+ * writer or each other, and the writer never waits for them.
+ *
+ * It takes a cache line of its own, so nothing else written by the matching
+ * thread invalidates it in the caches of the readers. Only access it through
+ * the functions below, the fields are read and written with atomics.
+ */
+struct top_of_book {
+  _Alignas(64) uint64_t sequence;  // odd while an update is being written
+  struct top_of_book_level bid;
+  struct top_of_book_level ask;
+};
+
+struct top_of_book top_of_book_new();
+
+/**
+ * Publishes the best levels of both sides, NULL for an empty side. Does not
+ * touch the record if neither has changed since the last update. Must only
+ * be called from one thread at a time.
+ */
+void top_of_book_publish(struct top_of_book* top,
+                         const struct limit* bid,
+                         const struct limit* ask);
+
+/**
+ * Copies out the last update published, from any thread.
+ */
+struct top_of_book_quote top_of_book_read(const struct top_of_book* top);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef TRIGGER_BOOK_H
+#define TRIGGER_BOOK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "limit.h"
+#include "limit_tree.h"
+#include "object_pool.h"
+#include "uint64_swissmap.h"
+
+/**
+ * Order that is held back until the price of the last trade reaches its
+ * trigger price, then placed as a market or a limit order.
+ */
+enum trigger_type {
+  TRIGGER_TYPE_STOP,               // market order, against the price move
+  TRIGGER_TYPE_STOP_LIMIT,         // limit order, against the price move
+  TRIGGER_TYPE_TAKE_PROFIT,        // market order, with the price move
+  TRIGGER_TYPE_TAKE_PROFIT_LIMIT,  // limit order, with the price move
+};
+
+/**
+ * A pending trigger, queued at its trigger price like an order at a limit.
+ */
+struct trigger_order {
+  struct order order;      // `order.price` is the trigger price
+  uint64_t price;          // limit price, for the limit types only
+  enum trigger_type type;  // what the order becomes once triggered
+};
+
+/**
+ * Pending triggers, in two trees keyed by trigger price. A buy stop or a sell
+ * take profit is triggered once the last price rises to it, and a sell stop
+ * or a buy take profit once it falls to it. The best of each tree is then the
+ * next trigger to be crossed, so activating the triggers crossed by a price
+ * move pops them off the front in the order the price went past them, oldest
+ * first at the same trigger price.
+ */
+struct trigger_book {
+  struct limit_tree rising;   // triggered at or above, lowest first
+  struct limit_tree falling;  // triggered at or below, highest first
+  struct uint64_swissmap trigger_map;  // order id to the pending trigger
+  uint64_t size;                       // pending triggers
+
+  // owned by the trigger book, separate from the pools of the orderbook
+  struct object_pool* trigger_pool;
+  struct object_pool* limit_pool;
+};
+
+struct trigger_book trigger_book_new();
+void trigger_book_free(struct trigger_book* book);
+
+/**
+ * Drops every pending trigger at once, keeping the memory of the book.
+ */
+void trigger_book_clear(struct trigger_book* book);
+
+/**
+ * Queue `trigger` at its trigger price.
+ */
+void trigger_book_add(struct trigger_book* book, struct trigger_order trigger);
+
+/**
+ * Take out the next trigger crossed by `last_price` into `trigger`, those
+ * crossed rising first. Returns false if `last_price` crosses none.
+ */
+bool trigger_book_pop(struct trigger_book* book,
+                      uint64_t last_price,
+                      struct trigger_order* trigger);
+
+/**
+ * Take out the pending trigger of `order_id` into `trigger`, returns false if
+ * there is none.
+ */
+bool trigger_book_remove(struct trigger_book* book,
+                         uint64_t order_id,
+                         struct trigger_order* trigger);
+
+/**
+ * Take out every pending trigger `filter` accepts, lowest trigger price first
+ * in each tree, handing a copy of each to `removed`. Both get `context`.
+ * Returns how many were taken out.
+ */
+uint64_t trigger_book_remove_all(
+    struct trigger_book* book,
+    bool (*filter)(const struct trigger_order* trigger, void* context),
+    void (*removed)(const struct trigger_order* trigger, void* context),
+    void* context);
+
+#endif
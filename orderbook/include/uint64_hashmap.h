@@ -5,6 +5,7 @@
 
 #define UINT64_HASHMAP_DEFAULT_CAPACITY 8
 #define UINT64_HASHMAP_MAX_LOAD_FACTOR 65  // 65%
+#define UINT64_HASHMAP_MIGRATE_BUCKETS 32  // old buckets moved per operation
 
 struct uint64_hashmap_entry {
   uint64_t key;
@@ -14,6 +15,14 @@ struct uint64_hashmap_entry {
 struct uint64_hashmap {
   uint32_t size, capacity;
   struct uint64_hashmap_entry* table;
+
+  // With `incremental` set, a resize keeps the old table around and every put
+  // or remove moves `UINT64_HASHMAP_MIGRATE_BUCKETS` of its buckets over, so
+  // no single call pays for rehashing the whole map.
+  bool incremental;
+  struct uint64_hashmap_entry* old_table;  // being migrated, NULL if not
+  uint32_t old_capacity;
+  uint32_t migrate_index;  // old buckets before this one have been moved
 };
 
 /**
@@ -43,6 +52,12 @@ uint32_t find_next_positive_power_of_two(uint32_t value);
 
 struct uint64_hashmap uint64_hashmap_with_capacity(uint32_t capacity);
 struct uint64_hashmap uint64_hashmap_new();
+
+/**
+ * Creates a map that resizes incrementally, see `incremental`.
+ */
+struct uint64_hashmap uint64_hashmap_incremental_with_capacity(
+    uint32_t capacity);
 void uint64_hashmap_free(struct uint64_hashmap* map);
 void* uint64_hashmap_put(struct uint64_hashmap* map, uint64_t key, void* value);
 void* uint64_hashmap_get(struct uint64_hashmap* map, uint64_t key);
@@ -0,0 +1,91 @@
+#ifndef UINT64_SWISSMAP_H
+#define UINT64_SWISSMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uint64_hashmap.h"
+
+#define UINT64_SWISSMAP_DEFAULT_CAPACITY 32
+#define UINT64_SWISSMAP_MAX_LOAD_FACTOR 87  // 87.5%, 7 in 8 slots
+#define UINT64_SWISSMAP_MIGRATE_SLOTS 32    // old slots moved per operation
+
+struct uint64_swissmap_slot {
+  uint64_t key;
+  void* value;
+};
+
+/**
+ * A Swiss table keyed by `uint64_t`, with the same semantics as
+ * `uint64_hashmap`. Every slot has a control byte that is either empty,
+ * deleted or the low 7 bits of the hash of its key, and a lookup compares a
+ * whole group of control bytes at once (16 with SSE2, 32 with AVX2). Only the
+ * slots whose control byte matches are read, so a probe mostly touches one
+ * line of control bytes and one slot.
+ *
+ * A removed slot goes back to empty unless it sits in a run of full slots as
+ * long as a group, which is the only way a probe could have gone past it.
+ * Tombstones are rare under insert / remove churn and are dropped by rehashing
+ * in place instead of growing.
+ *
+ * @ref https://abseil.io/about/design/swisstables
+ */
+struct uint64_swissmap {
+  uint32_t size, capacity;
+  uint32_t tombstones;   // deleted control bytes
+  uint32_t growth_left;  // empty slots that can be used before a rehash
+  int8_t* ctrl;          // one control byte per slot, plus a group - 1 cloned
+  struct uint64_swissmap_slot* slots;
+  bool borrowed;  // the table is in memory the map does not own or free
+
+  // With `incremental` set, a rehash keeps the old table around and every put
+  // or remove moves `UINT64_SWISSMAP_MIGRATE_SLOTS` of its slots over, so no
+  // single call pays for rehashing the whole map.
+  bool incremental;
+  struct uint64_swissmap* old;  // table being migrated, NULL if not
+  uint32_t migrate_index;       // old slots before this one have been moved
+};
+
+struct uint64_swissmap uint64_swissmap_with_capacity(uint32_t capacity);
+struct uint64_swissmap uint64_swissmap_new();
+
+/**
+ * Returns the bytes the table of a map with room for `capacity` entries
+ * takes, see `uint64_swissmap_with_memory()`.
+ */
+size_t uint64_swissmap_memory_size(uint32_t capacity);
+
+/**
+ * Creates a map with room for `capacity` entries whose table is in `memory`,
+ * eg. memory reserved up front on huge pages. It must be aligned to 16 bytes
+ * and have `uint64_swissmap_memory_size(capacity)` bytes. The map never frees
+ * it, and a map that outgrows it moves to a table of its own.
+ */
+struct uint64_swissmap uint64_swissmap_with_memory(uint32_t capacity,
+                                                   void* memory);
+
+/**
+ * Creates a map that rehashes incrementally, see `incremental`.
+ */
+struct uint64_swissmap uint64_swissmap_incremental_with_capacity(
+    uint32_t capacity);
+void uint64_swissmap_free(struct uint64_swissmap* map);
+
+/**
+ * Removes every entry, keeping the capacity. Only the control bytes are reset.
+ */
+void uint64_swissmap_clear(struct uint64_swissmap* map);
+void* uint64_swissmap_put(struct uint64_swissmap* map,
+                          uint64_t key,
+                          void* value);
+void* uint64_swissmap_get(struct uint64_swissmap* map, uint64_t key);
+void* uint64_swissmap_remove(struct uint64_swissmap* map, uint64_t key);
+
+/**
+ * Hints that `key` will be looked up soon, the control bytes and the slot
+ * where its probe starts are brought in cache without waiting for them.
+ */
+void uint64_swissmap_prefetch(struct uint64_swissmap* map, uint64_t key);
+
+#endif
@@ -1,3 +1,4 @@
+#include <malloc.h>
 #include <stdio.h>
 
 #include "orderbook.h"
@@ -24,10 +25,12 @@ struct benchmark_result {
   uint64_t limit_elapsed_ns, limit_count;
   uint64_t cancel_elapsed_ns, cancel_count;
   uint64_t amend_size_elapsed_ns, amend_size_count;
+  struct object_pool order_pool, limit_pool;  // pool counters at the end
 };
 
-struct benchmark_result benchmark(struct state* state) {
-  struct orderbook orderbook = orderbook_new();
+struct benchmark_result benchmark(struct state* state,
+                                  struct orderbook_config config) {
+  struct orderbook orderbook = orderbook_new_with_config(config);
   struct orderbook* ob = &orderbook;
   struct event_handler handler = event_handler_new();
   handler.handle_order_event = handle_order_event;
@@ -88,6 +91,8 @@ struct benchmark_result benchmark(struct state* state) {
     }
   }
 
+  result.order_pool = *ob->order_pool;
+  result.limit_pool = *ob->limit_pool;
   orderbook_free(&orderbook);
 
   return result;
@@ -95,10 +100,14 @@ struct benchmark_result benchmark(struct state* state) {
 
 #define SAMPLE_SIZE 100
 
-int main() {
-  struct state state = {.messages_len = get_line_count(DATA),
-                        .messages = parse_messages(DATA)};
+void print_pool(const char* name, struct object_pool* pool) {
+  printf("%s pool: %ld allocations, %ld capacity, %ld slab mallocs\n", name,
+         pool->allocations, pool->capacity, pool->slab_allocations);
+}
 
+void run(struct state* state,
+         const char* name,
+         struct orderbook_config config) {
   struct benchmark_result result;
   uint64_t market_elapsed_ns = 0;
   uint64_t limit_elapsed_ns = 0;
@@ -106,7 +115,7 @@ int main() {
   uint64_t amend_size_elapsed_ns = 0;
 
   for (int i = 0; i < SAMPLE_SIZE; i++) {
-    result = benchmark(&state);
+    result = benchmark(state, config);
     market_elapsed_ns += result.market_elapsed_ns;
     limit_elapsed_ns += result.limit_elapsed_ns;
     cancel_elapsed_ns += result.cancel_elapsed_ns;
@@ -122,11 +131,11 @@ int main() {
   uint64_t total_elapsed_ns = market_elapsed_ns + limit_elapsed_ns +
                               cancel_elapsed_ns + amend_size_elapsed_ns;
 
-  printf("Over %d samples,\n", SAMPLE_SIZE);
+  printf("[%s] Over %d samples,\n", name, SAMPLE_SIZE);
   printf("Took %.2fms to process %ld messages\n", total_elapsed_ns * 1e-6,
-         state.messages_len);
+         state->messages_len);
   printf("Took %ldns to process 1 message\n",
-         total_elapsed_ns / state.messages_len);
+         total_elapsed_ns / state->messages_len);
   printf("-------------------------------\n");
   printf("orderbook_market: %ldns/op over %ld calls\n",
          market_elapsed_ns / result.market_count, result.market_count);
@@ -137,9 +146,556 @@ int main() {
   printf("orderbook_amend_size: %ldns/op over %ld calls\n",
          amend_size_elapsed_ns / result.amend_size_count,
          result.amend_size_count);
+  print_pool("order", &result.order_pool);
+  print_pool("limit", &result.limit_pool);
+  printf("\n");
+}
+
+#define DEEP_BOOK_LEVELS 100'000
+#define DEEP_BOOK_TOP_N 20
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void shuffle(uint64_t* values, int len) {
+  for (int i = len - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    uint64_t tmp = values[i];
+    values[i] = values[j];
+    values[j] = tmp;
+  }
+}
+
+/**
+ * A synthetic book with 100k resting bid levels, one order each.
+ */
+void run_deep_book(const char* name, struct orderbook_config config) {
+  struct orderbook orderbook = orderbook_new_with_config(config);
+  struct orderbook* ob = &orderbook;
+
+  // shuffle the prices so that levels are not added in order
+  uint64_t* prices = malloc(sizeof(uint64_t) * DEEP_BOOK_LEVELS);
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i++)
+    prices[i] = 1'000'000 + i;
+  srand(42);
+  shuffle(prices, DEEP_BOOK_LEVELS);
+
+  // and the order ids, so that lookups by id jump around in memory
+  uint64_t* order_ids = malloc(sizeof(uint64_t) * DEEP_BOOK_LEVELS);
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i++)
+    order_ids[i] = i + 1;
+  shuffle(order_ids, DEEP_BOOK_LEVELS);
+
+  uint64_t start = now_ns();
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i++)
+    orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                       .side = SIDE_BID,
+                                       .price = prices[i],
+                                       .size = 1});
+  uint64_t limit_ns = now_ns() - start;
+
+  struct limit buffer[DEEP_BOOK_TOP_N];
+  start = now_ns();
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i++)
+    orderbook_top_n(ob, SIDE_BID, DEEP_BOOK_TOP_N, buffer);
+  uint64_t top_n_ns = now_ns() - start;
+
+  start = now_ns();
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i++)
+    orderbook_amend_size(ob, order_ids[i], 2);
+  uint64_t amend_ns = now_ns() - start;
+
+  // cancel half of the levels, in random order
+  start = now_ns();
+  for (int i = 0; i < DEEP_BOOK_LEVELS; i += 2)
+    orderbook_cancel(ob, order_ids[i]);
+  uint64_t cancel_ns = now_ns() - start;
+
+  // sweep a tenth of the remaining levels from the best
+  const uint64_t sweep = DEEP_BOOK_LEVELS / 20;
+  start = now_ns();
+  orderbook_execute(ob, DEEP_BOOK_LEVELS + 1, SIDE_ASK, sweep, sweep, true);
+  uint64_t sweep_ns = now_ns() - start;
+
+  printf("[%s] Synthetic book with %d levels,\n", name, DEEP_BOOK_LEVELS);
+  printf("orderbook_limit: %ldns/op\n", limit_ns / DEEP_BOOK_LEVELS);
+  printf("orderbook_top_n(%d): %ldns/op\n", DEEP_BOOK_TOP_N,
+         top_n_ns / DEEP_BOOK_LEVELS);
+  printf("orderbook_amend_size: %ldns/op\n", amend_ns / DEEP_BOOK_LEVELS);
+  printf("orderbook_cancel: %ldns/op\n", cancel_ns / (DEEP_BOOK_LEVELS / 2));
+  printf("orderbook_execute: %ldns/level swept\n", sweep_ns / sweep);
+  print_pool("order", ob->order_pool);
+  print_pool("limit", ob->limit_pool);
+  printf("\n");
+
+  free(prices);
+  free(order_ids);
+  orderbook_free(ob);
+}
+
+#define DEEP_QUEUE_ORDERS (1 << 20)
+#define DEEP_QUEUE_LEVELS 8
+
+/**
+ * A synthetic book with 1m orders queued at a handful of ask levels. Orders
+ * are cancelled and replaced at random first, so that the pool hands out the
+ * orders of each queue all over its memory, then every level is swept.
+ */
+void run_deep_queue(const char* name, struct orderbook_config config) {
+  struct orderbook orderbook = orderbook_new_with_config(config);
+  struct orderbook* ob = &orderbook;
+
+  srand(42);
+  uint64_t order_id = 0;
+  for (int i = 0; i < DEEP_QUEUE_ORDERS; i++)
+    orderbook_limit(ob,
+                    (struct order){.order_id = ++order_id,
+                                   .side = SIDE_ASK,
+                                   .price = 100 + rand() % DEEP_QUEUE_LEVELS,
+                                   .size = 1});
+
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < DEEP_QUEUE_ORDERS / 2; i++)
+      orderbook_cancel(ob, 1 + rand() % order_id);
+    for (int i = 0; i < DEEP_QUEUE_ORDERS / 2; i++)
+      orderbook_limit(ob,
+                      (struct order){.order_id = ++order_id,
+                                     .side = SIDE_ASK,
+                                     .price = 100 + rand() % DEEP_QUEUE_LEVELS,
+                                     .size = 1});
+  }
+
+  uint64_t resting = ob->order_pool->in_use;
+  uint64_t start = now_ns();
+  orderbook_execute(ob, ++order_id, SIDE_BID, resting, resting, true);
+  uint64_t sweep_ns = now_ns() - start;
+
+  printf("[%s] Synthetic book with %ld orders over %d levels,\n", name,
+         resting, DEEP_QUEUE_LEVELS);
+  printf("orderbook_execute: %ldns/order filled\n\n", sweep_ns / resting);
+
+  orderbook_free(ob);
+}
+
+#define FOOTPRINT_ORDERS (1 << 20)
+#define FOOTPRINT_LEVELS 1024
+
+// bytes handed out by malloc, whether from the heap or mapped on their own
+size_t allocated_bytes() {
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+/**
+ * The memory taken by a book of 1m resting orders over 1024 levels, including
+ * the levels, the pools and the id index. Returns the bytes per order, and
+ * prints how many more orders fit in a MB than in `baseline` bytes per order
+ * unless it is 0.
+ */
+double run_memory_footprint(const char* name,
+                            struct orderbook_config config,
+                            double baseline) {
+  size_t before = allocated_bytes();
+  struct orderbook orderbook = orderbook_new_with_config(config);
+  struct orderbook* ob = &orderbook;
+
+  for (int i = 0; i < FOOTPRINT_ORDERS; i++)
+    orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                       .side = SIDE_BID,
+                                       .price = 1000 + i % FOOTPRINT_LEVELS,
+                                       .size = 1});
+
+  size_t bytes = allocated_bytes() - before;
+  double per_order = (double)bytes / FOOTPRINT_ORDERS;
+  printf("[%s] %d orders over %d levels,\n", name, FOOTPRINT_ORDERS,
+         FOOTPRINT_LEVELS);
+  printf("memory: %.1f bytes/order, %.0f orders/MB", per_order,
+         (double)FOOTPRINT_ORDERS * (1 << 20) / bytes);
+  if (baseline != 0)
+    printf(", %.2fx the orders/MB of full orders", baseline / per_order);
+  printf("\n\n");
+
+  orderbook_free(ob);
+  return per_order;
+}
+
+#define TEARDOWN_ORDERS 100'000
+#define TEARDOWN_LEVELS 1000
+#define TEARDOWN_ROUNDS 20
+
+void fill_teardown_book(struct orderbook* ob) {
+  for (int i = 0; i < TEARDOWN_ORDERS; i++) {
+    uint64_t level = (i / 2) % TEARDOWN_LEVELS;
+    orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                       .side = i % 2 ? SIDE_ASK : SIDE_BID,
+                                       .price = i % 2 ? 100'000 + level
+                                                      : 99'999 - level,
+                                       .size = 1});
+  }
+}
+
+/**
+ * Simulations go through a book per run, compare dropping a book of 100k
+ * orders with `orderbook_free()` and a new book with `orderbook_reset()`.
+ */
+void run_teardown(const char* name, struct orderbook_config config) {
+  uint64_t free_ns = 0, reset_ns = 0;
+  for (int round = 0; round < TEARDOWN_ROUNDS; round++) {
+    struct orderbook ob = orderbook_new_with_config(config);
+    fill_teardown_book(&ob);
+    uint64_t start = now_ns();
+    orderbook_free(&ob);
+    free_ns += now_ns() - start;
+  }
+
+  struct orderbook ob = orderbook_new_with_config(config);
+  for (int round = 0; round < TEARDOWN_ROUNDS; round++) {
+    fill_teardown_book(&ob);
+    uint64_t start = now_ns();
+    orderbook_reset(&ob);
+    reset_ns += now_ns() - start;
+  }
+  orderbook_free(&ob);
+
+  printf("[%s] Book with %d orders over %d levels,\n", name, TEARDOWN_ORDERS,
+         2 * TEARDOWN_LEVELS);
+  printf("orderbook_free: %ldus\n", free_ns / TEARDOWN_ROUNDS / 1000);
+  printf("orderbook_reset: %ldus\n\n", reset_ns / TEARDOWN_ROUNDS / 1000);
+}
+
+#define COLD_START_ORDERS (1 << 20)
+#define COLD_START_LEVELS 4096
+
+/**
+ * A new book filled with 1m orders, which pays for every page of the pools
+ * and maps the first time it is touched unless they were reserved up front.
+ */
+void run_cold_start(const char* name, struct orderbook_config config) {
+  uint64_t start = now_ns();
+  struct orderbook orderbook = orderbook_new_with_config(config);
+  struct orderbook* ob = &orderbook;
+  uint64_t new_ns = now_ns() - start;
+
+  start = now_ns();
+  for (int i = 0; i < COLD_START_ORDERS; i++)
+    orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                       .side = SIDE_BID,
+                                       .price = 1000 + i % COLD_START_LEVELS,
+                                       .size = 1});
+  uint64_t fill_ns = now_ns() - start;
+
+  const char* kinds[] = {"normal", "transparent huge", "hugetlb"};
+  printf("[%s] New book filled with %d orders, on %s pages%s,\n", name,
+         COLD_START_ORDERS, kinds[ob->reservation.kind],
+         ob->reservation.locked ? " (locked)" : "");
+  printf("orderbook_new_with_config: %ldus\n", new_ns / 1000);
+  printf("orderbook_limit: %ldns/order\n\n", fill_ns / COLD_START_ORDERS);
+
+  orderbook_free(ob);
+}
+
+#define TAIL_LATENCY_ORDERS 1'000'000
+
+int compare_uint64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Grows a book from empty to 1m resting orders, timing every call. The order
+ * map doubles 15 times on the way, which shows up in the tail.
+ */
+void run_tail_latency(const char* name, struct orderbook_config config) {
+  struct orderbook orderbook = orderbook_new_with_config(config);
+  struct orderbook* ob = &orderbook;
+
+  uint64_t* elapsed_ns = malloc(sizeof(uint64_t) * TAIL_LATENCY_ORDERS);
+  for (int i = 0; i < TAIL_LATENCY_ORDERS; i++) {
+    uint64_t start = now_ns();
+    orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                       .side = SIDE_BID,
+                                       .price = 1'000'000 + i % 1000,
+                                       .size = 1});
+    elapsed_ns[i] = now_ns() - start;
+  }
+  qsort(elapsed_ns, TAIL_LATENCY_ORDERS, sizeof(uint64_t), compare_uint64);
+
+  printf("[%s] orderbook_limit latency over %d calls,\n", name,
+         TAIL_LATENCY_ORDERS);
+  printf("p50: %ldns, p99: %ldns, p99.9: %ldns, p99.99: %ldns, max: %ldns\n",
+         elapsed_ns[TAIL_LATENCY_ORDERS / 2],
+         elapsed_ns[TAIL_LATENCY_ORDERS / 100 * 99],
+         elapsed_ns[TAIL_LATENCY_ORDERS / 1000 * 999],
+         elapsed_ns[TAIL_LATENCY_ORDERS / 10000 * 9999],
+         elapsed_ns[TAIL_LATENCY_ORDERS - 1]);
+  printf("\n");
+
+  free(elapsed_ns);
+  orderbook_free(ob);
+}
+
+#define SINK_ORDERS 100'000
+#define SINK_LEVELS 1000
+#define SINK_ROUNDS 20
+#define SINK_BUFFER 4096  // events kept by the buffering sinks, a power of 2
+
+struct sink_counts {
+  uint64_t order_events, trade_events;
+};
+
+struct sink_buffer {
+  struct event events[SINK_BUFFER];
+  uint64_t len;
+};
+
+void count_order_event(uint64_t ob_id,
+                       struct order_event event,
+                       void* user_data) {
+  ((struct sink_counts*)user_data)->order_events++;
+}
+
+void count_trade_event(uint64_t ob_id,
+                       struct trade_event event,
+                       void* user_data) {
+  ((struct sink_counts*)user_data)->trade_events++;
+}
+
+void buffer_order_event(uint64_t ob_id,
+                        struct order_event event,
+                        void* user_data) {
+  struct sink_buffer* buffer = user_data;
+  buffer->events[buffer->len++ & (SINK_BUFFER - 1)] =
+      (struct event){.type = EVENT_TYPE_ORDER, .order_event = event};
+}
+
+void buffer_trade_event(uint64_t ob_id,
+                        struct trade_event event,
+                        void* user_data) {
+  struct sink_buffer* buffer = user_data;
+  buffer->events[buffer->len++ & (SINK_BUFFER - 1)] =
+      (struct event){.type = EVENT_TYPE_TRADE, .trade_event = event};
+}
+
+// the same sinks again, known at compile time
+struct sink_counts counts;
+struct sink_buffer buffer;
+
+#define ORDERBOOK_SINK_EXECUTE orderbook_execute_noop
+#define ORDERBOOK_SINK_ORDER_EVENT(ob, e)
+#define ORDERBOOK_SINK_TRADE_EVENT(ob, e)
+#include "orderbook_sink.h"
+
+#define ORDERBOOK_SINK_EXECUTE orderbook_execute_counting
+#define ORDERBOOK_SINK_ORDER_EVENT(ob, e) counts.order_events++
+#define ORDERBOOK_SINK_TRADE_EVENT(ob, e) counts.trade_events++
+#include "orderbook_sink.h"
+
+#define ORDERBOOK_SINK_EXECUTE orderbook_execute_buffering
+#define ORDERBOOK_SINK_ORDER_EVENT(ob, e)           \
+  buffer.events[buffer.len++ & (SINK_BUFFER - 1)] = \
+      (struct event){.type = EVENT_TYPE_ORDER, .order_event = e}
+#define ORDERBOOK_SINK_TRADE_EVENT(ob, e)           \
+  buffer.events[buffer.len++ & (SINK_BUFFER - 1)] = \
+      (struct event){.type = EVENT_TYPE_TRADE, .trade_event = e}
+#include "orderbook_sink.h"
+
+/**
+ * Sweeps a book of 100k orders over 1000 levels with a single market order,
+ * emitting events through `handler` into `execute`.
+ */
+void run_sink(const char* name,
+              struct event_handler* handler,
+              uint64_t (*execute)(struct orderbook*,
+                                  uint64_t,
+                                  enum side,
+                                  uint64_t,
+                                  uint64_t,
+                                  bool)) {
+  uint64_t elapsed_ns = 0;
+
+  for (int round = 0; round < SINK_ROUNDS; round++) {
+    struct orderbook orderbook = orderbook_new();
+    struct orderbook* ob = &orderbook;
+    for (int i = 0; i < SINK_ORDERS; i++)
+      orderbook_limit(ob, (struct order){.order_id = i + 1,
+                                         .side = SIDE_BID,
+                                         .price = 1'000'000 + i % SINK_LEVELS,
+                                         .size = 1});
+    orderbook_set_event_handler(ob, handler);
+
+    uint64_t start = now_ns();
+    execute(ob, SINK_ORDERS + 1, SIDE_ASK, SINK_ORDERS, SINK_ORDERS, true);
+    elapsed_ns += now_ns() - start;
+
+    orderbook_free(ob);
+  }
+
+  printf("%s: %.1fns/fill\n", name,
+         (double)elapsed_ns / (SINK_ROUNDS * SINK_ORDERS));
+}
+
+void run_sinks() {
+  struct event_handler noop = event_handler_new();
+  noop.handle_order_event = handle_order_event;
+  noop.handle_trade_event = handle_trade_event;
+
+  struct sink_counts dynamic_counts = {};
+  struct event_handler counting = event_handler_new();
+  counting.handle_order_event = count_order_event;
+  counting.handle_trade_event = count_trade_event;
+  counting.user_data = &dynamic_counts;
+
+  struct sink_buffer* dynamic_buffer = malloc(sizeof(struct sink_buffer));
+  dynamic_buffer->len = 0;
+  struct event_handler buffering = event_handler_new();
+  buffering.handle_order_event = buffer_order_event;
+  buffering.handle_trade_event = buffer_trade_event;
+  buffering.user_data = dynamic_buffer;
+
+  printf("[sinks] Sweeping %d orders over %d levels,\n", SINK_ORDERS,
+         SINK_LEVELS);
+  run_sink("no handler", NULL, orderbook_execute);
+  run_sink("event_handler no-op", &noop, orderbook_execute);
+  run_sink("event_handler counting", &counting, orderbook_execute);
+  run_sink("event_handler buffering", &buffering, orderbook_execute);
+  run_sink("compile-time no-op", NULL, orderbook_execute_noop);
+  run_sink("compile-time counting", NULL, orderbook_execute_counting);
+  run_sink("compile-time buffering", NULL, orderbook_execute_buffering);
+  printf("\n");
+
+  free(dynamic_buffer);
+}
+
+#define BATCH_SAMPLE_SIZE 20
+
+/**
+ * Replays the dataset through `orderbook_process_batch()`, `batch_size`
+ * messages at a time.
+ */
+void run_batches(struct state* state, size_t batch_size) {
+  struct ob_command* commands =
+      malloc(sizeof(struct ob_command) * state->messages_len);
+  for (size_t i = 0; i < state->messages_len; i++) {
+    const struct message message = state->messages[i];
+    struct ob_command command = {.order_id = message.order_id,
+                                 .side = message.side,
+                                 .price = message.price,
+                                 .size = message.size};
+    switch (message.message_type) {
+      case MESSAGE_TYPE_CREATED:
+        command.type =
+            message.price == 0 ? OB_COMMAND_MARKET : OB_COMMAND_LIMIT;
+        break;
+      case MESSAGE_TYPE_DELETED:
+        command.type = OB_COMMAND_CANCEL;
+        break;
+      case MESSAGE_TYPE_CHANGED:
+        command.type = OB_COMMAND_AMEND_SIZE;
+        break;
+    }
+    commands[i] = command;
+  }
+
+  struct event_handler handler = event_handler_new();
+  handler.handle_order_event = handle_order_event;
+  handler.handle_trade_event = handle_trade_event;
+  struct ob_result* results = malloc(sizeof(struct ob_result) * batch_size);
+
+  uint64_t elapsed_ns = 0;
+  for (int sample = 0; sample < BATCH_SAMPLE_SIZE; sample++) {
+    struct orderbook orderbook = orderbook_new();
+    orderbook_set_event_handler(&orderbook, &handler);
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < state->messages_len; i += batch_size) {
+      size_t n = state->messages_len - i;
+      orderbook_process_batch(&orderbook, commands + i,
+                              n < batch_size ? n : batch_size, results);
+    }
+    elapsed_ns += now_ns() - start;
+
+    orderbook_free(&orderbook);
+  }
+
+  printf("[batch] Batches of %ld messages, %ldns/message\n", batch_size,
+         elapsed_ns / BATCH_SAMPLE_SIZE / state->messages_len);
+
+  free(results);
+  free(commands);
+}
+
+int main() {
+  struct state state = {.messages_len = get_line_count(DATA),
+                        .messages = parse_messages(DATA)};
+
+  struct orderbook_config config = orderbook_config_default();
+  run(&state, "rb_tree", config);
+  run_deep_book("rb_tree", config);
+
+  config.limit_tree_kind = LIMIT_TREE_KIND_LADDER;
+  config.ladder_tick = 1;
+  config.ladder_capacity = 1 << 17;
+  run(&state, "ladder", config);
+  run_deep_book("ladder", config);
+
+  config.limit_tree_kind = LIMIT_TREE_KIND_BPTREE;
+  run(&state, "bptree", config);
+  run_deep_book("bptree", config);
+
+  config = orderbook_config_default();
+  config.order_index_pages = 1024;
+  run(&state, "order_index", config);
+  run_deep_book("order_index", config);
+
+  // ids are unindexed directly so that walking the queues is what is compared
+  config = orderbook_config_default();
+  config.order_index_pages = 4096;
+  run_deep_queue("linked_orders", config);
+  config.order_rings = true;
+  run_deep_queue("order_rings", config);
+  config.compact_orders = true;
+  run_deep_queue("compact_orders", config);
+
+  // compact orders against full ones with the same id index on both sides
+  config = orderbook_config_default();
+  double full = run_memory_footprint("full_orders", config, 0);
+  config.compact_orders = true;
+  run_memory_footprint("compact_orders", config, full);
+  config = orderbook_config_default();
+  config.order_index_pages = FOOTPRINT_ORDERS / ORDER_INDEX_PAGE_SIZE;
+  full = run_memory_footprint("full_orders+order_index", config, 0);
+  config.compact_orders = true;
+  run_memory_footprint("compact_orders+order_index", config, full);
+
+  config = orderbook_config_default();
+  run_teardown("rb_tree", config);
+  config.order_rings = true;
+  run_teardown("order_rings", config);
+
+  config = orderbook_config_default();
+  run_cold_start("default", config);
+  config = orderbook_config_sized(COLD_START_ORDERS, COLD_START_LEVELS);
+  run_cold_start("sized", config);
+  config.huge_pages = true;
+  run_cold_start("huge_pages", config);
+
+  config = orderbook_config_default();
+  run_tail_latency("rehash", config);
+  config.incremental_rehash = true;
+  run_tail_latency("incremental_rehash", config);
+
+  run_sinks();
+
+  run_batches(&state, 1);
+  run_batches(&state, 16);
+  run_batches(&state, 256);
+  printf("\n");
 
   // Deallocate memory
   free(state.messages);
 
   return 0;
-}
\ No newline at end of file
+}
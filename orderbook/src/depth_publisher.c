@@ -0,0 +1,126 @@
+#include "depth_publisher.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct depth_publisher depth_publisher_new(const char* name,
+                                           uint64_t book_id,
+                                           uint32_t depth) {
+  struct depth_publisher publisher = {.size = depth_snapshot_size(depth),
+                                      .touched = {true, true}};
+  if (strlen(name) > DEPTH_PUBLISHER_NAME_MAX) {
+    fprintf(stderr, "depth publisher name is too long: %s\n", name);
+    exit(1);
+  }
+  strcpy(publisher.name, name);
+
+  // readers of a segment left behind keep it until they close it, new ones
+  // only ever see this one
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1 || ftruncate(fd, publisher.size) == -1) {
+    fprintf(stderr, "failed to create shared memory segment %s\n", name);
+    exit(1);
+  }
+
+  void* mapped = mmap(NULL, publisher.size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    fprintf(stderr, "failed to map shared memory segment %s\n", name);
+    exit(1);
+  }
+
+  // the segment is zeroed, so it starts out with no levels on either side
+  publisher.snapshot = mapped;
+  publisher.snapshot->book_id = book_id;
+  publisher.snapshot->depth = depth;
+  __atomic_store_n(&publisher.snapshot->magic, DEPTH_SNAPSHOT_MAGIC,
+                   __ATOMIC_RELEASE);
+  return publisher;
+}
+
+void depth_publisher_free(struct depth_publisher* publisher) {
+  if (publisher->snapshot == NULL)
+    return;
+
+  __atomic_store_n(&publisher->snapshot->closed, true, __ATOMIC_RELEASE);
+  munmap(publisher->snapshot, publisher->size);
+  shm_unlink(publisher->name);
+  publisher->snapshot = NULL;
+}
+
+void depth_publisher_touch(struct depth_publisher* publisher,
+                           enum side side,
+                           uint64_t price) {
+  if (publisher->touched[side])
+    return;
+
+  // a level past the worst one published does not show, unless there is
+  // still room for it
+  const struct depth_snapshot* snapshot = publisher->snapshot;
+  uint32_t count = snapshot->count[side];
+  if (count < snapshot->depth) {
+    publisher->touched[side] = true;
+    return;
+  }
+
+  uint64_t worst = snapshot->levels[side * snapshot->depth + count - 1].price;
+  publisher->touched[side] = side == SIDE_BID ? price >= worst : price <= worst;
+}
+
+// only the fields that changed are written, so the cache lines of the levels
+// an update leaves alone stay valid in the caches of the readers
+static inline void _depth_publisher_store(struct depth_level* level,
+                                          const struct limit* limit) {
+  if (level->price != limit->price)
+    __atomic_store_n(&level->price, limit->price, __ATOMIC_RELAXED);
+  if (level->volume != limit->volume)
+    __atomic_store_n(&level->volume, limit->volume, __ATOMIC_RELAXED);
+  if (level->order_count != limit->order_count)
+    __atomic_store_n(&level->order_count, limit->order_count,
+                     __ATOMIC_RELAXED);
+}
+
+// copy the best levels of `tree` over the published ones, best first, writing
+// only those that differ
+void _depth_publisher_copy(struct depth_publisher* publisher,
+                           struct limit_tree* tree) {
+  struct depth_snapshot* snapshot = publisher->snapshot;
+  struct depth_level* levels = &snapshot->levels[tree->side * snapshot->depth];
+
+  uint32_t i = 0;
+  for (struct limit* limit = tree->best; limit != NULL && i < snapshot->depth;
+       limit = tree->side == SIDE_BID ? limit_tree_prev(tree, limit)
+                                      : limit_tree_next(tree, limit))
+    _depth_publisher_store(&levels[i++], limit);
+  if (snapshot->count[tree->side] != i)
+    __atomic_store_n(&snapshot->count[tree->side], i, __ATOMIC_RELAXED);
+}
+
+void depth_publisher_flush(struct depth_publisher* publisher,
+                           struct limit_tree* bid,
+                           struct limit_tree* ask,
+                           bool all) {
+  if (!all && !publisher->touched[SIDE_BID] && !publisher->touched[SIDE_ASK])
+    return;
+
+  // the odd sequence has to be visible before any of the levels change
+  struct depth_snapshot* snapshot = publisher->snapshot;
+  uint64_t sequence = snapshot->sequence;
+  __atomic_store_n(&snapshot->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  if (all || publisher->touched[SIDE_BID])
+    _depth_publisher_copy(publisher, bid);
+  if (all || publisher->touched[SIDE_ASK])
+    _depth_publisher_copy(publisher, ask);
+  publisher->touched[SIDE_BID] = publisher->touched[SIDE_ASK] = false;
+
+  // and the levels before the even one
+  __atomic_store_n(&snapshot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
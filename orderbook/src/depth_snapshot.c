@@ -0,0 +1,95 @@
+#include "depth_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "limit.h"
+
+size_t depth_snapshot_size(uint32_t depth) {
+  return sizeof(struct depth_snapshot) +
+         2 * (size_t)depth * sizeof(struct depth_level);
+}
+
+bool depth_reader_open(const char* name, struct depth_reader* reader) {
+  *reader = (struct depth_reader){0};
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd == -1)
+    return false;
+
+  // a segment still being set up may not have its full size yet
+  struct stat stat;
+  if (fstat(fd, &stat) == -1 ||
+      (size_t)stat.st_size < sizeof(struct depth_snapshot)) {
+    close(fd);
+    return false;
+  }
+
+  void* mapped = mmap(NULL, stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps the segment
+  if (mapped == MAP_FAILED)
+    return false;
+
+  const struct depth_snapshot* snapshot = mapped;
+  if (__atomic_load_n(&snapshot->magic, __ATOMIC_ACQUIRE) !=
+          DEPTH_SNAPSHOT_MAGIC ||
+      depth_snapshot_size(snapshot->depth) > (size_t)stat.st_size) {
+    munmap(mapped, stat.st_size);
+    return false;
+  }
+
+  *reader = (struct depth_reader){.snapshot = snapshot,
+                                  .size = stat.st_size};
+  return true;
+}
+
+void depth_reader_close(struct depth_reader* reader) {
+  if (reader->snapshot != NULL)
+    munmap((void*)reader->snapshot, reader->size);
+  *reader = (struct depth_reader){0};
+}
+
+static inline struct depth_level _depth_level_load(
+    const struct depth_level* level) {
+  return (struct depth_level){
+      .price = __atomic_load_n(&level->price, __ATOMIC_RELAXED),
+      .volume = __atomic_load_n(&level->volume, __ATOMIC_RELAXED),
+      .order_count = __atomic_load_n(&level->order_count, __ATOMIC_RELAXED)};
+}
+
+bool depth_reader_read(const struct depth_reader* reader,
+                       struct depth_level* levels,
+                       uint32_t count[2],
+                       uint64_t* sequence) {
+  const struct depth_snapshot* snapshot = reader->snapshot;
+  const uint32_t depth = snapshot->depth;
+
+  for (uint32_t retries = 0; retries < DEPTH_READER_RETRIES; retries++) {
+    *sequence = __atomic_load_n(&snapshot->sequence, __ATOMIC_ACQUIRE);
+    if (*sequence & 1) {  // the publisher is halfway through an update
+      if (__atomic_load_n(&snapshot->closed, __ATOMIC_ACQUIRE))
+        return false;  // that it will never finish
+      continue;
+    }
+
+    // a torn count is caught by the sequence check, but must not overflow
+    // `levels` before that
+    for (enum side side = SIDE_BID; side <= SIDE_ASK; side++) {
+      count[side] = __atomic_load_n(&snapshot->count[side], __ATOMIC_RELAXED);
+      if (count[side] > depth)
+        count[side] = depth;
+    }
+    for (uint32_t i = 0; i < count[SIDE_BID]; i++)
+      levels[i] = _depth_level_load(&snapshot->levels[i]);
+    for (uint32_t i = depth; i < depth + count[SIDE_ASK]; i++)
+      levels[i] = _depth_level_load(&snapshot->levels[i]);
+
+    // the levels have to be read before the sequence is checked again
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&snapshot->sequence, __ATOMIC_RELAXED) == *sequence)
+      return true;
+  }
+
+  return false;
+}
@@ -1,9 +1,29 @@
 #include "event_handler.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 
 struct event_handler event_handler_new() {
   struct event_handler event_handler = {.handle_order_event = NULL,
                                         .handle_trade_event = NULL};
   return event_handler;
-}
\ No newline at end of file
+}
+
+struct event_handler event_handler_with_batch(
+    void (*handle_batch)(uint64_t ob_id,
+                         struct event* events,
+                         uint32_t n,
+                         void* user_data),
+    struct event* batch,
+    uint32_t batch_capacity) {
+  if (batch == NULL || batch_capacity == 0) {
+    fprintf(stderr, "event handler batch must hold at least one event\n");
+    exit(1);
+  }
+
+  struct event_handler event_handler = event_handler_new();
+  event_handler.handle_batch = handle_batch;
+  event_handler.batch = batch;
+  event_handler.batch_capacity = batch_capacity;
+  return event_handler;
+}
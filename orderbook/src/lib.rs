@@ -2,9 +2,13 @@
 #![allow(non_camel_case_types)]
 #![allow(non_snake_case)]
 
-use std::{cell::UnsafeCell, ffi::CStr, os::raw::c_void};
+use std::{
+    cell::UnsafeCell,
+    ffi::{CStr, CString},
+    os::raw::c_void,
+};
 
-use libffi::high::{CType, ClosureMut3};
+use libffi::high::{CType, ClosureMut3, ClosureMut4};
 
 pub mod ffi {
     include!(concat!(env!("OUT_DIR"), "/bindings.rs"));
@@ -36,6 +40,7 @@ impl From<ffi::orderbook_error> for OrderbookError {
 pub enum RejectReason {
     NoError,
     NoLiquidity,
+    WouldCross,
 }
 
 impl From<ffi::reject_reason> for RejectReason {
@@ -43,6 +48,7 @@ impl From<ffi::reject_reason> for RejectReason {
         match value {
             ffi::reject_reason_REJECT_REASON_NO_ERROR => Self::NoError,
             ffi::reject_reason_REJECT_REASON_NO_LIQUIDITY => Self::NoLiquidity,
+            ffi::reject_reason_REJECT_REASON_WOULD_CROSS => Self::WouldCross,
             _ => unreachable!(),
         }
     }
@@ -92,6 +98,52 @@ impl From<Side> for ffi::side {
     }
 }
 
+/// How long an order placed with [`Orderbook::place`] stays in the book.
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub enum TimeInForce {
+    /// Rest whatever is not filled right away
+    #[default]
+    Gtc,
+    /// Cancel whatever is not filled right away
+    Ioc,
+    /// Fill entirely right away or reject
+    Fok,
+}
+
+impl From<TimeInForce> for ffi::time_in_force {
+    fn from(value: TimeInForce) -> Self {
+        match value {
+            TimeInForce::Gtc => ffi::time_in_force_TIME_IN_FORCE_GTC,
+            TimeInForce::Ioc => ffi::time_in_force_TIME_IN_FORCE_IOC,
+            TimeInForce::Fok => ffi::time_in_force_TIME_IN_FORCE_FOK,
+        }
+    }
+}
+
+/// What an order placed with [`Orderbook::place_trigger`] becomes once triggered.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum TriggerType {
+    /// Market order, against the price move
+    Stop,
+    /// Limit order, against the price move
+    StopLimit,
+    /// Market order, with the price move
+    TakeProfit,
+    /// Limit order, with the price move
+    TakeProfitLimit,
+}
+
+impl From<TriggerType> for ffi::trigger_type {
+    fn from(value: TriggerType) -> Self {
+        match value {
+            TriggerType::Stop => ffi::trigger_type_TRIGGER_TYPE_STOP,
+            TriggerType::StopLimit => ffi::trigger_type_TRIGGER_TYPE_STOP_LIMIT,
+            TriggerType::TakeProfit => ffi::trigger_type_TRIGGER_TYPE_TAKE_PROFIT,
+            TriggerType::TakeProfitLimit => ffi::trigger_type_TRIGGER_TYPE_TAKE_PROFIT_LIMIT,
+        }
+    }
+}
+
 /// Orderbook that supports a maker-taker (limit-market) scheme. Note that the actual data
 /// structure and its operations are implemented in C. This struct provides a safe wrapper
 /// around the underlying C code through FFI.
@@ -108,12 +160,27 @@ impl Orderbook {
         }
     }
 
+    /// Creates a new orderbook with the given configuration, eg. to use a dense price ladder
+    /// instead of the default red-black tree.
+    pub fn with_config(config: ffi::orderbook_config) -> Self {
+        Self {
+            ob: UnsafeCell::new(unsafe { ffi::orderbook_new_with_config(config) }),
+        }
+    }
+
     /// Attach an event handler to handle orderbook events such as partial fills, etc.
     pub fn with_event_handler(self, handler: *mut ffi::event_handler) -> Self {
         unsafe { ffi::orderbook_set_event_handler(self.ob.get(), handler) }
         self
     }
 
+    /// Keep the best levels of the book in the shared memory segment of `publisher`, see
+    /// [`DepthPublisher`]. The publisher must outlive the book.
+    pub fn with_depth_publisher(self, publisher: *mut ffi::depth_publisher) -> Self {
+        unsafe { ffi::orderbook_set_depth_publisher(self.ob.get(), publisher) }
+        self
+    }
+
     /// Attach an id to the orderbook
     pub fn with_id(mut self, id: u64) -> Self {
         self.ob.get_mut().id = id;
@@ -129,6 +196,23 @@ impl Orderbook {
         unsafe { tree.best.as_ref() }
     }
 
+    /// The best bid and ask as of the end of the last operation, see [`TopOfBookReader`] to read
+    /// them from other threads.
+    pub fn top_of_book(&self) -> ffi::top_of_book_quote {
+        unsafe { ffi::top_of_book_read((*self.ob.get()).top_of_book) }
+    }
+
+    /// A handle to read the best bid and ask from any thread while the book keeps matching.
+    ///
+    /// # Safety
+    ///
+    /// The reader points into the book, it must not be used after the book is dropped.
+    pub unsafe fn top_of_book_reader(&self) -> TopOfBookReader {
+        TopOfBookReader {
+            top: (*self.ob.get()).top_of_book,
+        }
+    }
+
     /// Read the top N bids or asks from the book
     pub fn top_n(&self, side: Side, n: u32) -> Vec<ffi::limit> {
         let mut limits = Vec::with_capacity(n as usize);
@@ -144,6 +228,42 @@ impl Orderbook {
         limits
     }
 
+    /// The volume an order on `side` priced at `price` could take right away, summed up in
+    /// O(log n) when the book is configured with `depth_aggregates`.
+    pub fn volume_to_price(&self, side: Side, price: u64) -> u64 {
+        unsafe { ffi::orderbook_volume_to_price(self.ob.get(), side.into(), price) }
+    }
+
+    /// How many orders and how much volume are queued ahead of a resting order, in O(log n)
+    /// when the book is configured with `queue_positions`.
+    pub fn queue_position(&self, order_id: u64) -> Result<ffi::queue_position, OrderbookError> {
+        let mut position = ffi::queue_position {
+            orders_ahead: 0,
+            volume_ahead: 0,
+        };
+        let err = unsafe { ffi::orderbook_queue_position(self.ob.get(), order_id, &mut position) };
+        match err {
+            ffi::orderbook_error_OBERR_OKAY => Ok(position),
+            err => Err(OrderbookError::from(err)),
+        }
+    }
+
+    /// The size a market order on `side` could fill of `size`, the worst price it would reach
+    /// and its total cost, without matching anything.
+    pub fn cost_to_fill(&self, side: Side, size: u64) -> ffi::limit_tree_fill {
+        unsafe { ffi::orderbook_cost_to_fill(self.ob.get(), side.into(), size) }
+    }
+
+    /// A copy of the `depth` best levels of each side, or of all of them if `depth` is 0, to
+    /// simulate executions against without touching the book. The [`Fork`] can be sent to
+    /// another thread while the book keeps matching, but the copy is made here, so a full fork
+    /// with `depth` 0 holds up the matching for O(levels) on a deep book.
+    pub fn fork(&self, depth: u32) -> Fork {
+        Fork {
+            fork: unsafe { ffi::orderbook_fork(self.ob.get(), depth) },
+        }
+    }
+
     /// Place a limit order. Always a maker order (adding volume to the book).
     pub fn limit(&mut self, order: ffi::order) {
         unsafe { ffi::orderbook_limit(self.ob.get(), order) }
@@ -173,7 +293,30 @@ impl Orderbook {
         }
     }
 
-    /// Cancel a limit order.
+    /// Place a limit order, matching it against every level that crosses its price first.
+    /// Whatever is left rests or is cancelled depending on `time_in_force`, and a `post_only`
+    /// order is rejected rather than taking liquidity.
+    ///
+    /// Note that the function returns a `u64` representing the remaining size that has not been
+    /// filled, including the part left to rest in the book.
+    pub fn place(&mut self, order: ffi::order, time_in_force: TimeInForce, post_only: bool) -> u64 {
+        unsafe { ffi::orderbook_place(self.ob.get(), order, time_in_force.into(), post_only) }
+    }
+
+    /// Place a stop or take profit order, held back until the last price reaches
+    /// `trigger_price`. `order.price` is the limit price for the limit types.
+    pub fn place_trigger(
+        &mut self,
+        order: ffi::order,
+        trigger_type: TriggerType,
+        trigger_price: u64,
+    ) {
+        unsafe {
+            ffi::orderbook_place_trigger(self.ob.get(), order, trigger_type.into(), trigger_price)
+        }
+    }
+
+    /// Cancel a limit order, or a stop / take profit order that is still pending.
     pub fn cancel(&mut self, order_id: u64) -> Result<(), OrderbookError> {
         let err = unsafe { ffi::orderbook_cancel(self.ob.get(), order_id) };
         match err {
@@ -190,6 +333,68 @@ impl Orderbook {
             err => Err(OrderbookError::from(err)),
         }
     }
+
+    /// Cancel every order in the book, returning how many were cancelled. A cancelled
+    /// [`OrderEvent`] is emitted per order, or a single [`MassCancelEvent`] per side if
+    /// `summarise` is set. Pending triggers placed with [`Self::place_trigger`] are cancelled
+    /// and counted too.
+    pub fn cancel_all(&mut self, summarise: bool) -> u64 {
+        unsafe { ffi::orderbook_cancel_all(self.ob.get(), summarise) }
+    }
+
+    /// Cancel every order on one side of the book, see [`Self::cancel_all`].
+    pub fn cancel_side(&mut self, side: Side, summarise: bool) -> u64 {
+        unsafe { ffi::orderbook_cancel_side(self.ob.get(), side.into(), summarise) }
+    }
+
+    /// Cancel the orders on one side priced within `prices`, see [`Self::cancel_all`]. Pending
+    /// triggers are not covered.
+    pub fn cancel_range(
+        &mut self,
+        side: Side,
+        prices: std::ops::RangeInclusive<u64>,
+        summarise: bool,
+    ) -> u64 {
+        unsafe {
+            ffi::orderbook_cancel_range(
+                self.ob.get(),
+                side.into(),
+                *prices.start(),
+                *prices.end(),
+                summarise,
+            )
+        }
+    }
+
+    /// Cancel the orders placed with `user_data` as their owner, see [`Self::cancel_all`].
+    pub fn cancel_owner(&mut self, user_data: *mut c_void, summarise: bool) -> u64 {
+        unsafe { ffi::orderbook_cancel_owner(self.ob.get(), user_data, summarise) }
+    }
+
+    /// Empty the book for reuse, keeping its memory and configuration. Unlike
+    /// [`Self::cancel_all`] no event is emitted, and pending triggers are dropped too.
+    pub fn reset(&mut self) {
+        unsafe { ffi::orderbook_reset(self.ob.get()) }
+    }
+
+    /// Process a batch of commands in order, writing the result of each to `results`, which must be
+    /// at least as long as `commands` when given.
+    pub fn process_batch(
+        &mut self,
+        commands: &[ffi::ob_command],
+        results: Option<&mut [ffi::ob_result]>,
+    ) {
+        let results = match results {
+            Some(results) => {
+                assert!(results.len() >= commands.len());
+                results.as_mut_ptr()
+            }
+            None => std::ptr::null_mut(),
+        };
+        unsafe {
+            ffi::orderbook_process_batch(self.ob.get(), commands.as_ptr(), commands.len(), results)
+        }
+    }
 }
 
 impl std::fmt::Display for Orderbook {
@@ -216,6 +421,182 @@ impl Drop for Orderbook {
     }
 }
 
+/// Reads the best bid and ask an [`Orderbook`] publishes after every operation, from any thread.
+/// Reading never blocks the book, it only retries while an update is being written.
+#[derive(Clone, Copy)]
+pub struct TopOfBookReader {
+    top: *const ffi::top_of_book,
+}
+
+// The record is only ever read here, with atomics under its seqlock
+unsafe impl Send for TopOfBookReader {}
+unsafe impl Sync for TopOfBookReader {}
+
+impl TopOfBookReader {
+    /// The last update published, never a mix of two
+    pub fn read(&self) -> ffi::top_of_book_quote {
+        unsafe { ffi::top_of_book_read(self.top) }
+    }
+}
+
+/// Keeps the best levels of an [`Orderbook`] in a POSIX shared memory segment, for other processes
+/// to read with a [`DepthReader`]. Attach it with [`Orderbook::with_depth_publisher`].
+pub struct DepthPublisher {
+    publisher: Box<ffi::depth_publisher>,
+}
+
+impl DepthPublisher {
+    /// Creates the segment `name`, eg. "/orderbook-1", with room for `depth` levels a side.
+    pub fn new(name: &str, book_id: u64, depth: u32) -> Self {
+        let name = CString::new(name).expect("segment name must not contain a nul byte");
+        Self {
+            publisher: Box::new(unsafe { ffi::depth_publisher_new(name.as_ptr(), book_id, depth) }),
+        }
+    }
+
+    pub fn as_mut_ptr(&mut self) -> *mut ffi::depth_publisher {
+        &mut *self.publisher
+    }
+}
+
+impl Drop for DepthPublisher {
+    fn drop(&mut self) {
+        unsafe { ffi::depth_publisher_free(&mut *self.publisher) }
+    }
+}
+
+/// Maps the segment of a [`DepthPublisher`], usually from another process, and reads the levels
+/// straight out of it without any system call.
+pub struct DepthReader {
+    reader: ffi::depth_reader,
+    levels: Vec<ffi::depth_level>,
+}
+
+// The segment is only ever read here, with atomics under its seqlock
+unsafe impl Send for DepthReader {}
+
+impl DepthReader {
+    /// Maps the segment `name`, or returns `None` if it is not there or not set up yet.
+    pub fn open(name: &str) -> Option<Self> {
+        let name = CString::new(name).ok()?;
+        let mut reader = ffi::depth_reader {
+            snapshot: std::ptr::null(),
+            size: 0,
+        };
+        if !unsafe { ffi::depth_reader_open(name.as_ptr(), &mut reader) } {
+            return None;
+        }
+
+        let depth = unsafe { (*reader.snapshot).depth } as usize;
+        let empty = ffi::depth_level {
+            price: 0,
+            volume: 0,
+            order_count: 0,
+        };
+        Some(Self {
+            reader,
+            levels: vec![empty; 2 * depth],
+        })
+    }
+
+    /// Levels each side has room for
+    pub fn depth(&self) -> u32 {
+        unsafe { (*self.reader.snapshot).depth }
+    }
+
+    /// Whether the publisher is gone, the levels read are then the last ones it published.
+    pub fn is_closed(&self) -> bool {
+        unsafe { std::ptr::read_volatile(&(*self.reader.snapshot).closed) }
+    }
+
+    /// Read the last update published, returning its sequence, the bids highest first and the
+    /// asks lowest first. Returns `None` if the publisher left an update unfinished, eg. because
+    /// it died halfway through it, see [`DepthReader::is_closed`].
+    pub fn read(&mut self) -> Option<(u64, &[ffi::depth_level], &[ffi::depth_level])> {
+        let depth = self.depth() as usize;
+        let mut count = [0u32; 2];
+        let mut sequence = 0;
+        let read = unsafe {
+            ffi::depth_reader_read(
+                &self.reader,
+                self.levels.as_mut_ptr(),
+                count.as_mut_ptr(),
+                &mut sequence,
+            )
+        };
+        if !read {
+            return None;
+        }
+        Some((
+            sequence,
+            &self.levels[..count[ffi::side_SIDE_BID as usize] as usize],
+            &self.levels[depth..depth + count[ffi::side_SIDE_ASK as usize] as usize],
+        ))
+    }
+}
+
+impl Drop for DepthReader {
+    fn drop(&mut self) {
+        unsafe { ffi::depth_reader_close(&mut self.reader) }
+    }
+}
+
+/// Levels copied off an [`Orderbook`] by [`Orderbook::fork`] to simulate executions against.
+/// Clones share the copied levels and only keep track of what their own executions took.
+pub struct Fork {
+    fork: ffi::orderbook_fork,
+}
+
+// The copied levels are never written to and their refcount is atomic
+unsafe impl Send for Fork {}
+
+impl Fork {
+    /// Simulate a market order on `side` for `size`, taking from the other side of the fork.
+    pub fn execute(&mut self, side: Side, size: u64) -> ffi::limit_tree_fill {
+        unsafe { ffi::orderbook_fork_execute(&mut self.fork, side.into(), size) }
+    }
+
+    /// What [`Fork::execute`] would return, without taking anything.
+    pub fn cost_to_fill(&mut self, side: Side, size: u64) -> ffi::limit_tree_fill {
+        unsafe { ffi::orderbook_fork_cost_to_fill(&mut self.fork, side.into(), size) }
+    }
+
+    /// Read the top N levels left on one side of the fork
+    pub fn top_n(&mut self, side: Side, n: u32) -> Vec<ffi::orderbook_fork_level> {
+        let mut levels = Vec::with_capacity(n as usize);
+        unsafe {
+            let i = ffi::orderbook_fork_top_n(
+                &mut self.fork,
+                side.into(),
+                n,
+                levels.spare_capacity_mut().as_mut_ptr() as *mut ffi::orderbook_fork_level,
+            );
+            levels.set_len(i as usize);
+        };
+        levels
+    }
+
+    /// Price of the last simulated trade, or of the last trade of the book before it.
+    pub fn last_price(&self) -> u64 {
+        self.fork.last_price
+    }
+}
+
+impl Clone for Fork {
+    fn clone(&self) -> Self {
+        let mut fork = self.fork;
+        Self {
+            fork: unsafe { ffi::orderbook_fork_clone(&mut fork) },
+        }
+    }
+}
+
+impl Drop for Fork {
+    fn drop(&mut self) {
+        unsafe { ffi::orderbook_fork_free(&mut self.fork) }
+    }
+}
+
 /// Type of an order event, it is embedded in [`OrderEvent`].
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub enum OrderStatus {
@@ -225,6 +606,8 @@ pub enum OrderStatus {
     Filled,
     PartiallyFilled,
     PartiallyFilledCancelled,
+    PendingTrigger,
+    Triggered,
 }
 
 impl From<ffi::order_status> for OrderStatus {
@@ -238,6 +621,8 @@ impl From<ffi::order_status> for OrderStatus {
             ffi::order_status_ORDER_STATUS_PARTIALLY_FILLED_CANCELLED => {
                 Self::PartiallyFilledCancelled
             }
+            ffi::order_status_ORDER_STATUS_PENDING_TRIGGER => Self::PendingTrigger,
+            ffi::order_status_ORDER_STATUS_TRIGGERED => Self::Triggered,
             _ => unreachable!(),
         }
     }
@@ -293,11 +678,85 @@ impl From<ffi::trade_event> for TradeEvent {
     }
 }
 
+/// Summary of the orders of one side removed by a mass cancel.
+#[derive(Debug, Clone, PartialEq)]
+pub struct MassCancelEvent {
+    pub side: Side,
+    pub order_count: u64,
+    pub size: u64,
+}
+
+impl From<ffi::mass_cancel_event> for MassCancelEvent {
+    fn from(value: ffi::mass_cancel_event) -> Self {
+        Self {
+            side: value.side.into(),
+            order_count: value.order_count,
+            size: value.size,
+        }
+    }
+}
+
+/// New state of a price level changed by an operation, a volume and count of 0 once the
+/// level has been emptied.
+#[derive(Debug, Clone, PartialEq)]
+pub struct LevelUpdateEvent {
+    pub side: Side,
+    pub price: u64,
+    pub volume: u64,
+    pub order_count: u64,
+}
+
+impl From<ffi::level_update_event> for LevelUpdateEvent {
+    fn from(value: ffi::level_update_event) -> Self {
+        Self {
+            side: value.side.into(),
+            price: value.price,
+            volume: value.volume,
+            order_count: value.order_count,
+        }
+    }
+}
+
+/// Any kind of event, as handed over in a batch.
+#[derive(Debug, Clone, PartialEq)]
+pub enum Event {
+    Order(OrderEvent),
+    Trade(TradeEvent),
+    MassCancel(MassCancelEvent),
+    LevelUpdate(LevelUpdateEvent),
+}
+
+impl From<&ffi::event> for Event {
+    fn from(value: &ffi::event) -> Self {
+        match value.type_ {
+            ffi::event_type_EVENT_TYPE_ORDER => {
+                Self::Order(unsafe { value.__bindgen_anon_1.order_event }.into())
+            }
+            ffi::event_type_EVENT_TYPE_TRADE => {
+                Self::Trade(unsafe { value.__bindgen_anon_1.trade_event }.into())
+            }
+            ffi::event_type_EVENT_TYPE_MASS_CANCEL => {
+                Self::MassCancel(unsafe { value.__bindgen_anon_1.mass_cancel_event }.into())
+            }
+            ffi::event_type_EVENT_TYPE_LEVEL_UPDATE => {
+                Self::LevelUpdate(unsafe { value.__bindgen_anon_1.level_update_event }.into())
+            }
+            _ => unreachable!(),
+        }
+    }
+}
+
+type BatchHandler<Ctx> = Box<dyn Fn(&mut Ctx, u64, &mut dyn Iterator<Item = Event>)>;
+
 /// A safe wrapper to help construct [`ffi::event_handler`] with an added feature of allowing
 /// dependency injection through context.
 pub struct EventHandlerBuilder<Ctx> {
     order_event_handler: Option<Box<dyn Fn(&mut Ctx, u64, OrderEvent)>>,
     trade_event_handler: Option<Box<dyn Fn(&mut Ctx, u64, TradeEvent)>>,
+    mass_cancel_event_handler: Option<Box<dyn Fn(&mut Ctx, u64, MassCancelEvent)>>,
+    level_update_event_handler: Option<Box<dyn Fn(&mut Ctx, u64, LevelUpdateEvent)>>,
+    level_updates: bool,
+    batch_handler: Option<(u32, BatchHandler<Ctx>)>,
     ctx: Ctx,
 }
 
@@ -306,6 +765,10 @@ impl<Ctx> EventHandlerBuilder<Ctx> {
         Self {
             order_event_handler: None,
             trade_event_handler: None,
+            mass_cancel_event_handler: None,
+            level_update_event_handler: None,
+            level_updates: false,
+            batch_handler: None,
             ctx,
         }
     }
@@ -320,6 +783,42 @@ impl<Ctx> EventHandlerBuilder<Ctx> {
         self
     }
 
+    pub fn on_mass_cancel(
+        mut self,
+        handler: impl Fn(&mut Ctx, u64, MassCancelEvent) + 'static,
+    ) -> Self {
+        self.mass_cancel_event_handler = Some(Box::new(handler));
+        self
+    }
+
+    /// Receive an update for each price level changed by an operation, once it is done.
+    pub fn on_level_update(
+        mut self,
+        handler: impl Fn(&mut Ctx, u64, LevelUpdateEvent) + 'static,
+    ) -> Self {
+        self.level_update_event_handler = Some(Box::new(handler));
+        self.level_updates = true;
+        self
+    }
+
+    /// Include [`Event::LevelUpdate`] in the batches of [`Self::on_batch`].
+    pub fn with_level_updates(mut self) -> Self {
+        self.level_updates = true;
+        self
+    }
+
+    /// Receive all the events of an operation in a single call instead, collected in a buffer
+    /// of `capacity` events. This takes over from the other handlers.
+    pub fn on_batch(
+        mut self,
+        capacity: u32,
+        handler: impl Fn(&mut Ctx, u64, &mut dyn Iterator<Item = Event>) + 'static,
+    ) -> Self {
+        assert!(capacity > 0, "batch capacity must not be 0");
+        self.batch_handler = Some((capacity, Box::new(handler)));
+        self
+    }
+
     pub fn build(self) -> ffi::event_handler {
         ffi::event_handler::from(self)
     }
@@ -361,6 +860,64 @@ impl<Ctx> From<EventHandlerBuilder<Ctx>> for ffi::event_handler {
             event_handler.handle_trade_event = Some(ptr);
         }
 
+        if let Some(handler) = value.mass_cancel_event_handler {
+            let closure = Box::leak(Box::new(
+                move |ob_id: u64, event: ffi::mass_cancel_event, user_data: *mut c_void| {
+                    let ctx = user_data as *mut Ctx;
+                    handler(unsafe { ctx.as_mut() }.unwrap(), ob_id, event.into());
+                },
+            ));
+            let callback = ClosureMut3::new(closure);
+            let &code = callback.code_ptr();
+            let ptr: unsafe extern "C" fn(u64, ffi::mass_cancel_event, *mut c_void) =
+                unsafe { std::mem::transmute(code) };
+            std::mem::forget(callback);
+            event_handler.handle_mass_cancel_event = Some(ptr);
+        }
+
+        if let Some(handler) = value.level_update_event_handler {
+            let closure = Box::leak(Box::new(
+                move |ob_id: u64, event: ffi::level_update_event, user_data: *mut c_void| {
+                    let ctx = user_data as *mut Ctx;
+                    handler(unsafe { ctx.as_mut() }.unwrap(), ob_id, event.into());
+                },
+            ));
+            let callback = ClosureMut3::new(closure);
+            let &code = callback.code_ptr();
+            let ptr: unsafe extern "C" fn(u64, ffi::level_update_event, *mut c_void) =
+                unsafe { std::mem::transmute(code) };
+            std::mem::forget(callback);
+            event_handler.handle_level_update_event = Some(ptr);
+        }
+        event_handler.level_updates = value.level_updates;
+
+        if let Some((capacity, handler)) = value.batch_handler {
+            let closure = Box::leak(Box::new(
+                move |ob_id: u64, events: *mut ffi::event, n: u32, user_data: *mut c_void| {
+                    let ctx = user_data as *mut Ctx;
+                    let events = unsafe { std::slice::from_raw_parts(events, n as usize) };
+                    handler(
+                        unsafe { ctx.as_mut() }.unwrap(),
+                        ob_id,
+                        &mut events.iter().map(Event::from),
+                    );
+                },
+            ));
+            let callback = ClosureMut4::new(closure);
+            let &code = callback.code_ptr();
+            let ptr: unsafe extern "C" fn(u64, *mut ffi::event, u32, *mut c_void) =
+                unsafe { std::mem::transmute(code) };
+            std::mem::forget(callback);
+
+            // the buffer is leaked along with the closure, it must outlive the handler
+            let batch: Vec<ffi::event> = (0..capacity)
+                .map(|_| unsafe { std::mem::zeroed() })
+                .collect();
+            event_handler.handle_batch = Some(ptr);
+            event_handler.batch = Box::leak(batch.into_boxed_slice()).as_mut_ptr();
+            event_handler.batch_capacity = capacity;
+        }
+
         event_handler
     }
 }
@@ -394,6 +951,31 @@ unsafe impl CType for ffi::trade_event {
     type RetType = ffi::trade_event;
 }
 
+unsafe impl CType for ffi::mass_cancel_event {
+    fn reify() -> libffi::high::Type<Self> {
+        libffi::high::Type::make(libffi::middle::Type::structure([
+            libffi::middle::Type::c_uint(), // side
+            libffi::middle::Type::u64(),    // order_count
+            libffi::middle::Type::u64(),    // size
+        ]))
+    }
+
+    type RetType = ffi::mass_cancel_event;
+}
+
+unsafe impl CType for ffi::level_update_event {
+    fn reify() -> libffi::high::Type<Self> {
+        libffi::high::Type::make(libffi::middle::Type::structure([
+            libffi::middle::Type::c_uint(), // side
+            libffi::middle::Type::u64(),    // price
+            libffi::middle::Type::u64(),    // volume
+            libffi::middle::Type::u64(),    // order_count
+        ]))
+    }
+
+    type RetType = ffi::level_update_event;
+}
+
 #[cfg(test)]
 mod tests {
     use std::ptr;
@@ -410,7 +992,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -432,7 +1016,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -453,7 +1039,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -473,7 +1061,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -496,7 +1086,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -517,7 +1109,9 @@ mod tests {
             size: 10,
             cum_filled_size: 0,
             side: Side::Bid.into(),
+            ring_slot: 0,
             limit: ptr::null_mut(),
+            queue_slot: 0,
             prev: ptr::null_mut(),
             next: ptr::null_mut(),
             user_data: ptr::null_mut(),
@@ -528,4 +1122,181 @@ mod tests {
         order_size = unsafe { (*(*ob.ob.get_mut().bid).best).volume };
         assert_eq!(order_size, 100);
     }
+
+    #[test]
+    fn test_mass_cancel() {
+        let mut ob = Orderbook::new();
+        for order_id in 1..=4 {
+            ob.limit(ffi::order {
+                order_id,
+                price: 1000 + order_id,
+                size: 10,
+                cum_filled_size: 0,
+                side: Side::Bid.into(),
+                ring_slot: 0,
+                limit: ptr::null_mut(),
+                queue_slot: 0,
+                prev: ptr::null_mut(),
+                next: ptr::null_mut(),
+                user_data: ptr::null_mut(),
+            });
+        }
+        assert_eq!(ob.cancel_range(Side::Bid, 1002..=1003, false), 2);
+        assert!(ob.best(Side::Bid).is_some_and(|best| best.price == 1004));
+        assert_eq!(ob.cancel_all(true), 2);
+        assert!(ob.best(Side::Bid).is_none());
+
+        ob.limit(ffi::order {
+            order_id: 1,
+            price: 1000,
+            size: 10,
+            cum_filled_size: 0,
+            side: Side::Ask.into(),
+            ring_slot: 0,
+            limit: ptr::null_mut(),
+            queue_slot: 0,
+            prev: ptr::null_mut(),
+            next: ptr::null_mut(),
+            user_data: ptr::null_mut(),
+        });
+        ob.reset();
+        assert!(ob.best(Side::Ask).is_none());
+    }
+
+    #[test]
+    fn test_depth_and_queue_queries() {
+        let mut config = unsafe { ffi::orderbook_config_default() };
+        config.depth_aggregates = true;
+        config.queue_positions = true;
+        let mut ob = Orderbook::with_config(config);
+        for order_id in 1..=3 {
+            ob.limit(ffi::order {
+                order_id,
+                price: 100 + order_id,
+                size: order_id,
+                cum_filled_size: 0,
+                side: Side::Ask.into(),
+                ring_slot: 0,
+                limit: ptr::null_mut(),
+                queue_slot: 0,
+                prev: ptr::null_mut(),
+                next: ptr::null_mut(),
+                user_data: ptr::null_mut(),
+            });
+        }
+        assert_eq!(ob.queue_position(3).unwrap().orders_ahead, 0);
+        assert_eq!(ob.volume_to_price(Side::Bid, 102), 3);
+        let fill = ob.cost_to_fill(Side::Bid, 4);
+        assert_eq!(
+            (fill.size, fill.worst_price, fill.cost),
+            (4, 103, 101 + 2 * 102 + 103)
+        );
+    }
+
+    #[test]
+    fn test_top_of_book() {
+        let mut ob = Orderbook::new();
+        let reader = unsafe { ob.top_of_book_reader() };
+        let handle = std::thread::spawn(move || {
+            // wait for both orders to be in
+            while reader.read().sequence < 4 {
+                std::hint::spin_loop();
+            }
+            let quote = reader.read();
+            (quote.bid.price, quote.ask.price)
+        });
+
+        for order_id in 1..=2 {
+            ob.limit(ffi::order {
+                order_id,
+                price: 98 + 2 * order_id,
+                size: 1,
+                cum_filled_size: 0,
+                side: if order_id == 1 { Side::Bid } else { Side::Ask }.into(),
+                ring_slot: 0,
+                limit: ptr::null_mut(),
+                queue_slot: 0,
+                prev: ptr::null_mut(),
+                next: ptr::null_mut(),
+                user_data: ptr::null_mut(),
+            });
+        }
+        assert_eq!(handle.join().unwrap(), (100, 102));
+        assert_eq!(ob.top_of_book().bid.volume, 1);
+    }
+
+    #[test]
+    fn test_depth_publisher() {
+        let name = format!("/orderbook-rs-test-{}", std::process::id());
+        let mut publisher = DepthPublisher::new(&name, 1, 2);
+        let mut ob = Orderbook::new().with_depth_publisher(publisher.as_mut_ptr());
+        for order_id in 1..=3 {
+            ob.limit(ffi::order {
+                order_id,
+                price: 100 - order_id,
+                size: order_id,
+                cum_filled_size: 0,
+                side: Side::Bid.into(),
+                ring_slot: 0,
+                limit: ptr::null_mut(),
+                queue_slot: 0,
+                prev: ptr::null_mut(),
+                next: ptr::null_mut(),
+                user_data: ptr::null_mut(),
+            });
+        }
+
+        let mut reader = DepthReader::open(&name).unwrap();
+        assert_eq!(reader.depth(), 2);
+        let (_, bids, asks) = reader.read().unwrap();
+        assert_eq!(
+            bids.iter().map(|l| (l.price, l.volume)).collect::<Vec<_>>(),
+            vec![(99, 1), (98, 2)]
+        );
+        assert!(asks.is_empty());
+
+        drop(ob);
+        drop(publisher);
+        assert!(reader.is_closed());
+        assert!(DepthReader::open(&name).is_none());
+    }
+
+    #[test]
+    fn test_fork() {
+        let mut ob = Orderbook::new();
+        for order_id in 1..=3 {
+            ob.limit(ffi::order {
+                order_id,
+                price: 100 + order_id,
+                size: order_id,
+                cum_filled_size: 0,
+                side: Side::Ask.into(),
+                ring_slot: 0,
+                limit: ptr::null_mut(),
+                queue_slot: 0,
+                prev: ptr::null_mut(),
+                next: ptr::null_mut(),
+                user_data: ptr::null_mut(),
+            });
+        }
+
+        let mut fork = ob.fork(0);
+        let clone = fork.clone();
+        assert_eq!(fork.execute(Side::Bid, 2).cost, 101 + 102);
+        assert_eq!(fork.last_price(), 102);
+        let asks = fork.top_n(Side::Ask, 3);
+        assert_eq!(
+            asks.iter().map(|l| (l.price, l.volume)).collect::<Vec<_>>(),
+            vec![(102, 1), (103, 3)]
+        );
+
+        // the clone is untouched and can be used on another thread
+        let handle = std::thread::spawn(move || {
+            let mut clone = clone;
+            clone.execute(Side::Bid, 10).size
+        });
+        ob.execute(4, Side::Bid, 1, 1, true);
+        assert_eq!(handle.join().unwrap(), 6);
+        assert_eq!(ob.best(Side::Ask).unwrap().price, 102);
+    }
 }
@@ -2,18 +2,35 @@
 
 #include <stdlib.h>
 
-void limit_free(struct limit* limit) {
-  // free the order queue (a linked list)
+void limit_free(struct limit* limit, struct object_pool* order_pool) {
+  // free the order queue (a linked list or a ring)
   if (limit->order_head != NULL) {
     struct order* curr = limit->order_head;
     while (curr != NULL) {
-      struct order* next = curr->next;
-      free(curr);
+      struct order* next = limit_next_order(limit, curr);
+      if (order_pool != NULL)
+        object_pool_release(order_pool, curr);
+      else
+        free(curr);
       curr = next;
     }
   }
+
+  limit_free_queues(limit);
 }
 
 struct limit limit_default() {
   return (struct limit){};
-}
\ No newline at end of file
+}
+
+void limit_free_queues(struct limit* limit) {
+  order_fenwick_free(&limit->queue);
+  if (limit->ring.slots != NULL)
+    order_ring_free(&limit->ring);
+}
+
+struct order* limit_next_order(struct limit* limit, struct order* order) {
+  if (limit->ring.slots != NULL)
+    return order_ring_next(&limit->ring, order);
+  return order->next;
+}
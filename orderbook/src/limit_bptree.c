@@ -0,0 +1,349 @@
+#include "limit_bptree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct limit_bptree_node* _limit_bptree_node_new(bool leaf) {
+  struct limit_bptree_node* node =
+      aligned_alloc(64, sizeof(struct limit_bptree_node));
+  memset(node, 0, sizeof(struct limit_bptree_node));
+  node->leaf = leaf;
+  return node;
+}
+
+/**
+ * Index of the child to descend into for `price`, ie. the number of keys
+ * <= `price`.
+ */
+static inline uint8_t _limit_bptree_child_index(struct limit_bptree_node* node,
+                                                uint64_t price) {
+  uint8_t i = 0;
+  while (i < node->count && node->keys[i] <= price)
+    i++;
+  return i;
+}
+
+/**
+ * Index of the first key >= `price` in the node.
+ */
+static inline uint8_t _limit_bptree_lower_bound(struct limit_bptree_node* node,
+                                                uint64_t price) {
+  uint8_t i = 0;
+  while (i < node->count && node->keys[i] < price)
+    i++;
+  return i;
+}
+
+struct limit_bptree limit_bptree_new() {
+  return (struct limit_bptree){};
+}
+
+void _limit_bptree_free_nodes(struct limit_bptree_node* node) {
+  if (!node->leaf)
+    for (uint8_t i = 0; i <= node->count; i++)
+      _limit_bptree_free_nodes(node->children[i]);
+  free(node);
+}
+
+void limit_bptree_free(struct limit_bptree* tree) {
+  if (tree->root != NULL)
+    _limit_bptree_free_nodes(tree->root);
+  *tree = limit_bptree_new();
+}
+
+/**
+ * Walk down to the leaf for `price`, recording the inner nodes visited and the
+ * child taken in each. Returns the depth of the leaf.
+ */
+uint32_t _limit_bptree_descend(struct limit_bptree* tree,
+                               uint64_t price,
+                               struct limit_bptree_node** path,
+                               uint8_t* index) {
+  struct limit_bptree_node* node = tree->root;
+  uint32_t depth = 0;
+
+  while (!node->leaf) {
+    uint8_t i = _limit_bptree_child_index(node, price);
+    path[depth] = node;
+    index[depth] = i;
+    depth++;
+    node = node->children[i];
+  }
+
+  path[depth] = node;
+  return depth;
+}
+
+struct limit_bptree_node* _limit_bptree_find_leaf(struct limit_bptree* tree,
+                                                  uint64_t price) {
+  struct limit_bptree_node* node = tree->root;
+  while (!node->leaf)
+    node = node->children[_limit_bptree_child_index(node, price)];
+  return node;
+}
+
+bool limit_bptree_insert(struct limit_bptree* tree, struct limit* limit) {
+  const uint64_t price = limit->price;
+  tree->cursor = NULL;
+
+  if (tree->root == NULL) {  // first limit, the root is a leaf
+    struct limit_bptree_node* leaf = _limit_bptree_node_new(true);
+    leaf->keys[0] = price;
+    leaf->limits[0] = limit;
+    leaf->count = 1;
+    tree->root = tree->head = tree->tail = leaf;
+    tree->height = 1;
+    tree->size = 1;
+    return true;
+  }
+
+  struct limit_bptree_node* path[LIMIT_BPTREE_MAX_HEIGHT];
+  uint8_t index[LIMIT_BPTREE_MAX_HEIGHT];
+  uint32_t depth = _limit_bptree_descend(tree, price, path, index);
+  struct limit_bptree_node* leaf = path[depth];
+
+  uint8_t pos = _limit_bptree_lower_bound(leaf, price);
+  if (pos < leaf->count && leaf->keys[pos] == price)  // already exist
+    return false;
+
+  tree->size++;
+
+  if (leaf->count < LIMIT_BPTREE_LEAF_KEYS) {  // room in the leaf
+    memmove(&leaf->keys[pos + 1], &leaf->keys[pos],
+            (leaf->count - pos) * sizeof(uint64_t));
+    memmove(&leaf->limits[pos + 1], &leaf->limits[pos],
+            (leaf->count - pos) * sizeof(struct limit*));
+    leaf->keys[pos] = price;
+    leaf->limits[pos] = limit;
+    leaf->count++;
+    return true;
+  }
+
+  // split the full leaf, the upper half moves to a new leaf on the right
+  uint64_t keys[LIMIT_BPTREE_LEAF_KEYS + 1];
+  struct limit* limits[LIMIT_BPTREE_LEAF_KEYS + 1];
+  for (uint8_t i = 0, j = 0; i <= LIMIT_BPTREE_LEAF_KEYS; i++) {
+    if (i == pos) {
+      keys[i] = price;
+      limits[i] = limit;
+    } else {
+      keys[i] = leaf->keys[j];
+      limits[i] = leaf->limits[j];
+      j++;
+    }
+  }
+
+  const uint8_t left_count = (LIMIT_BPTREE_LEAF_KEYS + 2) / 2;
+  struct limit_bptree_node* right = _limit_bptree_node_new(true);
+  right->count = LIMIT_BPTREE_LEAF_KEYS + 1 - left_count;
+  memcpy(leaf->keys, keys, left_count * sizeof(uint64_t));
+  memcpy(leaf->limits, limits, left_count * sizeof(struct limit*));
+  memcpy(right->keys, &keys[left_count], right->count * sizeof(uint64_t));
+  memcpy(right->limits, &limits[left_count],
+         right->count * sizeof(struct limit*));
+  leaf->count = left_count;
+
+  right->prev = leaf;
+  right->next = leaf->next;
+  if (leaf->next != NULL)
+    leaf->next->prev = right;
+  else
+    tree->tail = right;
+  leaf->next = right;
+
+  // insert the separator into the parents, splitting them as we go up
+  uint64_t separator = right->keys[0];
+  struct limit_bptree_node* child = right;
+
+  while (depth-- > 0) {
+    struct limit_bptree_node* parent = path[depth];
+    uint8_t i = index[depth];
+
+    if (parent->count < LIMIT_BPTREE_INNER_KEYS) {  // room in the parent
+      memmove(&parent->keys[i + 1], &parent->keys[i],
+              (parent->count - i) * sizeof(uint64_t));
+      memmove(&parent->children[i + 2], &parent->children[i + 1],
+              (parent->count - i) * sizeof(struct limit_bptree_node*));
+      parent->keys[i] = separator;
+      parent->children[i + 1] = child;
+      parent->count++;
+      return true;
+    }
+
+    uint64_t inner_keys[LIMIT_BPTREE_INNER_KEYS + 1];
+    struct limit_bptree_node* children[LIMIT_BPTREE_INNER_KEYS + 2];
+    for (uint8_t k = 0, j = 0; k <= LIMIT_BPTREE_INNER_KEYS; k++)
+      inner_keys[k] = k == i ? separator : parent->keys[j++];
+    for (uint8_t k = 0, j = 0; k <= LIMIT_BPTREE_INNER_KEYS + 1; k++)
+      children[k] = k == i + 1 ? child : parent->children[j++];
+
+    // the middle key moves up, the keys after it go to a new node
+    const uint8_t middle = (LIMIT_BPTREE_INNER_KEYS + 1) / 2;
+    struct limit_bptree_node* sibling = _limit_bptree_node_new(false);
+    sibling->count = LIMIT_BPTREE_INNER_KEYS - middle;
+    memcpy(parent->keys, inner_keys, middle * sizeof(uint64_t));
+    memcpy(parent->children, children,
+           (middle + 1) * sizeof(struct limit_bptree_node*));
+    memcpy(sibling->keys, &inner_keys[middle + 1],
+           sibling->count * sizeof(uint64_t));
+    memcpy(sibling->children, &children[middle + 1],
+           (sibling->count + 1) * sizeof(struct limit_bptree_node*));
+    parent->count = middle;
+
+    separator = inner_keys[middle];
+    child = sibling;
+  }
+
+  // the root was split, grow the tree by one level
+  struct limit_bptree_node* root = _limit_bptree_node_new(false);
+  root->keys[0] = separator;
+  root->children[0] = tree->root;
+  root->children[1] = child;
+  root->count = 1;
+  tree->root = root;
+  tree->height++;
+
+  return true;
+}
+
+void limit_bptree_remove(struct limit_bptree* tree, struct limit* limit) {
+  if (tree->root == NULL)
+    return;
+
+  const uint64_t price = limit->price;
+  tree->cursor = NULL;
+
+  struct limit_bptree_node* path[LIMIT_BPTREE_MAX_HEIGHT];
+  uint8_t index[LIMIT_BPTREE_MAX_HEIGHT];
+  uint32_t depth = _limit_bptree_descend(tree, price, path, index);
+  struct limit_bptree_node* leaf = path[depth];
+
+  uint8_t pos = _limit_bptree_lower_bound(leaf, price);
+  if (pos == leaf->count || leaf->keys[pos] != price)  // not found
+    return;
+
+  memmove(&leaf->keys[pos], &leaf->keys[pos + 1],
+          (leaf->count - pos - 1) * sizeof(uint64_t));
+  memmove(&leaf->limits[pos], &leaf->limits[pos + 1],
+          (leaf->count - pos - 1) * sizeof(struct limit*));
+  leaf->count--;
+  tree->size--;
+
+  if (leaf->count > 0)
+    return;
+
+  // the leaf is empty, unlink it from the leaf list
+  if (leaf->prev != NULL)
+    leaf->prev->next = leaf->next;
+  else
+    tree->head = leaf->next;
+  if (leaf->next != NULL)
+    leaf->next->prev = leaf->prev;
+  else
+    tree->tail = leaf->prev;
+  free(leaf);
+
+  // remove it from the parents, an inner node left without children goes too
+  while (depth-- > 0) {
+    struct limit_bptree_node* parent = path[depth];
+    uint8_t i = index[depth];
+
+    if (parent->count == 0) {  // it was the only child
+      free(parent);
+      continue;
+    }
+
+    // drop the child and the key separating it from its neighbour
+    uint8_t key = i > 0 ? i - 1 : 0;
+    memmove(&parent->keys[key], &parent->keys[key + 1],
+            (parent->count - key - 1) * sizeof(uint64_t));
+    memmove(&parent->children[i], &parent->children[i + 1],
+            (parent->count - i) * sizeof(struct limit_bptree_node*));
+    parent->count--;
+
+    // an inner root with a single child is replaced by that child
+    while (!tree->root->leaf && tree->root->count == 0) {
+      struct limit_bptree_node* root = tree->root;
+      tree->root = root->children[0];
+      tree->height--;
+      free(root);
+    }
+    return;
+  }
+
+  // every node on the path was removed, the tree is empty
+  tree->root = tree->head = tree->tail = NULL;
+  tree->height = 0;
+}
+
+struct limit* limit_bptree_min(struct limit_bptree* tree) {
+  if (tree->head == NULL)
+    return NULL;
+
+  tree->cursor = tree->head;
+  tree->cursor_index = 0;
+  return tree->head->limits[0];
+}
+
+struct limit* limit_bptree_max(struct limit_bptree* tree) {
+  if (tree->tail == NULL)
+    return NULL;
+
+  tree->cursor = tree->tail;
+  tree->cursor_index = tree->tail->count - 1;
+  return tree->tail->limits[tree->cursor_index];
+}
+
+struct limit* limit_bptree_higher(struct limit_bptree* tree, uint64_t price) {
+  if (tree->root == NULL)
+    return NULL;
+
+  struct limit_bptree_node* leaf;
+  uint8_t pos;
+
+  if (tree->cursor != NULL && tree->cursor->keys[tree->cursor_index] == price) {
+    leaf = tree->cursor;  // continue from the last lookup
+    pos = tree->cursor_index + 1;
+  } else {
+    leaf = _limit_bptree_find_leaf(tree, price);
+    pos = _limit_bptree_child_index(leaf, price);  // first key > price
+  }
+
+  if (pos == leaf->count) {  // move on to the next leaf
+    leaf = leaf->next;
+    pos = 0;
+    if (leaf == NULL)
+      return NULL;
+  }
+
+  tree->cursor = leaf;
+  tree->cursor_index = pos;
+  return leaf->limits[pos];
+}
+
+struct limit* limit_bptree_lower(struct limit_bptree* tree, uint64_t price) {
+  if (tree->root == NULL)
+    return NULL;
+
+  struct limit_bptree_node* leaf;
+  uint8_t pos;
+
+  if (tree->cursor != NULL && tree->cursor->keys[tree->cursor_index] == price) {
+    leaf = tree->cursor;  // continue from the last lookup
+    pos = tree->cursor_index;
+  } else {
+    leaf = _limit_bptree_find_leaf(tree, price);
+    pos = _limit_bptree_lower_bound(leaf, price);  // keys before are < price
+  }
+
+  if (pos == 0) {  // move on to the previous leaf
+    leaf = leaf->prev;
+    if (leaf == NULL)
+      return NULL;
+    pos = leaf->count;
+  }
+
+  tree->cursor = leaf;
+  tree->cursor_index = pos - 1;
+  return leaf->limits[pos - 1];
+}
@@ -0,0 +1,268 @@
+#include "limit_ladder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "uint64_hashmap.h"
+
+#define LIMIT_LADDER_NONE UINT32_MAX
+
+/**
+ * Number of 64-bit words used by the given level of the bitmap.
+ */
+static inline uint32_t _limit_ladder_words(struct limit_ladder* ladder,
+                                           uint8_t level) {
+  uint64_t words = (uint64_t)ladder->capacity >> (6 * (level + 1));
+  return words == 0 ? 1 : words;  // capacity is a power of 2 >= 64
+}
+
+struct limit_ladder limit_ladder_new(uint64_t tick, uint32_t capacity) {
+  if (capacity < LIMIT_LADDER_MIN_CAPACITY)
+    capacity = LIMIT_LADDER_MIN_CAPACITY;
+  capacity = find_next_positive_power_of_two(capacity);
+
+  struct limit_ladder ladder = {
+      .tick = tick == 0 ? 1 : tick,
+      .capacity = capacity,
+      .slots = calloc(capacity, sizeof(struct limit)),
+  };
+
+  // keep adding levels until a single word summarises the level below
+  do {
+    uint32_t words = _limit_ladder_words(&ladder, ladder.levels);
+    ladder.bitmap[ladder.levels++] = calloc(words, sizeof(uint64_t));
+    if (words == 1)
+      break;
+  } while (ladder.levels < LIMIT_LADDER_MAX_LEVELS);
+
+  return ladder;
+}
+
+void limit_ladder_free(struct limit_ladder* ladder) {
+  for (uint8_t i = 0; i < ladder->levels; i++)
+    free(ladder->bitmap[i]);
+  free(ladder->slots);
+}
+
+void limit_ladder_clear(struct limit_ladder* ladder) {
+  for (uint8_t i = 0; i < ladder->levels; i++)
+    memset(ladder->bitmap[i], 0,
+           _limit_ladder_words(ladder, i) * sizeof(uint64_t));
+  ladder->size = 0;
+}
+
+uint64_t limit_ladder_base(struct limit_ladder* ladder, uint64_t price) {
+  uint64_t ticks = price / ladder->tick;
+  uint64_t half = ladder->capacity >> 1;
+  return (ticks >= half ? ticks - half : 0) * ladder->tick;
+}
+
+void limit_ladder_anchor(struct limit_ladder* ladder, uint64_t price) {
+  ladder->base = limit_ladder_base(ladder, price);
+}
+
+bool limit_ladder_contains(struct limit_ladder* ladder, uint64_t price) {
+  return price >= ladder->base && price % ladder->tick == 0 &&
+         (price - ladder->base) / ladder->tick < ladder->capacity;
+}
+
+bool limit_ladder_owns(struct limit_ladder* ladder, struct limit* limit) {
+  uintptr_t addr = (uintptr_t)limit;
+  return addr >= (uintptr_t)ladder->slots &&
+         addr < (uintptr_t)(ladder->slots + ladder->capacity);
+}
+
+static inline uint32_t _limit_ladder_slot(struct limit_ladder* ladder,
+                                          uint64_t price) {
+  return (price / ladder->tick) & (ladder->capacity - 1);
+}
+
+static inline bool _limit_ladder_is_set(struct limit_ladder* ladder,
+                                        uint32_t slot) {
+  return (ladder->bitmap[0][slot >> 6] >> (slot & 63)) & 1;
+}
+
+void _limit_ladder_set(struct limit_ladder* ladder, uint32_t slot) {
+  for (uint8_t level = 0; level < ladder->levels; level++) {
+    uint64_t* word = &ladder->bitmap[level][slot >> 6];
+    uint64_t before = *word;
+    *word |= UINT64_C(1) << (slot & 63);
+    if (before != 0)  // the levels above already know
+      break;
+    slot >>= 6;
+  }
+}
+
+void _limit_ladder_clear(struct limit_ladder* ladder, uint32_t slot) {
+  for (uint8_t level = 0; level < ladder->levels; level++) {
+    uint64_t* word = &ladder->bitmap[level][slot >> 6];
+    *word &= ~(UINT64_C(1) << (slot & 63));
+    if (*word != 0)  // word still has other bits, the levels above are intact
+      break;
+    slot >>= 6;
+  }
+}
+
+/**
+ * Find the lowest occupied slot >= `slot` (not wrapping around).
+ */
+uint32_t _limit_ladder_next_set(struct limit_ladder* ladder, uint32_t slot) {
+  uint8_t level = 0;
+
+  // walk up until a word has a set bit at or after the position
+  for (;;) {
+    if ((slot >> 6) >= _limit_ladder_words(ladder, level))
+      return LIMIT_LADDER_NONE;
+
+    uint64_t word =
+        ladder->bitmap[level][slot >> 6] & (~UINT64_C(0) << (slot & 63));
+    if (word != 0) {
+      slot = (slot & ~UINT32_C(63)) + __builtin_ctzll(word);
+      break;
+    }
+
+    if (level + 1 == ladder->levels)
+      return LIMIT_LADDER_NONE;
+    slot = (slot >> 6) + 1;
+    level++;
+  }
+
+  // walk down taking the lowest set bit
+  while (level-- > 0)
+    slot = (slot << 6) + __builtin_ctzll(ladder->bitmap[level][slot]);
+
+  return slot;
+}
+
+/**
+ * Find the highest occupied slot <= `slot` (not wrapping around).
+ */
+uint32_t _limit_ladder_prev_set(struct limit_ladder* ladder, uint32_t slot) {
+  uint8_t level = 0;
+
+  // walk up until a word has a set bit at or before the position
+  for (;;) {
+    uint64_t word = ladder->bitmap[level][slot >> 6] &
+                    (~UINT64_C(0) >> (63 - (slot & 63)));
+    if (word != 0) {
+      slot = (slot & ~UINT32_C(63)) + 63 - __builtin_clzll(word);
+      break;
+    }
+
+    if (level + 1 == ladder->levels || (slot >> 6) == 0)
+      return LIMIT_LADDER_NONE;
+    slot = (slot >> 6) - 1;
+    level++;
+  }
+
+  // walk down taking the highest set bit
+  while (level-- > 0)
+    slot = (slot << 6) + 63 - __builtin_clzll(ladder->bitmap[level][slot]);
+
+  return slot;
+}
+
+/**
+ * Find the occupied slot with the lowest window offset >= `offset`.
+ */
+struct limit* _limit_ladder_first_from(struct limit_ladder* ladder,
+                                       uint64_t offset) {
+  if (ladder->size == 0 || offset >= ladder->capacity)
+    return NULL;
+
+  const uint32_t mask = ladder->capacity - 1;
+  const uint32_t base_slot = _limit_ladder_slot(ladder, ladder->base);
+  const uint32_t start = (base_slot + offset) & mask;
+
+  // offsets map onto [base_slot, capacity) and then wrap onto [0, base_slot)
+  uint32_t slot = _limit_ladder_next_set(ladder, start);
+  if (start >= base_slot) {
+    if (slot == LIMIT_LADDER_NONE && base_slot > 0)
+      slot = _limit_ladder_next_set(ladder, 0);
+    if (slot != LIMIT_LADDER_NONE && slot < start && slot >= base_slot)
+      slot = LIMIT_LADDER_NONE;
+  } else if (slot != LIMIT_LADDER_NONE && slot >= base_slot) {
+    slot = LIMIT_LADDER_NONE;
+  }
+
+  return slot == LIMIT_LADDER_NONE ? NULL : &ladder->slots[slot];
+}
+
+/**
+ * Find the occupied slot with the highest window offset <= `offset`.
+ */
+struct limit* _limit_ladder_last_until(struct limit_ladder* ladder,
+                                       uint64_t offset) {
+  if (ladder->size == 0)
+    return NULL;
+  if (offset >= ladder->capacity)
+    offset = ladder->capacity - 1;
+
+  const uint32_t mask = ladder->capacity - 1;
+  const uint32_t base_slot = _limit_ladder_slot(ladder, ladder->base);
+  const uint32_t end = (base_slot + offset) & mask;
+
+  uint32_t slot = _limit_ladder_prev_set(ladder, end);
+  if (end >= base_slot) {
+    if (slot != LIMIT_LADDER_NONE && slot < base_slot)
+      slot = LIMIT_LADDER_NONE;
+  } else if (slot == LIMIT_LADDER_NONE) {
+    slot = _limit_ladder_prev_set(ladder, mask);
+    if (slot != LIMIT_LADDER_NONE && slot < base_slot)
+      slot = LIMIT_LADDER_NONE;
+  }
+
+  return slot == LIMIT_LADDER_NONE ? NULL : &ladder->slots[slot];
+}
+
+struct limit* limit_ladder_get(struct limit_ladder* ladder, uint64_t price) {
+  uint32_t slot = _limit_ladder_slot(ladder, price);
+  return _limit_ladder_is_set(ladder, slot) ? &ladder->slots[slot] : NULL;
+}
+
+struct limit* limit_ladder_insert(struct limit_ladder* ladder, uint64_t price) {
+  uint32_t slot = _limit_ladder_slot(ladder, price);
+  struct limit* limit = &ladder->slots[slot];
+
+  if (!_limit_ladder_is_set(ladder, slot)) {
+    *limit = (struct limit){.price = price};
+    _limit_ladder_set(ladder, slot);
+    ladder->size++;
+  }
+
+  return limit;
+}
+
+void limit_ladder_remove(struct limit_ladder* ladder, struct limit* limit) {
+  uint32_t slot = limit - ladder->slots;
+  if (!_limit_ladder_is_set(ladder, slot))
+    return;
+
+  _limit_ladder_clear(ladder, slot);
+  *limit = (struct limit){};
+  ladder->size--;
+}
+
+struct limit* limit_ladder_min(struct limit_ladder* ladder) {
+  return _limit_ladder_first_from(ladder, 0);
+}
+
+struct limit* limit_ladder_max(struct limit_ladder* ladder) {
+  return _limit_ladder_last_until(ladder, ladder->capacity - 1);
+}
+
+struct limit* limit_ladder_higher(struct limit_ladder* ladder, uint64_t price) {
+  if (price < ladder->base)
+    return limit_ladder_min(ladder);
+  return _limit_ladder_first_from(ladder,
+                                  (price - ladder->base) / ladder->tick + 1);
+}
+
+struct limit* limit_ladder_lower(struct limit_ladder* ladder, uint64_t price) {
+  if (price <= ladder->base)
+    return NULL;
+
+  // the highest offset strictly below `price`
+  return _limit_ladder_last_until(ladder,
+                                  (price - ladder->base - 1) / ladder->tick);
+}
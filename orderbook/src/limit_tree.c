@@ -4,26 +4,122 @@
 
 struct limit_tree limit_tree_new(enum side side) {
   return (struct limit_tree){.side = side,
-                             .price_limit_map = uint64_hashmap_new()};
+                             .price_limit_map = uint64_swissmap_new()};
+}
+
+struct limit_tree limit_tree_new_ladder(enum side side,
+                                        uint64_t tick,
+                                        uint32_t capacity) {
+  struct limit_tree tree = limit_tree_new(side);
+  tree.ladder = malloc(sizeof(struct limit_ladder));
+  *tree.ladder = limit_ladder_new(tick, capacity);
+  return tree;
+}
+
+struct limit_tree limit_tree_new_bptree(enum side side) {
+  struct limit_tree tree = limit_tree_new(side);
+  tree.bptree = malloc(sizeof(struct limit_bptree));
+  *tree.bptree = limit_bptree_new();
+  return tree;
 }
 
 /**
- * Free all limits in tree using an in-order traversal
+ * Return a heap limit to the pool of the tree, or to the system without one.
  */
-void _limit_tree_free_limits(struct limit* node) {
-  if (node == NULL)
-    return;
+void _limit_tree_dealloc(struct limit_tree* tree, struct limit* limit) {
+  if (tree->limit_pool != NULL)
+    object_pool_release(tree->limit_pool, limit);
+  else
+    free(limit);
+}
 
-  _limit_tree_free_limits(node->left);
-  limit_free(node);
-  _limit_tree_free_limits(node->right);
-  free(node);
+/**
+ * Hands every limit of the tree to `drop` once, `heap` telling whether it was
+ * allocated on its own rather than in a ladder slot. Nothing is unlinked and
+ * nothing recurses: the red-black limits are rotated into a right-leaning
+ * vine as they are reached, which is dropped front to back, and the ladder and
+ * the B+tree leaves are walked in price order. The tree is left dangling.
+ */
+void _limit_tree_drop_all(struct limit_tree* tree,
+                          void (*drop)(struct limit_tree*,
+                                       struct limit*,
+                                       bool heap)) {
+  struct limit* node = tree->root;
+  while (node != NULL) {
+    if (node->left != NULL) {
+      struct limit* left = node->left;
+      node->left = left->right;
+      left->right = node;
+      node = left;
+      continue;
+    }
+
+    struct limit* next = node->right;
+    drop(tree, node, true);
+    node = next;
+  }
+
+  if (tree->ladder != NULL) {
+    struct limit* limit = limit_ladder_min(tree->ladder);
+    while (limit != NULL) {
+      uint64_t price = limit->price;
+      drop(tree, limit, false);
+      limit = limit_ladder_higher(tree->ladder, price);
+    }
+  }
+
+  // the leaves hold the prices, the limits can go before the next is found
+  if (tree->bptree != NULL) {
+    struct limit* limit = limit_bptree_min(tree->bptree);
+    while (limit != NULL) {
+      uint64_t price = limit->price;
+      drop(tree, limit, true);
+      limit = limit_bptree_higher(tree->bptree, price);
+    }
+  }
+}
+
+/**
+ * Return a heap limit to its pool, its orders are up to the caller
+ */
+void _limit_tree_release_limit(struct limit_tree* tree,
+                               struct limit* limit,
+                               bool heap) {
+  if (heap)
+    _limit_tree_dealloc(tree, limit);
+}
+
+/**
+ * Deallocate a limit for good. Orders and heap limits that came from a pool
+ * stay in it for its owner to free whole, only the queues are the limit's own.
+ */
+void _limit_tree_free_limit(struct limit_tree* tree,
+                            struct limit* limit,
+                            bool heap) {
+  if (tree->order_pool == NULL)
+    limit_free(limit, NULL);
+  else
+    limit_free_queues(limit);
+
+  if (heap && tree->limit_pool == NULL)
+    free(limit);
 }
 
 void limit_tree_free(struct limit_tree* tree) {
-  // Since all limits are on the heap, we free them using a traversal
-  _limit_tree_free_limits(tree->root);
-  uint64_hashmap_free(&tree->price_limit_map);
+  _limit_tree_drop_all(tree, _limit_tree_free_limit);
+  limit_tree_free_index(tree);
+}
+
+void limit_tree_free_index(struct limit_tree* tree) {
+  uint64_swissmap_free(&tree->price_limit_map);
+  if (tree->ladder != NULL) {
+    limit_ladder_free(tree->ladder);
+    free(tree->ladder);
+  }
+  if (tree->bptree != NULL) {
+    limit_bptree_free(tree->bptree);
+    free(tree->bptree);
+  }
 }
 
 void limit_tree_update_best(struct limit_tree* tree, struct limit* limit) {
@@ -66,99 +162,792 @@ void limit_tree_update_best(struct limit_tree* tree, struct limit* limit) {
   }
 }
 
-struct limit* _limit_tree_add(struct limit* node, struct limit* limit) {
-  if (node == NULL) {
-    node = limit;
-    return node;
+#define IS_RED(node) ((node) != NULL && (node)->color == LIMIT_COLOR_RED)
+
+/**
+ * Recompute the `subtree_*` totals of `node` from its own and its children's.
+ */
+static inline void _limit_tree_pull(struct limit* node) {
+  node->subtree_volume = node->volume;
+  node->subtree_order_count = node->order_count;
+  node->subtree_cost = node->price * node->volume;
+
+  if (node->left != NULL) {
+    node->subtree_volume += node->left->subtree_volume;
+    node->subtree_order_count += node->left->subtree_order_count;
+    node->subtree_cost += node->left->subtree_cost;
   }
+  if (node->right != NULL) {
+    node->subtree_volume += node->right->subtree_volume;
+    node->subtree_order_count += node->right->subtree_order_count;
+    node->subtree_cost += node->right->subtree_cost;
+  }
+}
+
+/**
+ * Rotate the subtree rooted at `node` to the left, `node->right` takes its
+ * place.
+ */
+void _limit_tree_rotate_left(struct limit_tree* tree, struct limit* node) {
+  struct limit* pivot = node->right;
+
+  node->right = pivot->left;
+  if (pivot->left != NULL)
+    pivot->left->parent = node;
+
+  pivot->parent = node->parent;
+  if (node->parent == NULL)
+    tree->root = pivot;
+  else if (node == node->parent->left)
+    node->parent->left = pivot;
+  else
+    node->parent->right = pivot;
+
+  pivot->left = node;
+  node->parent = pivot;
+
+  if (tree->aggregates) {  // the pivot now covers what the node did
+    _limit_tree_pull(node);
+    _limit_tree_pull(pivot);
+  }
+}
+
+/**
+ * Rotate the subtree rooted at `node` to the right, `node->left` takes its
+ * place.
+ */
+void _limit_tree_rotate_right(struct limit_tree* tree, struct limit* node) {
+  struct limit* pivot = node->left;
+
+  node->left = pivot->right;
+  if (pivot->right != NULL)
+    pivot->right->parent = node;
+
+  pivot->parent = node->parent;
+  if (node->parent == NULL)
+    tree->root = pivot;
+  else if (node == node->parent->right)
+    node->parent->right = pivot;
+  else
+    node->parent->left = pivot;
+
+  pivot->right = node;
+  node->parent = pivot;
+
+  if (tree->aggregates) {  // the pivot now covers what the node did
+    _limit_tree_pull(node);
+    _limit_tree_pull(pivot);
+  }
+}
+
+/**
+ * Restore the red-black properties after inserting the red `node`.
+ */
+void _limit_tree_add_fixup(struct limit_tree* tree, struct limit* node) {
+  while (IS_RED(node->parent)) {
+    struct limit* parent = node->parent;
+    struct limit* grandparent = parent->parent;  // parent is red, never root
 
-  if (limit->price > node->price)  // traverse right
-    node->right = _limit_tree_add(node->right, limit);
-  else if (limit->price < node->price)  // traverse left
-    node->left = _limit_tree_add(node->left, limit);
+    if (parent == grandparent->left) {
+      struct limit* uncle = grandparent->right;
 
-  return node;
+      if (IS_RED(uncle)) {  // case 1: recolour and move up
+        parent->color = LIMIT_COLOR_BLACK;
+        uncle->color = LIMIT_COLOR_BLACK;
+        grandparent->color = LIMIT_COLOR_RED;
+        node = grandparent;
+        continue;
+      }
+
+      if (node == parent->right) {  // case 2: rotate into case 3
+        _limit_tree_rotate_left(tree, parent);
+        node = parent;
+        parent = node->parent;
+      }
+
+      // case 3: rotate grandparent
+      parent->color = LIMIT_COLOR_BLACK;
+      grandparent->color = LIMIT_COLOR_RED;
+      _limit_tree_rotate_right(tree, grandparent);
+    } else {  // mirror of the above
+      struct limit* uncle = grandparent->left;
+
+      if (IS_RED(uncle)) {
+        parent->color = LIMIT_COLOR_BLACK;
+        uncle->color = LIMIT_COLOR_BLACK;
+        grandparent->color = LIMIT_COLOR_RED;
+        node = grandparent;
+        continue;
+      }
+
+      if (node == parent->left) {
+        _limit_tree_rotate_right(tree, parent);
+        node = parent;
+        parent = node->parent;
+      }
+
+      parent->color = LIMIT_COLOR_BLACK;
+      grandparent->color = LIMIT_COLOR_RED;
+      _limit_tree_rotate_left(tree, grandparent);
+    }
+  }
+
+  tree->root->color = LIMIT_COLOR_BLACK;
 }
 
 void limit_tree_add(struct limit_tree* tree, struct limit* limit) {
-  if (tree->root == NULL) {  // tree don't have limits yet
-    tree->root = limit;
-    tree->size++;
+  if (tree->bptree != NULL) {
+    if (limit_bptree_insert(tree->bptree, limit)) {
+      uint64_swissmap_put(&tree->price_limit_map, limit->price, limit);
+      tree->size++;
+    }
     return;
   }
 
-  if (limit->price > tree->root->price)  // traverse right
-    tree->root->right = _limit_tree_add(tree->root->right, limit);
-  else if (limit->price < tree->root->price)  // traverse left
-    tree->root->left = _limit_tree_add(tree->root->left, limit);
-  else  // already exist
-    return;
+  struct limit* parent = NULL;
+  struct limit* node = tree->root;
+
+  // walk down to the insertion point
+  while (node != NULL) {
+    parent = node;
+    if (limit->price > node->price)  // traverse right
+      node = node->right;
+    else if (limit->price < node->price)  // traverse left
+      node = node->left;
+    else  // already exist
+      return;
+  }
 
+  limit->parent = parent;
+  limit->left = NULL;
+  limit->right = NULL;
+  limit->color = LIMIT_COLOR_RED;
+
+  // a new leaf sits right next to its parent in price order
+  if (parent == NULL) {  // tree don't have limits yet
+    tree->root = limit;
+    limit->prev = limit->next = NULL;
+  } else if (limit->price > parent->price) {
+    parent->right = limit;
+    limit->prev = parent;
+    limit->next = parent->next;
+  } else {
+    parent->left = limit;
+    limit->prev = parent->prev;
+    limit->next = parent;
+  }
+
+  if (limit->prev != NULL)
+    limit->prev->next = limit;
+  else
+    tree->lowest = limit;
+  if (limit->next != NULL)
+    limit->next->prev = limit;
+  else
+    tree->highest = limit;
+
+  if (tree->aggregates) {  // the new leaf adds to every ancestor
+    _limit_tree_pull(limit);
+    for (struct limit* node = parent; node != NULL; node = node->parent) {
+      node->subtree_volume += limit->subtree_volume;
+      node->subtree_order_count += limit->subtree_order_count;
+      node->subtree_cost += limit->subtree_cost;
+    }
+  }
+
+  _limit_tree_add_fixup(tree, limit);
+  uint64_swissmap_put(&tree->price_limit_map, limit->price, limit);
   tree->size++;
 }
 
-struct limit* _limit_tree_remove(struct limit* node, struct limit* limit) {
-  if (node == NULL)
-    return node;
+/**
+ * Replace the subtree rooted at `node` with the subtree rooted at
+ * `replacement` (which may be NULL).
+ */
+void _limit_tree_transplant(struct limit_tree* tree,
+                            struct limit* node,
+                            struct limit* replacement) {
+  if (node->parent == NULL)
+    tree->root = replacement;
+  else if (node == node->parent->left)
+    node->parent->left = replacement;
+  else
+    node->parent->right = replacement;
+
+  if (replacement != NULL)
+    replacement->parent = node->parent;
+}
+
+/**
+ * Restore the red-black properties after removing a black node. Since leaves
+ * are NULL, `node` may be NULL hence its parent is passed explicitly.
+ */
+void _limit_tree_remove_fixup(struct limit_tree* tree,
+                              struct limit* node,
+                              struct limit* parent) {
+  while (node != tree->root && !IS_RED(node)) {
+    if (node == parent->left) {
+      struct limit* sibling = parent->right;
+
+      if (IS_RED(sibling)) {  // case 1: make the sibling black
+        sibling->color = LIMIT_COLOR_BLACK;
+        parent->color = LIMIT_COLOR_RED;
+        _limit_tree_rotate_left(tree, parent);
+        sibling = parent->right;
+      }
+
+      if (!IS_RED(sibling->left) && !IS_RED(sibling->right)) {  // case 2
+        sibling->color = LIMIT_COLOR_RED;
+        node = parent;
+        parent = node->parent;
+        continue;
+      }
+
+      if (!IS_RED(sibling->right)) {  // case 3: rotate into case 4
+        sibling->left->color = LIMIT_COLOR_BLACK;
+        sibling->color = LIMIT_COLOR_RED;
+        _limit_tree_rotate_right(tree, sibling);
+        sibling = parent->right;
+      }
 
-  if (limit->price < node->price)  // traverse left
-    node->left = _limit_tree_remove(node->left, limit);
-  else if (limit->price > node->price)  // traverse right
-    node->right = _limit_tree_remove(node->right, limit);
-  else {  // found
-    // Case 1: only one child or no child
-    if (node->left == NULL)
-      return node->right;
-    else if (node->right == NULL)
-      return node->left;
+      // case 4: rotate parent, done
+      sibling->color = parent->color;
+      parent->color = LIMIT_COLOR_BLACK;
+      sibling->right->color = LIMIT_COLOR_BLACK;
+      _limit_tree_rotate_left(tree, parent);
+      node = tree->root;
+    } else {  // mirror of the above
+      struct limit* sibling = parent->left;
 
-    // Case 2: has both left and right child (find successor)
-    struct limit* successor_parent = node;
-    struct limit* successor = node->left;
+      if (IS_RED(sibling)) {
+        sibling->color = LIMIT_COLOR_BLACK;
+        parent->color = LIMIT_COLOR_RED;
+        _limit_tree_rotate_right(tree, parent);
+        sibling = parent->left;
+      }
 
-    while (successor->right != NULL) {
-      successor_parent = successor;
-      successor = successor->right;
+      if (!IS_RED(sibling->left) && !IS_RED(sibling->right)) {
+        sibling->color = LIMIT_COLOR_RED;
+        node = parent;
+        parent = node->parent;
+        continue;
+      }
+
+      if (!IS_RED(sibling->left)) {
+        sibling->right->color = LIMIT_COLOR_BLACK;
+        sibling->color = LIMIT_COLOR_RED;
+        _limit_tree_rotate_left(tree, sibling);
+        sibling = parent->left;
+      }
+
+      sibling->color = parent->color;
+      parent->color = LIMIT_COLOR_BLACK;
+      sibling->left->color = LIMIT_COLOR_BLACK;
+      _limit_tree_rotate_right(tree, parent);
+      node = tree->root;
     }
+  }
 
-    if (successor != node->left) {
-      struct limit* successor_left = successor->left;
-      successor->left = node->left;
-      successor->right = node->right;
-      successor_parent->right = successor_left;
+  if (node != NULL)
+    node->color = LIMIT_COLOR_BLACK;
+}
+
+/**
+ * Unlink `limit` from the red-black tree without deallocating it.
+ */
+void _limit_tree_unlink(struct limit_tree* tree, struct limit* limit) {
+  struct limit* child;
+  struct limit* child_parent;
+  enum limit_color removed_color = limit->color;
+
+  if (limit->left == NULL) {  // Case 1: only one child or no child
+    child = limit->right;
+    child_parent = limit->parent;
+    _limit_tree_transplant(tree, limit, child);
+  } else if (limit->right == NULL) {
+    child = limit->left;
+    child_parent = limit->parent;
+    _limit_tree_transplant(tree, limit, child);
+  } else {  // Case 2: has both left and right child (take the predecessor)
+    struct limit* predecessor = limit->prev;  // rightmost of the left subtree
+
+    removed_color = predecessor->color;
+    child = predecessor->left;
+
+    if (predecessor->parent == limit) {
+      child_parent = predecessor;
     } else {
-      successor->right = node->right;
+      child_parent = predecessor->parent;
+      _limit_tree_transplant(tree, predecessor, child);
+      predecessor->left = limit->left;
+      predecessor->left->parent = predecessor;
     }
 
-    node = successor;
+    _limit_tree_transplant(tree, limit, predecessor);
+    predecessor->right = limit->right;
+    predecessor->right->parent = predecessor;
+    predecessor->color = limit->color;
+  }
+
+  // everything from where the tree changed up to the root lost `limit`
+  if (tree->aggregates)
+    for (struct limit* node = child_parent; node != NULL; node = node->parent)
+      _limit_tree_pull(node);
+
+  if (removed_color == LIMIT_COLOR_BLACK)
+    _limit_tree_remove_fixup(tree, child, child_parent);
+
+  if (limit->prev != NULL)
+    limit->prev->next = limit->next;
+  else
+    tree->lowest = limit->next;
+  if (limit->next != NULL)
+    limit->next->prev = limit->prev;
+  else
+    tree->highest = limit->prev;
+
+  uint64_swissmap_remove(&tree->price_limit_map, limit->price);
+}
+
+/**
+ * Returns the limit that takes over when `best` is removed, ie. the next lower
+ * price for bids and the next higher price for asks. Only the neighbouring
+ * links and the ladder bitmap are followed, the tree is never searched.
+ */
+struct limit* _limit_tree_runner_up(struct limit_tree* tree,
+                                    struct limit* best) {
+  bool in_ladder =
+      tree->ladder != NULL && limit_ladder_owns(tree->ladder, best);
+
+  switch (tree->side) {
+    case SIDE_BID: {
+      // everything in the red-black tree is below a best held by the ladder
+      struct limit* next = in_ladder ? tree->highest : best->prev;
+      if (tree->ladder == NULL)
+        return next;
+
+      struct limit* ladder_next =
+          limit_ladder_lower(tree->ladder, best->price);
+      if (next == NULL ||
+          (ladder_next != NULL && ladder_next->price > next->price))
+        return ladder_next;
+      return next;
+    }
+    case SIDE_ASK: {
+      struct limit* next = in_ladder ? tree->lowest : best->next;
+      if (tree->ladder == NULL)
+        return next;
+
+      struct limit* ladder_next =
+          limit_ladder_higher(tree->ladder, best->price);
+      if (next == NULL ||
+          (ladder_next != NULL && ladder_next->price < next->price))
+        return ladder_next;
+      return next;
+    }
   }
 
-  return node;
+  return NULL;
 }
 
 void limit_tree_remove(struct limit_tree* tree, struct limit* limit) {
-  tree->root = _limit_tree_remove(tree->root, limit);
-  limit_free(limit);
-  free(limit);
+  bool is_best = tree->best == limit;
+
+  // the B+tree keeps its end leaves, the best is read back after removal
+  if (tree->bptree != NULL) {
+    limit_bptree_remove(tree->bptree, limit);
+    uint64_swissmap_remove(&tree->price_limit_map, limit->price);
+    limit_free(limit, tree->order_pool);
+    _limit_tree_dealloc(tree, limit);
+    tree->size--;
+
+    if (is_best)
+      tree->best = tree->side == SIDE_BID ? limit_bptree_max(tree->bptree)
+                                          : limit_bptree_min(tree->bptree);
+    return;
+  }
+
+  // find the next best while the links of `limit` are still intact
+  if (is_best)
+    tree->best = _limit_tree_runner_up(tree, limit);
+
+  if (tree->ladder != NULL && limit_ladder_owns(tree->ladder, limit)) {
+    limit_free(limit, tree->order_pool);
+    limit_ladder_remove(tree->ladder, limit);
+    tree->size--;
+    return;
+  }
+
+  _limit_tree_unlink(tree, limit);
+  limit_free(limit, tree->order_pool);
+  _limit_tree_dealloc(tree, limit);
   tree->size--;
 }
 
+/**
+ * Returns the node with the lowest price >= `price` (or > if not `inclusive`).
+ */
+struct limit* _limit_tree_ceil(struct limit* node,
+                               uint64_t price,
+                               bool inclusive) {
+  struct limit* found = NULL;
+  while (node != NULL) {
+    if (node->price > price || (inclusive && node->price == price)) {
+      found = node;
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return found;
+}
+
+/**
+ * Returns the node with the highest price < `price`.
+ */
+struct limit* _limit_tree_floor(struct limit* node, uint64_t price) {
+  struct limit* found = NULL;
+  while (node != NULL) {
+    if (node->price < price) {
+      found = node;
+      node = node->right;
+    } else {
+      node = node->left;
+    }
+  }
+  return found;
+}
+
+/**
+ * Move the level in a ladder slot to a heap limit in the red-black tree, the
+ * reverse of what `_limit_tree_anchor()` does with the levels entering the
+ * window.
+ */
+void _limit_tree_evict(struct limit_tree* tree, struct limit* slot) {
+  struct limit* limit = tree->limit_pool != NULL
+                            ? object_pool_alloc(tree->limit_pool)
+                            : malloc(sizeof(struct limit));
+  *limit = *slot;
+  for (struct order* order = limit->order_head;
+       order != NULL && !tree->compact_orders;
+       order = limit_next_order(limit, order))
+    order->limit = limit;  // fix the backlinks
+
+  if (tree->best == slot)
+    tree->best = limit;
+  limit_ladder_remove(tree->ladder, slot);
+  tree->size--;  // counted again when added
+  limit_tree_add(tree, limit);
+}
+
+/**
+ * Move the ladder window around `price`. The levels that leave the window
+ * are moved out to the red-black tree, and heap limits that end up in the new
+ * window are moved into their slots, so that each price lives in one place.
+ */
+void _limit_tree_anchor(struct limit_tree* tree, uint64_t price) {
+  struct limit_ladder* ladder = tree->ladder;
+  uint64_t base = limit_ladder_base(ladder, price);
+
+  // the slots stay where they are, only the levels outside the new window go
+  struct limit* limit;
+  while ((limit = limit_ladder_min(ladder)) != NULL && limit->price < base)
+    _limit_tree_evict(tree, limit);
+  while ((limit = limit_ladder_max(ladder)) != NULL &&
+         (limit->price - base) / ladder->tick >= ladder->capacity)
+    _limit_tree_evict(tree, limit);
+  limit_ladder_anchor(ladder, price);
+
+  struct limit* node = _limit_tree_ceil(tree->root, ladder->base, true);
+  while (node != NULL &&
+         (node->price - ladder->base) / ladder->tick < ladder->capacity) {
+    struct limit* next = node->next;
+
+    if (limit_ladder_contains(ladder, node->price)) {
+      _limit_tree_unlink(tree, node);
+
+      struct limit* slot = limit_ladder_insert(ladder, node->price);
+      *slot = *node;
+      slot->parent = slot->left = slot->right = NULL;
+      slot->prev = slot->next = NULL;
+      for (struct order* order = slot->order_head;
+           order != NULL && !tree->compact_orders;
+           order = limit_next_order(slot, order))
+        order->limit = slot;  // fix the backlinks
+
+      if (tree->best == node)
+        tree->best = slot;
+      _limit_tree_dealloc(tree, node);
+    }
+
+    node = next;
+  }
+}
+
+/**
+ * Whether the ladder window should move to take in `price`, which it does not
+ * cover yet: always when it is empty, else if `price` is on the tick grid and
+ * within half a window of the best price.
+ */
+static inline bool _limit_tree_follows(struct limit_tree* tree,
+                                       uint64_t price) {
+  struct limit_ladder* ladder = tree->ladder;
+  if (ladder->size == 0)
+    return true;
+  if (tree->best == NULL || price % ladder->tick != 0)
+    return false;
+
+  uint64_t distance = price > tree->best->price ? price - tree->best->price
+                                                : tree->best->price - price;
+  return distance / ladder->tick < ladder->capacity >> 1;
+}
+
+struct limit* limit_tree_get(struct limit_tree* tree, uint64_t price) {
+  if (tree->ladder != NULL && limit_ladder_contains(tree->ladder, price))
+    return limit_ladder_get(tree->ladder, price);
+  return uint64_swissmap_get(&tree->price_limit_map, price);
+}
+
+struct limit* limit_tree_insert(struct limit_tree* tree, uint64_t price) {
+  if (tree->ladder != NULL) {
+    // the window follows the market, it slides over to a price near the best
+    // one, while a price far from it is left to the red-black tree
+    if (!limit_ladder_contains(tree->ladder, price) &&
+        _limit_tree_follows(tree, price))
+      _limit_tree_anchor(tree, price);
+
+    if (limit_ladder_contains(tree->ladder, price)) {
+      tree->size++;
+      return limit_ladder_insert(tree->ladder, price);
+    }
+  }
+
+  // Make a new limit on the heap, will be deallocated in `limit_tree_free()`
+  struct limit* limit = tree->limit_pool != NULL
+                            ? object_pool_alloc(tree->limit_pool)
+                            : malloc(sizeof(struct limit));
+  *limit = (struct limit){.price = price};
+  limit_tree_add(tree, limit);
+  return limit;
+}
+
+struct limit* limit_tree_next(struct limit_tree* tree, struct limit* limit) {
+  if (tree->bptree != NULL)
+    return limit_bptree_higher(tree->bptree, limit->price);
+
+  if (tree->ladder == NULL)
+    return limit->next;
+
+  // a ladder limit is not threaded, search the red-black tree instead
+  struct limit* next = limit_ladder_owns(tree->ladder, limit)
+                           ? _limit_tree_ceil(tree->root, limit->price, false)
+                           : limit->next;
+
+  struct limit* ladder_next = limit_ladder_higher(tree->ladder, limit->price);
+  if (next == NULL || (ladder_next != NULL && ladder_next->price < next->price))
+    return ladder_next;
+  return next;
+}
+
+struct limit* limit_tree_prev(struct limit_tree* tree, struct limit* limit) {
+  if (tree->bptree != NULL)
+    return limit_bptree_lower(tree->bptree, limit->price);
+
+  if (tree->ladder == NULL)
+    return limit->prev;
+
+  struct limit* prev = limit_ladder_owns(tree->ladder, limit)
+                           ? _limit_tree_floor(tree->root, limit->price)
+                           : limit->prev;
+
+  struct limit* ladder_prev = limit_ladder_lower(tree->ladder, limit->price);
+  if (prev == NULL || (ladder_prev != NULL && ladder_prev->price > prev->price))
+    return ladder_prev;
+  return prev;
+}
+
 struct limit* limit_tree_min(struct limit_tree* tree) {
-  struct limit* node = tree->root;
+  if (tree->bptree != NULL)
+    return limit_bptree_min(tree->bptree);
 
-  // get the leftmost node
-  while (node->left != NULL)
-    node = node->left;
+  struct limit* min = tree->lowest;
+  if (tree->ladder == NULL)
+    return min;
 
-  return node;
+  struct limit* ladder_min = limit_ladder_min(tree->ladder);
+  if (min == NULL || (ladder_min != NULL && ladder_min->price < min->price))
+    return ladder_min;
+  return min;
 }
 
 struct limit* limit_tree_max(struct limit_tree* tree) {
+  if (tree->bptree != NULL)
+    return limit_bptree_max(tree->bptree);
+
+  struct limit* max = tree->highest;
+  if (tree->ladder == NULL)
+    return max;
+
+  struct limit* ladder_max = limit_ladder_max(tree->ladder);
+  if (max == NULL || (ladder_max != NULL && ladder_max->price > max->price))
+    return ladder_max;
+  return max;
+}
+struct limit* limit_tree_ceil(struct limit_tree* tree, uint64_t price) {
+  struct limit* found = limit_tree_get(tree, price);
+  if (found != NULL)
+    return found;
+
+  if (tree->bptree != NULL)
+    return limit_bptree_higher(tree->bptree, price);
+
+  struct limit* higher = _limit_tree_ceil(tree->root, price, false);
+  if (tree->ladder == NULL)
+    return higher;
+
+  struct limit* ladder_higher = limit_ladder_higher(tree->ladder, price);
+  if (higher == NULL ||
+      (ladder_higher != NULL && ladder_higher->price < higher->price))
+    return ladder_higher;
+  return higher;
+}
+
+void limit_tree_clear(struct limit_tree* tree, bool release) {
+  if (release)
+    _limit_tree_drop_all(tree, _limit_tree_release_limit);
+
+  // what indexes the limits keeps its memory for the next ones
+  uint64_swissmap_clear(&tree->price_limit_map);
+  if (tree->ladder != NULL)
+    limit_ladder_clear(tree->ladder);
+  if (tree->bptree != NULL) {
+    limit_bptree_free(tree->bptree);
+    *tree->bptree = limit_bptree_new();
+  }
+  tree->best = tree->root = tree->lowest = tree->highest = NULL;
+  tree->size = 0;
+}
+
+void limit_tree_aggregate(struct limit_tree* tree,
+                          struct limit* limit,
+                          int64_t volume,
+                          int64_t order_count) {
+  if (!tree->aggregates || tree->bptree != NULL ||
+      (tree->ladder != NULL && limit_ladder_owns(tree->ladder, limit)))
+    return;
+
+  // a decrease wraps around, which is just as well for unsigned totals
+  uint64_t cost = limit->price * (uint64_t)volume;
+  for (struct limit* node = limit; node != NULL; node = node->parent) {
+    node->subtree_volume += (uint64_t)volume;
+    node->subtree_order_count += (uint64_t)order_count;
+    node->subtree_cost += cost;
+  }
+}
+
+/**
+ * Whether `price` is at least as good as `bound` for the side of the tree.
+ */
+static inline bool _limit_tree_within(struct limit_tree* tree,
+                                      uint64_t price,
+                                      uint64_t bound) {
+  return tree->side == SIDE_BID ? price >= bound : price <= bound;
+}
+
+/**
+ * Whether the `subtree_*` totals can be used, a ladder or B+tree has limits
+ * that are not in the red-black tree.
+ */
+static inline bool _limit_tree_aggregated(struct limit_tree* tree) {
+  return tree->aggregates && tree->ladder == NULL && tree->bptree == NULL;
+}
+
+uint64_t limit_tree_volume_to(struct limit_tree* tree, uint64_t price) {
+  uint64_t volume = 0;
+
+  if (!_limit_tree_aggregated(tree)) {  // walk from the best limit instead
+    struct limit* limit = tree->best;
+    while (limit != NULL && _limit_tree_within(tree, limit->price, price)) {
+      volume += limit->volume;
+      limit = tree->side == SIDE_BID ? limit_tree_prev(tree, limit)
+                                     : limit_tree_next(tree, limit);
+    }
+    return volume;
+  }
+
+  // take whole subtrees on the better side of `price` on the way down
+  struct limit* node = tree->root;
+  while (node != NULL) {
+    if (!_limit_tree_within(tree, node->price, price)) {
+      node = tree->side == SIDE_BID ? node->right : node->left;
+      continue;
+    }
+
+    struct limit* better = tree->side == SIDE_BID ? node->right : node->left;
+    volume += node->volume + (better != NULL ? better->subtree_volume : 0);
+    node = tree->side == SIDE_BID ? node->left : node->right;
+  }
+  return volume;
+}
+
+struct limit_tree_fill limit_tree_cost_to_fill(struct limit_tree* tree,
+                                               uint64_t size) {
+  struct limit_tree_fill fill = {0};
+
+  if (!_limit_tree_aggregated(tree)) {  // walk from the best limit instead
+    struct limit* limit = tree->best;
+    while (limit != NULL && fill.size < size) {
+      uint64_t take = size - fill.size;
+      if (take > limit->volume)
+        take = limit->volume;
+
+      fill.size += take;
+      fill.cost += limit->price * take;
+      fill.worst_price = limit->price;
+      limit = tree->side == SIDE_BID ? limit_tree_prev(tree, limit)
+                                     : limit_tree_next(tree, limit);
+    }
+    return fill;
+  }
+
+  if (tree->root == NULL)
+    return fill;
+
+  // the whole tree is not enough, everything fills up to the worst limit
+  if (tree->root->subtree_volume <= size) {
+    fill.size = tree->root->subtree_volume;
+    fill.cost = tree->root->subtree_cost;
+    fill.worst_price = tree->side == SIDE_BID ? tree->lowest->price
+                                              : tree->highest->price;
+    return fill;
+  }
+
+  // otherwise find the limit where the running volume reaches `size`
   struct limit* node = tree->root;
+  while (node != NULL) {
+    struct limit* better = tree->side == SIDE_BID ? node->right : node->left;
+    struct limit* worse = tree->side == SIDE_BID ? node->left : node->right;
+    uint64_t better_volume = better != NULL ? better->subtree_volume : 0;
 
-  // get the rightmost node
-  while (node->right != NULL)
-    node = node->right;
+    if (size - fill.size <= better_volume) {
+      node = better;
+      continue;
+    }
+
+    fill.size += better_volume;
+    fill.cost += better != NULL ? better->subtree_cost : 0;
 
-  return node;
-}
\ No newline at end of file
+    uint64_t take = size - fill.size;
+    if (take <= node->volume) {
+      fill.size += take;
+      fill.cost += node->price * take;
+      fill.worst_price = node->price;
+      break;
+    }
+
+    fill.size += node->volume;
+    fill.cost += node->price * node->volume;
+    node = worse;
+  }
+  return fill;
+}
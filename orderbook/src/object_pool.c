@@ -0,0 +1,125 @@
+#include "object_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define OBJECT_POOL_MIN_CAPACITY 64
+
+/**
+ * Allocate a slab of `capacity` objects, new objects are carved from it until
+ * it runs out.
+ */
+void _object_pool_grow(struct object_pool* pool, uint64_t capacity) {
+  if (capacity < OBJECT_POOL_MIN_CAPACITY)
+    capacity = OBJECT_POOL_MIN_CAPACITY;
+
+  struct object_pool_slab* slab =
+      malloc(sizeof(struct object_pool_slab) + capacity * pool->object_size);
+  if (slab == NULL) {
+    fprintf(stderr, "failed to allocate object pool slab\n");
+    exit(EXIT_FAILURE);
+  }
+
+  slab->next = pool->slabs;
+  slab->capacity = capacity;
+  slab->borrowed = false;
+  pool->slabs = slab;
+  pool->fresh = slab->objects;
+  pool->fresh_end = slab->objects + capacity * pool->object_size;
+  pool->capacity += capacity;
+  pool->slab_allocations++;
+}
+
+/**
+ * Released objects hold the free list link. A type is aligned to a power of 2
+ * that divides its size, so consecutive objects in a slab aligned to
+ * `max_align_t` are aligned for any type of that size without more padding.
+ */
+static inline size_t _object_pool_object_size(size_t object_size) {
+  const size_t align = sizeof(void*);
+  if (object_size < sizeof(void*))
+    object_size = sizeof(void*);
+  return (object_size + align - 1) & ~(align - 1);
+}
+
+struct object_pool object_pool_new(size_t object_size,
+                                   uint64_t initial_capacity) {
+  struct object_pool pool = {.object_size =
+                                 _object_pool_object_size(object_size)};
+  if (initial_capacity > 0)
+    _object_pool_grow(&pool, initial_capacity);
+  return pool;
+}
+
+size_t object_pool_slab_size(size_t object_size, uint64_t capacity) {
+  return sizeof(struct object_pool_slab) +
+         capacity * _object_pool_object_size(object_size);
+}
+
+void object_pool_adopt(struct object_pool* pool, void* memory, size_t bytes) {
+  struct object_pool_slab* slab = memory;
+  if (bytes < object_pool_slab_size(pool->object_size, 1))
+    return;  // not even room for one
+
+  slab->next = pool->slabs;
+  slab->capacity =
+      (bytes - sizeof(struct object_pool_slab)) / pool->object_size;
+  slab->borrowed = true;
+  pool->slabs = slab;
+  pool->fresh = slab->objects;
+  pool->fresh_end = slab->objects + slab->capacity * pool->object_size;
+  pool->capacity += slab->capacity;
+}
+
+void object_pool_free(struct object_pool* pool) {
+  struct object_pool_slab* slab = pool->slabs;
+  while (slab != NULL) {
+    struct object_pool_slab* next = slab->next;
+    if (!slab->borrowed)
+      free(slab);
+    slab = next;
+  }
+  *pool = (struct object_pool){.object_size = pool->object_size};
+}
+
+void object_pool_reset(struct object_pool* pool) {
+  pool->free_list = NULL;
+  pool->in_use = 0;
+  if (pool->slabs != NULL) {
+    pool->fresh = pool->slabs->objects;
+    pool->fresh_end =
+        pool->slabs->objects + pool->slabs->capacity * pool->object_size;
+    pool->spare = pool->slabs->next;
+  }
+}
+
+void* object_pool_alloc(struct object_pool* pool) {
+  pool->allocations++;
+  pool->in_use++;
+
+  if (pool->free_list != NULL) {  // reuse the last released object
+    void* object = pool->free_list;
+    pool->free_list = *(void**)object;
+    return object;
+  }
+
+  if (pool->fresh == pool->fresh_end && pool->spare != NULL) {
+    struct object_pool_slab* slab = pool->spare;  // carve a reset slab again
+    pool->spare = slab->next;
+    pool->fresh = slab->objects;
+    pool->fresh_end = slab->objects + slab->capacity * pool->object_size;
+  }
+
+  if (pool->fresh == pool->fresh_end)  // every object is in use, double up
+    _object_pool_grow(pool, pool->capacity);
+
+  void* object = pool->fresh;
+  pool->fresh += pool->object_size;
+  return object;
+}
+
+void object_pool_release(struct object_pool* pool, void* object) {
+  *(void**)object = pool->free_list;
+  pool->free_list = object;
+  pool->in_use--;
+}
@@ -0,0 +1,56 @@
+#include "order_fenwick.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "uint64_hashmap.h"
+
+#define ORDER_FENWICK_MIN_CAPACITY 8
+
+void order_fenwick_free(struct order_fenwick* fenwick) {
+  free(fenwick->nodes);
+  *fenwick = (struct order_fenwick){0};
+}
+
+void order_fenwick_reset(struct order_fenwick* fenwick, uint32_t capacity) {
+  if (capacity < ORDER_FENWICK_MIN_CAPACITY)
+    capacity = ORDER_FENWICK_MIN_CAPACITY;
+  capacity = find_next_positive_power_of_two(capacity);
+
+  if (capacity != fenwick->capacity) {
+    free(fenwick->nodes);
+    fenwick->nodes = calloc(capacity + 1, sizeof(struct order_fenwick_sum));
+    fenwick->capacity = capacity;
+  } else {
+    memset(fenwick->nodes, 0,
+           (capacity + 1) * sizeof(struct order_fenwick_sum));
+  }
+  fenwick->len = 0;
+}
+
+uint32_t order_fenwick_push(struct order_fenwick* fenwick, uint64_t volume) {
+  uint32_t slot = fenwick->len++;
+  order_fenwick_add(fenwick, slot, volume, 1);
+  return slot;
+}
+
+void order_fenwick_add(struct order_fenwick* fenwick,
+                       uint32_t slot,
+                       int64_t volume,
+                       int64_t count) {
+  // a decrease wraps around, which is just as well for unsigned totals
+  for (uint32_t i = slot + 1; i <= fenwick->capacity; i += i & -i) {
+    fenwick->nodes[i].volume += (uint64_t)volume;
+    fenwick->nodes[i].count += (uint64_t)count;
+  }
+}
+
+struct order_fenwick_sum order_fenwick_prefix(struct order_fenwick* fenwick,
+                                              uint32_t slot) {
+  struct order_fenwick_sum sum = {0};
+  for (uint32_t i = slot; i > 0; i -= i & -i) {
+    sum.volume += fenwick->nodes[i].volume;
+    sum.count += fenwick->nodes[i].count;
+  }
+  return sum;
+}
@@ -0,0 +1,127 @@
+#include "order_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "uint64_hashmap.h"
+
+#define ORDER_INDEX_MIN_CAPACITY 2
+
+struct order_index order_index_new(uint32_t capacity) {
+  if (capacity < ORDER_INDEX_MIN_CAPACITY)
+    capacity = ORDER_INDEX_MIN_CAPACITY;
+  capacity = find_next_positive_power_of_two(capacity);
+
+  return (struct order_index){
+      .capacity = capacity,
+      .pages = calloc(capacity, sizeof(struct order_index_page*)),
+  };
+}
+
+void order_index_free(struct order_index* index) {
+  for (uint32_t i = 0; i < index->capacity; i++)
+    free(index->pages[i]);
+  free(index->pages);
+}
+
+void order_index_clear(struct order_index* index) {
+  for (uint32_t i = 0; i < index->capacity && index->size != 0; i++) {
+    struct order_index_page* page = index->pages[i];
+    if (page != NULL && page->count != 0) {
+      memset(page->orders, 0, sizeof(page->orders));
+      index->size -= page->count;
+      page->count = 0;
+    }
+  }
+}
+
+/**
+ * Returns the page for `order_id` if it is within the window, or NULL.
+ */
+static inline struct order_index_page* _order_index_page(
+    struct order_index* index,
+    uint64_t order_id) {
+  uint64_t page = order_id >> ORDER_INDEX_PAGE_BITS;
+  if (page - index->base >= index->capacity)  // wraps below the window too
+    return NULL;
+  return index->pages[page & (index->capacity - 1)];
+}
+
+/**
+ * Slide the window forward until it covers `page`, over empty pages only.
+ */
+bool _order_index_slide(struct order_index* index, uint64_t page) {
+  if (index->size == 0) {  // nothing to keep, jump straight there
+    index->base = page;
+    return true;
+  }
+
+  while (page - index->base >= index->capacity) {
+    struct order_index_page* front =
+        index->pages[index->base & (index->capacity - 1)];
+    if (front != NULL && front->count != 0)
+      return false;  // pinned by a resting order
+    index->base++;   // the front page is reused for `base + capacity`
+  }
+
+  return true;
+}
+
+bool order_index_put(struct order_index* index,
+                     uint64_t order_id,
+                     struct order* order) {
+  uint64_t page = order_id >> ORDER_INDEX_PAGE_BITS;
+  if (page < index->base)
+    return false;
+  if (page - index->base >= index->capacity && !_order_index_slide(index, page))
+    return false;
+
+  struct order_index_page** slot =
+      &index->pages[page & (index->capacity - 1)];
+  if (*slot == NULL)
+    *slot = calloc(1, sizeof(struct order_index_page));
+
+  struct order_index_page* target = *slot;
+  struct order** entry =
+      &target->orders[order_id & (ORDER_INDEX_PAGE_SIZE - 1)];
+  if (*entry == NULL) {  // replacing an order keeps the count
+    target->count++;
+    index->size++;
+  }
+  *entry = order;
+
+  return true;
+}
+
+struct order* order_index_get(struct order_index* index, uint64_t order_id) {
+  struct order_index_page* page = _order_index_page(index, order_id);
+  if (page == NULL)
+    return NULL;
+  return page->orders[order_id & (ORDER_INDEX_PAGE_SIZE - 1)];
+}
+
+struct order* order_index_remove(struct order_index* index,
+                                 uint64_t order_id) {
+  struct order_index_page* page = _order_index_page(index, order_id);
+  if (page == NULL)
+    return NULL;
+
+  struct order** entry = &page->orders[order_id & (ORDER_INDEX_PAGE_SIZE - 1)];
+  struct order* order = *entry;
+  if (order != NULL) {
+    *entry = NULL;
+    page->count--;
+    index->size--;
+  }
+
+  return order;
+}
+
+bool order_index_prefetch(struct order_index* index, uint64_t order_id) {
+  struct order_index_page* page = _order_index_page(index, order_id);
+  if (page == NULL)
+    return false;
+
+  __builtin_prefetch(&page->orders[order_id & (ORDER_INDEX_PAGE_SIZE - 1)]);
+  return true;
+}
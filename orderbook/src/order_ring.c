@@ -0,0 +1,99 @@
+#include "order_ring.h"
+
+#include <stdlib.h>
+
+#include "limit.h"
+
+#define ORDER_RING_MIN_CAPACITY 8
+
+struct order_ring order_ring_new() {
+  return (struct order_ring){
+      .slots = calloc(ORDER_RING_MIN_CAPACITY, sizeof(struct order*)),
+      .capacity = ORDER_RING_MIN_CAPACITY,
+  };
+}
+
+void order_ring_free(struct order_ring* ring) {
+  free(ring->slots);
+  *ring = (struct order_ring){0};
+}
+
+static inline struct order** _order_ring_slot(struct order_ring* ring,
+                                              uint32_t position) {
+  return &ring->slots[position & (ring->capacity - 1)];
+}
+
+/**
+ * Move the orders to `capacity` slots without the tombstones in between,
+ * keeping their order and the head where it is. With the same capacity this
+ * is done in place, an order only ever moves to a position it has passed.
+ */
+void _order_ring_rebuild(struct order_ring* ring, uint32_t capacity) {
+  struct order** slots = capacity == ring->capacity
+                             ? ring->slots
+                             : calloc(capacity, sizeof(struct order*));
+
+  uint32_t position = ring->head;
+  for (uint32_t i = ring->head; i != ring->tail; i++) {
+    struct order* order = *_order_ring_slot(ring, i);
+    if (order == NULL)
+      continue;
+
+    slots[position & (capacity - 1)] = order;
+    order->ring_slot = position++;
+  }
+
+  // nothing stale is left behind in place
+  for (uint32_t i = position; i != ring->tail; i++)
+    slots[i & (capacity - 1)] = NULL;
+
+  if (slots != ring->slots) {
+    free(ring->slots);
+    ring->slots = slots;
+    ring->capacity = capacity;
+  }
+  ring->tail = position;
+}
+
+void order_ring_push(struct order_ring* ring, struct order* order) {
+  // full, at least half of it was pushed since the last time this happened
+  if (ring->tail - ring->head == ring->capacity)
+    _order_ring_rebuild(ring, ring->size >= ring->capacity / 2
+                                  ? ring->capacity * 2
+                                  : ring->capacity);
+
+  order->ring_slot = ring->tail;
+  *_order_ring_slot(ring, ring->tail++) = order;
+  ring->size++;
+}
+
+void order_ring_remove(struct order_ring* ring, struct order* order) {
+  *_order_ring_slot(ring, order->ring_slot) = NULL;
+  ring->size--;
+
+  // the ends never rest on a tombstone
+  while (ring->head != ring->tail &&
+         *_order_ring_slot(ring, ring->head) == NULL)
+    ring->head++;
+  while (ring->tail != ring->head &&
+         *_order_ring_slot(ring, ring->tail - 1) == NULL)
+    ring->tail--;
+}
+
+struct order* order_ring_first(struct order_ring* ring) {
+  return ring->head != ring->tail ? *_order_ring_slot(ring, ring->head) : NULL;
+}
+
+struct order* order_ring_last(struct order_ring* ring) {
+  return ring->head != ring->tail ? *_order_ring_slot(ring, ring->tail - 1)
+                                  : NULL;
+}
+
+struct order* order_ring_next(struct order_ring* ring, struct order* order) {
+  for (uint32_t i = order->ring_slot + 1; i != ring->tail; i++) {
+    struct order* next = *_order_ring_slot(ring, i);
+    if (next != NULL)
+      return next;
+  }
+  return NULL;
+}
@@ -4,7 +4,6 @@
 #include <string.h>
 
 #include "limit.h"
-#include "order_metadata.h"
 
 #define MIN(a, b)           \
   ({                        \
@@ -22,25 +21,290 @@
 
 #define CLAMP(x, min, max) (MIN(max, MAX(x, min)))
 
+// the tree holding the orders of `side`
+static inline struct limit_tree* _orderbook_tree(struct orderbook* ob,
+                                                 enum side side) {
+  switch (side) {
+    case SIDE_BID:
+      return ob->bid;
+    case SIDE_ASK:
+      return ob->ask;
+    default:
+      fprintf(stderr, "received unrecognised order side");
+      exit(1);
+  }
+}
+
+// hands the events batched so far over to the handler
+void _orderbook_hand_over_events(struct orderbook* ob) {
+  struct event_handler* handler = ob->handler;
+  if (handler && handler->batch_len != 0) {
+    handler->handle_batch(ob->id, handler->batch, handler->batch_len,
+                          handler->user_data);
+    handler->batch_len = 0;
+  }
+}
+
+// returns the next free event in the batch, handing it over first if it is full
+struct event* _orderbook_next_event(struct orderbook* ob) {
+  if (ob->handler->batch_len == ob->handler->batch_capacity)
+    _orderbook_hand_over_events(ob);
+  return &ob->handler->batch[ob->handler->batch_len++];
+}
+
 void _orderbook_handle_order_event(struct orderbook* ob,
                                    struct order_event event) {
-  if (ob->handler && ob->handler->handle_order_event)
+  if (ob->handler && ob->handler->handle_batch)
+    *_orderbook_next_event(ob) =
+        (struct event){.type = EVENT_TYPE_ORDER, .order_event = event};
+  else if (ob->handler && ob->handler->handle_order_event)
     ob->handler->handle_order_event(ob->id, event, ob->handler->user_data);
 }
 
 void _orderbook_handle_trade_event(struct orderbook* ob,
                                    struct trade_event event) {
-  if (ob->handler && ob->handler->handle_trade_event)
+  if (ob->handler && ob->handler->handle_batch)
+    *_orderbook_next_event(ob) =
+        (struct event){.type = EVENT_TYPE_TRADE, .trade_event = event};
+  else if (ob->handler && ob->handler->handle_trade_event)
     ob->handler->handle_trade_event(ob->id, event, ob->handler->user_data);
 }
 
+void _orderbook_handle_level_update_event(struct orderbook* ob,
+                                          struct level_update_event event) {
+  if (ob->handler->handle_batch)
+    *_orderbook_next_event(ob) = (struct event){
+        .type = EVENT_TYPE_LEVEL_UPDATE, .level_update_event = event};
+  else if (ob->handler->handle_level_update_event)
+    ob->handler->handle_level_update_event(ob->id, event,
+                                           ob->handler->user_data);
+}
+
+// notes that the level of `side` at `price` has changed, if the handler wants
+// level updates, so that it is reported once the operation is done
+void _orderbook_level_changed(struct orderbook* ob,
+                              enum side side,
+                              uint64_t price) {
+  if (ob->depth_publisher != NULL)
+    depth_publisher_touch(ob->depth_publisher, side, price);
+  if (ob->handler == NULL || !ob->handler->level_updates)
+    return;
+
+  // filling or adding orders one after another mostly hits the same level
+  uint64_t key = price << 1 | side;
+  if (ob->level_updates_len != 0 &&
+      ob->level_updates[ob->level_updates_len - 1] == key)
+    return;
+  if (uint64_swissmap_put(&ob->level_update_set, key, (void*)1) != NULL)
+    return;
+
+  if (ob->level_updates_len == ob->level_updates_capacity) {
+    ob->level_updates_capacity = MAX(ob->level_updates_capacity * 2, 16u);
+    ob->level_updates = realloc(
+        ob->level_updates, sizeof(uint64_t) * ob->level_updates_capacity);
+  }
+  ob->level_updates[ob->level_updates_len++] = key;
+}
+
+// publishes the best levels to the readers of the book, which see it as it is
+// at the end of an operation, never halfway
+void _orderbook_publish(struct orderbook* ob) {
+  top_of_book_publish(ob->top_of_book, ob->bid->best, ob->ask->best);
+  if (ob->depth_publisher != NULL)
+    depth_publisher_flush(ob->depth_publisher, ob->bid, ob->ask, false);
+}
+
+// ends an operation, the levels it changed are reported with their state now
+// and then its events are handed over
+void _orderbook_flush_events(struct orderbook* ob) {
+  for (uint32_t i = 0; i < ob->level_updates_len; i++) {
+    uint64_t key = ob->level_updates[i];
+    enum side side = key & 1;
+    uint64_t price = key >> 1;
+
+    struct limit* limit = limit_tree_get(_orderbook_tree(ob, side), price);
+    _orderbook_handle_level_update_event(
+        ob, (struct level_update_event){
+                .side = side,
+                .price = price,
+                .volume = limit != NULL ? limit->volume : 0,
+                .order_count = limit != NULL ? limit->order_count : 0});
+    uint64_swissmap_remove(&ob->level_update_set, key);
+  }
+  ob->level_updates_len = 0;
+
+  _orderbook_publish(ob);
+  _orderbook_hand_over_events(ob);
+}
+
+struct orderbook_config orderbook_config_default() {
+  return (struct orderbook_config){
+      .limit_tree_kind = LIMIT_TREE_KIND_RB_TREE,
+      .ladder_tick = 1,
+      .ladder_capacity = 4096,
+      .order_pool_capacity = 4096,
+      .limit_pool_capacity = 1024,
+      .incremental_rehash = false,
+      .order_index_pages = 0,
+      .depth_aggregates = false,
+      .queue_positions = false,
+      .order_rings = false,
+      .compact_orders = false,
+      .order_map_capacity = UINT64_SWISSMAP_DEFAULT_CAPACITY,
+      .level_map_capacity = UINT64_SWISSMAP_DEFAULT_CAPACITY,
+      .huge_pages = false,
+      .lock_memory = false,
+  };
+}
+
+struct orderbook_config orderbook_config_sized(uint32_t expected_orders,
+                                               uint32_t expected_levels) {
+  struct orderbook_config config = orderbook_config_default();
+  config.order_pool_capacity = expected_orders;
+  config.limit_pool_capacity = 2 * expected_levels;  // for both sides
+  config.order_map_capacity = expected_orders;
+  config.level_map_capacity = expected_levels;
+  return config;
+}
+
+static inline size_t _orderbook_order_size(struct orderbook_config config) {
+  return config.compact_orders ? ORDER_HOT_SIZE : sizeof(struct order);
+}
+
+size_t orderbook_reserved_size(struct orderbook_config config) {
+  // each of the five is aligned on its own
+  return object_pool_slab_size(_orderbook_order_size(config),
+                               config.order_pool_capacity) +
+         object_pool_slab_size(sizeof(struct limit),
+                               config.limit_pool_capacity) +
+         uint64_swissmap_memory_size(config.order_map_capacity) +
+         2 * uint64_swissmap_memory_size(config.level_map_capacity) +
+         5 * PAGE_RESERVATION_ALIGN;
+}
+
+// a pool with room for `capacity` objects up front, in `reservation` if it
+// is mapped
+struct object_pool* _orderbook_pool_new(size_t object_size,
+                                        uint64_t capacity,
+                                        struct page_reservation* reservation) {
+  struct object_pool* pool = malloc(sizeof(struct object_pool));
+  size_t bytes = object_pool_slab_size(object_size, capacity);
+  void* memory = page_reservation_alloc(reservation, bytes);
+  *pool = object_pool_new(object_size, memory != NULL ? 0 : capacity);
+  if (memory != NULL)
+    object_pool_adopt(pool, memory, bytes);
+  return pool;
+}
+
+// a map with room for `capacity` entries up front, in `reservation` if it is
+// mapped
+struct uint64_swissmap _orderbook_map_new(
+    uint32_t capacity,
+    struct page_reservation* reservation) {
+  void* memory = page_reservation_alloc(
+      reservation, uint64_swissmap_memory_size(capacity));
+  return memory != NULL ? uint64_swissmap_with_memory(capacity, memory)
+                        : uint64_swissmap_with_capacity(capacity);
+}
+
 struct orderbook orderbook_new() {
+  return orderbook_new_with_config(orderbook_config_default());
+}
+
+struct orderbook orderbook_new_with_config(struct orderbook_config config) {
   struct limit_tree* bid = malloc(sizeof(struct limit_tree));
   struct limit_tree* ask = malloc(sizeof(struct limit_tree));
-  *bid = limit_tree_new(SIDE_BID);
-  *ask = limit_tree_new(SIDE_ASK);
-  return (struct orderbook){
-      .bid = bid, .ask = ask, .order_metadata_map = uint64_hashmap_new()};
+
+  switch (config.limit_tree_kind) {
+    case LIMIT_TREE_KIND_RB_TREE:
+      *bid = limit_tree_new(SIDE_BID);
+      *ask = limit_tree_new(SIDE_ASK);
+      break;
+    case LIMIT_TREE_KIND_LADDER:
+      *bid = limit_tree_new_ladder(SIDE_BID, config.ladder_tick,
+                                   config.ladder_capacity);
+      *ask = limit_tree_new_ladder(SIDE_ASK, config.ladder_tick,
+                                   config.ladder_capacity);
+      break;
+    case LIMIT_TREE_KIND_BPTREE:
+      *bid = limit_tree_new_bptree(SIDE_BID);
+      *ask = limit_tree_new_bptree(SIDE_ASK);
+      break;
+    default:
+      fprintf(stderr, "received unrecognised limit tree kind");
+      exit(1);
+  }
+
+  // a compact order has no room for the links of a list or a queue slot, its
+  // level keeps it in a ring and finds it by price
+  if (config.compact_orders) {
+    config.order_rings = true;
+    config.queue_positions = false;
+  }
+  bid->compact_orders = ask->compact_orders = config.compact_orders;
+
+  // the pools and maps are carved out of it instead of allocated one by one
+  struct page_reservation reservation = {0};
+  if (config.huge_pages)
+    reservation = page_reservation_new(orderbook_reserved_size(config),
+                                       config.lock_memory);
+
+  // both sides share the pools, they are only released in `orderbook_free()`
+  struct object_pool* order_pool = _orderbook_pool_new(
+      _orderbook_order_size(config), config.order_pool_capacity, &reservation);
+  struct object_pool* limit_pool = _orderbook_pool_new(
+      sizeof(struct limit), config.limit_pool_capacity, &reservation);
+  bid->order_pool = ask->order_pool = order_pool;
+  bid->limit_pool = ask->limit_pool = limit_pool;
+
+  // costs a walk up the tree per volume change, only the red-black tree has
+  // every limit in it to sum up
+  bid->aggregates = ask->aggregates =
+      config.depth_aggregates &&
+      config.limit_tree_kind == LIMIT_TREE_KIND_RB_TREE;
+
+  struct uint64_swissmap order_map =
+      _orderbook_map_new(config.order_map_capacity, &reservation);
+  uint64_swissmap_free(&bid->price_limit_map);
+  uint64_swissmap_free(&ask->price_limit_map);
+  bid->price_limit_map =
+      _orderbook_map_new(config.level_map_capacity, &reservation);
+  ask->price_limit_map =
+      _orderbook_map_new(config.level_map_capacity, &reservation);
+
+  // trades a slightly slower lookup while resizing for no latency spike
+  order_map.incremental = config.incremental_rehash;
+  bid->price_limit_map.incremental = config.incremental_rehash;
+  ask->price_limit_map.incremental = config.incremental_rehash;
+
+  struct order_index* order_index = NULL;
+  if (config.order_index_pages != 0) {
+    order_index = malloc(sizeof(struct order_index));
+    *order_index = order_index_new(config.order_index_pages);
+  }
+
+  struct trigger_book* triggers = malloc(sizeof(struct trigger_book));
+  *triggers = trigger_book_new();
+
+  // a cache line of its own, polled by other threads
+  struct top_of_book* top_of_book =
+      aligned_alloc(_Alignof(struct top_of_book), sizeof(struct top_of_book));
+  *top_of_book = top_of_book_new();
+
+  return (struct orderbook){.bid = bid,
+                            .ask = ask,
+                            .level_update_set = uint64_swissmap_new(),
+                            .triggers = triggers,
+                            .top_of_book = top_of_book,
+                            .queue_positions = config.queue_positions,
+                            .order_rings = config.order_rings,
+                            .compact_orders = config.compact_orders,
+                            .user_data_map = uint64_swissmap_new(),
+                            .order_map = order_map,
+                            .order_index = order_index,
+                            .order_pool = order_pool,
+                            .limit_pool = limit_pool,
+                            .reservation = reservation};
 }
 
 void orderbook_set_event_handler(struct orderbook* ob,
@@ -48,20 +312,120 @@ void orderbook_set_event_handler(struct orderbook* ob,
   ob->handler = handler;
 }
 
+void orderbook_set_depth_publisher(struct orderbook* ob,
+                                   struct depth_publisher* publisher) {
+  ob->depth_publisher = publisher;
+  if (publisher != NULL)
+    depth_publisher_flush(publisher, ob->bid, ob->ask, true);
+}
+
+// deallocates the ring and Fenwick tree of every level, the only part of the
+// book that is not in the pools
+void _orderbook_free_queues(struct orderbook* ob) {
+  if (!ob->order_rings && !ob->queue_positions)
+    return;
+
+  for (enum side side = SIDE_BID; side <= SIDE_ASK; side++) {
+    struct limit_tree* tree = _orderbook_tree(ob, side);
+    for (struct limit* limit = limit_tree_min(tree); limit != NULL;
+         limit = limit_tree_next(tree, limit))
+      limit_free_queues(limit);
+  }
+}
+
 void orderbook_free(struct orderbook* ob) {
-  limit_tree_free(ob->bid);
-  limit_tree_free(ob->ask);
+  // Every order and heap limit is in the pools, so neither the trees nor the
+  // queues of orders are walked
+  _orderbook_free_queues(ob);
+  limit_tree_free_index(ob->bid);
+  limit_tree_free_index(ob->ask);
   free(ob->bid);
   free(ob->ask);
 
-  // Free the order metadatas
-  for (int i = 0; i < ob->order_metadata_map.capacity; i++)
-    if (ob->order_metadata_map.table[i].value != NULL)
-      free(ob->order_metadata_map.table[i].value);
-  uint64_hashmap_free(&ob->order_metadata_map);
+  // Return the slabs with whatever orders and limits are still in them
+  object_pool_free(ob->order_pool);
+  object_pool_free(ob->limit_pool);
+  free(ob->order_pool);
+  free(ob->limit_pool);
+
+  // The orders themselves went back with the slabs
+  uint64_swissmap_free(&ob->order_map);
+  uint64_swissmap_free(&ob->user_data_map);
+  if (ob->order_index != NULL) {
+    order_index_free(ob->order_index);
+    free(ob->order_index);
+  }
+
+  trigger_book_free(ob->triggers);
+  free(ob->triggers);
+  free(ob->top_of_book);
+
+  free(ob->level_updates);
+  uint64_swissmap_free(&ob->level_update_set);
+
+  // Last, the pools and maps above may have been carved out of it
+  page_reservation_free(&ob->reservation);
 }
 
-void orderbook_limit(struct orderbook* ob, struct order _order) {
+// index the order by its id, in the direct-mapped index if it fits
+void _orderbook_index_order(struct orderbook* ob, struct order* order) {
+  if (ob->order_index == NULL ||
+      !order_index_put(ob->order_index, order->order_id, order))
+    uint64_swissmap_put(&ob->order_map, order->order_id, order);
+}
+
+struct order* _orderbook_find_order(struct orderbook* ob, uint64_t order_id) {
+  if (ob->order_index != NULL) {
+    struct order* order = order_index_get(ob->order_index, order_id);
+    if (order != NULL || ob->order_map.size == 0)
+      return order;
+  }
+  return uint64_swissmap_get(&ob->order_map, order_id);
+}
+
+void _orderbook_unindex_order(struct orderbook* ob, uint64_t order_id) {
+  if (ob->user_data_map.size != 0)
+    uint64_swissmap_remove(&ob->user_data_map, order_id);
+  if (ob->order_index != NULL &&
+      order_index_remove(ob->order_index, order_id) != NULL)
+    return;
+  uint64_swissmap_remove(&ob->order_map, order_id);
+}
+
+// the limit holding a resting order, which a compact order has no link to
+struct limit* _orderbook_order_limit(struct orderbook* ob,
+                                     struct order* order) {
+  if (ob->compact_orders)
+    return limit_tree_get(_orderbook_tree(ob, order->side), order->price);
+  return order->limit;
+}
+
+// the `user_data` of a resting order, which a compact order keeps in a map
+void* _orderbook_order_user_data(struct orderbook* ob, struct order* order) {
+  if (ob->compact_orders)
+    return uint64_swissmap_get(&ob->user_data_map, order->order_id);
+  return order->user_data;
+}
+
+// hands out the next slot in the queue of `limit` to `order`, which has just
+// joined the back of it, or starts the queue over once there is none left
+void _orderbook_queue_push(struct limit* limit, struct order* order) {
+  struct order_fenwick* queue = &limit->queue;
+  if (queue->len < queue->capacity) {
+    order->queue_slot = order_fenwick_push(queue, order->size);
+    return;
+  }
+
+  // with room for as many orders again as are resting, this happens at most
+  // once every `order_count` pushes
+  order_fenwick_reset(queue, 2 * limit->order_count);
+  for (struct order* curr = limit->order_head; curr != NULL;
+       curr = limit_next_order(limit, curr))
+    curr->queue_slot = order_fenwick_push(queue, curr->size);
+}
+
+// adds the order to the book, without emitting any event
+struct order* _orderbook_rest(struct orderbook* ob, struct order _order) {
   struct limit_tree* tree;
   switch (_order.side) {
     case SIDE_BID:
@@ -75,42 +439,63 @@ void orderbook_limit(struct orderbook* ob, struct order _order) {
       exit(1);
   }
 
-  // Make a copy of order on the heap, will be deallocated in `limit_free()`
-  struct order* order = malloc(sizeof(struct order));
-  *order = _order;
+  // Make a copy of order in the pool, will be released in `limit_free()`
+  struct order* order = object_pool_alloc(ob->order_pool);
+  if (ob->compact_orders) {
+    memcpy(order, &_order, ORDER_HOT_SIZE);
+    if (_order.user_data != NULL)
+      uint64_swissmap_put(&ob->user_data_map, order->order_id,
+                          _order.user_data);
+  } else {
+    *order = _order;
+  }
 
-  // Put the order onto the metadata map
-  struct order_metadata* order_metadata = malloc(sizeof(struct order_metadata));
-  *order_metadata = (struct order_metadata){.order = order};
-  uint64_hashmap_put(&ob->order_metadata_map, order->order_id, order_metadata);
+  // Index the order by its id
+  _orderbook_index_order(ob, order);
 
   // Check if the price limit exists
-  struct limit* found =
-      (struct limit*)uint64_hashmap_get(&tree->price_limit_map, order->price);
+  struct limit* found = limit_tree_get(tree, order->price);
 
+  struct limit* limit = found;
   if (found != NULL && found->order_tail != NULL) {
-    found->order_tail->next = order;  // append order to queue
-    order->prev = found->order_tail;  // backlink to previous order
+    if (found->ring.slots != NULL) {
+      order_ring_push(&found->ring, order);  // append order to queue
+    } else {
+      found->order_tail->next = order;  // append order to queue
+      order->prev = found->order_tail;  // backlink to previous order
+    }
     found->order_tail = order;        // make order last in queue
-    order->limit = found;             // backlink to containing limit
     found->order_count++;             // increment order count
     found->volume += order->size;     // increment limit volume
+    limit_tree_aggregate(tree, found, order->size, 1);
   } else {
-    // Make a new limit on the heap, will be deallocated in `limit_tree_free()`
-    struct limit* limit = malloc(sizeof(struct limit));
-    *limit = (struct limit){.price = order->price,
-                            .volume = order->size,
-                            .order_head = order,
-                            .order_tail = order,
-                            .order_count = 1};
-
-    order->limit = limit;         // backlink to containing limit
-    limit_tree_add(tree, limit);  // add limit to tree
-    uint64_hashmap_put(&tree->price_limit_map, order->price,
-                       limit);            // add limit to map
+    // Make a new limit, will be deallocated in `limit_tree_free()`
+    limit = limit_tree_insert(tree, order->price);
+    limit->volume = order->size;
+    limit->order_head = order;
+    limit->order_tail = order;
+    limit->order_count = 1;
+    limit_tree_aggregate(tree, limit, order->size, 1);
+    if (ob->order_rings) {
+      limit->ring = order_ring_new();
+      order_ring_push(&limit->ring, order);
+    }
+
     limit_tree_update_best(tree, limit);  // update best limit
   }
 
+  if (!ob->compact_orders)
+    order->limit = limit;  // backlink to containing limit
+  if (ob->queue_positions)
+    _orderbook_queue_push(limit, order);
+
+  _orderbook_level_changed(ob, order->side, order->price);
+  return order;
+}
+
+void orderbook_limit(struct orderbook* ob, struct order _order) {
+  struct order* order = _orderbook_rest(ob, _order);
+
   // Emit an order created event
   if (order->cum_filled_size == 0)
     _orderbook_handle_order_event(ob, (struct order_event){
@@ -122,16 +507,58 @@ void orderbook_limit(struct orderbook* ob, struct order _order) {
                                           .remaining_size = order->size,
                                           .price = order->price,
                                       });
+
+  _orderbook_flush_events(ob);
 }
 
-uint64_t orderbook_execute(struct orderbook* ob,
-                           const uint64_t order_id,
-                           const enum side side,
-                           const uint64_t size,
-                           uint64_t execute_size,
-                           bool is_market) {
+// the match loop is a template shared with the sinks of `orderbook_sink.h`
+// and flushed and published by `orderbook_execute()` once the triggers are
+// done
+#define ORDERBOOK_SINK_EXECUTE _orderbook_execute
+#define ORDERBOOK_SINK_PUBLISH(ob)
+#define ORDERBOOK_SINK_LEVEL_CHANGED(ob, side, price) \
+  _orderbook_level_changed(ob, side, price)
+#define ORDERBOOK_SINK_ORDER_EVENT(ob, event) \
+  _orderbook_handle_order_event(ob, event)
+#define ORDERBOOK_SINK_TRADE_EVENT(ob, event) \
+  _orderbook_handle_trade_event(ob, event)
+#include "orderbook_sink.h"
+
+// whether a `side` order at `price` would match a resting order at `resting`
+static inline bool _orderbook_crosses(enum side side,
+                                      uint64_t price,
+                                      uint64_t resting) {
+  return side == SIDE_BID ? resting <= price : resting >= price;
+}
+
+// whether the levels crossing `price` hold at least `size`, walking only as
+// many of them as it takes
+bool _orderbook_can_fill(struct limit_tree* tree,
+                         enum side side,
+                         uint64_t price,
+                         uint64_t size) {
+  if (tree->aggregates)  // summed up in O(log n) instead
+    return limit_tree_volume_to(tree, price) >= size;
+
+  for (struct limit* limit = tree->best;
+       limit != NULL && _orderbook_crosses(side, price, limit->price);
+       limit = side == SIDE_BID ? limit_tree_next(tree, limit)
+                                : limit_tree_prev(tree, limit)) {
+    if (limit->volume >= size)
+      return true;
+    size -= limit->volume;
+  }
+
+  return false;
+}
+
+// `orderbook_place()` without activating the triggers or flushing the events
+uint64_t _orderbook_place(struct orderbook* ob,
+                          struct order order,
+                          enum time_in_force time_in_force,
+                          bool post_only) {
   struct limit_tree* tree;
-  switch (side) {
+  switch (order.side) {
     case SIDE_BID:
       tree = ob->ask;
       break;
@@ -143,175 +570,173 @@ uint64_t orderbook_execute(struct orderbook* ob,
       exit(1);
   }
 
-  // reject if no liquidity
-  if (tree->best == NULL) {
+  const uint64_t size = order.size;
+  const bool crosses = tree->best != NULL &&
+                       _orderbook_crosses(order.side, order.price,
+                                          tree->best->price);
+
+  // reject before anything is matched
+  enum reject_reason reject_reason = REJECT_REASON_NO_ERROR;
+  if (post_only && crosses)
+    reject_reason = REJECT_REASON_WOULD_CROSS;
+  else if (time_in_force == TIME_IN_FORCE_FOK &&
+           !_orderbook_can_fill(tree, order.side, order.price, size))
+    reject_reason = REJECT_REASON_NO_LIQUIDITY;
+
+  if (reject_reason != REJECT_REASON_NO_ERROR) {
     _orderbook_handle_order_event(
         ob, (struct order_event){.status = ORDER_STATUS_REJECTED,
-                                 .order_id = order_id,
-                                 .side = side,
-                                 .filled_size = 0,
-                                 .cum_filled_size = 0,
-                                 .remaining_size = execute_size,
-                                 .price = 0,
-                                 .reject_reason = REJECT_REASON_NO_LIQUIDITY});
-    return execute_size;
+                                 .order_id = order.order_id,
+                                 .side = order.side,
+                                 .remaining_size = size,
+                                 .price = order.price,
+                                 .reject_reason = reject_reason});
+    return size;
   }
 
-  // emit order event created
   _orderbook_handle_order_event(
-      ob,
-      (struct order_event){
-          .status = ORDER_STATUS_CREATED,
-          .order_id = order_id,
-          .side = side,
-          .filled_size = 0,
-          .cum_filled_size = 0,
-          .remaining_size = size,
-          .price = !is_market && tree->best != NULL ? tree->best->price : 0});
-
-  uint64_t cum_filled_size = 0;  // cumulative filled size
-
-  // keep matching until no liquidity left or market order is fulfilled
-  while (tree->best != NULL && execute_size > 0) {
-    struct order* match = tree->best->order_head;  // always match top in queue
-    uint64_t fill_size =
-        MIN(execute_size, match->size);  // fill only available size
-
-    // fill order
-    match->size -= fill_size;
-    execute_size -= fill_size;
-    match->cum_filled_size += fill_size;
-    cum_filled_size += fill_size;
-    tree->best->volume -= fill_size;  // update limit volume
-
-    // emit order event for order in book
-    _orderbook_handle_order_event(
-        ob, (struct order_event){.status = match->size == 0
-                                               ? ORDER_STATUS_FILLED
-                                               : ORDER_STATUS_PARTIALLY_FILLED,
-                                 .order_id = match->order_id,
-                                 .side = match->side,
-                                 .filled_size = fill_size,
-                                 .cum_filled_size = match->cum_filled_size,
-                                 .remaining_size = match->size,
-                                 .price = match->price});
-    // emit order event for the market order
-    _orderbook_handle_order_event(
-        ob, (struct order_event){.status = (size - cum_filled_size) == 0
-                                               ? ORDER_STATUS_FILLED
-                                               : ORDER_STATUS_PARTIALLY_FILLED,
-                                 .order_id = order_id,
-                                 .side = side,
-                                 .filled_size = fill_size,
-                                 .cum_filled_size = cum_filled_size,
-                                 .remaining_size = size - cum_filled_size,
-                                 .price = match->price});
-    // emit trade event
-    _orderbook_handle_trade_event(ob,
-                                  (struct trade_event){.size = fill_size,
-                                                       .side = side,
-                                                       .price = match->price,
-                                                       .buyer_order_id = side == SIDE_BID ? order_id : match->order_id,
-                                                       .seller_order_id = side == SIDE_BID ? match->order_id : order_id});
-
-    if (match->size == 0) {  // order in book is fully filled
-
-      if (tree->best->order_count == 1) {  // limit has no other orders
-
-        free(uint64_hashmap_remove(&ob->order_metadata_map,
-                                   match->order_id));  // remove order metadata
-        uint64_hashmap_remove(&tree->price_limit_map,
-                              match->price);  // remove price
-        limit_tree_remove(tree, tree->best);  // remove the limit
-        limit_tree_update_best(tree, NULL);   // find next best
-
-      } else {  // limit still has other orders
-
-        free(uint64_hashmap_remove(&ob->order_metadata_map,
-                                   match->order_id));  // remove order metadata
-        tree->best->order_head = match->next;  // replace top with next in queue
-        free(match);                           // free filled order
-        tree->best->order_head->prev = NULL;   // remove dangling pointer
-        tree->best->order_count--;             // decrement limit order count
-
-        // find next best if it was filled
-        if (tree->best->order_head == NULL)
-          limit_tree_update_best(tree, NULL);
-      }
+      ob, (struct order_event){.status = ORDER_STATUS_CREATED,
+                               .order_id = order.order_id,
+                               .side = order.side,
+                               .remaining_size = size,
+                               .price = order.price});
+
+  uint64_t filled_size =
+      crosses ? _orderbook_execute_match(ob, tree, order.order_id, order.side,
+                                         size, size, order.price)
+              : 0;
+
+  if (filled_size < size) {
+    if (time_in_force == TIME_IN_FORCE_GTC) {  // the rest goes in the book
+      order.size = size - filled_size;
+      order.cum_filled_size = filled_size;
+      _orderbook_rest(ob, order);
+    } else {  // IOC, a FOK order has been filled entirely
+      _orderbook_handle_order_event(
+          ob, (struct order_event){
+                  .status = filled_size == 0
+                                ? ORDER_STATUS_CANCELLED
+                                : ORDER_STATUS_PARTIALLY_FILLED_CANCELLED,
+                  .order_id = order.order_id,
+                  .side = order.side,
+                  .cum_filled_size = filled_size,
+                  .remaining_size = size - filled_size,
+                  .price = order.price});
     }
   }
 
-  // not enough liquidity to fulfill market order
-  if (is_market && execute_size > 0)
+  return size - filled_size;
+}
+
+// places the triggers crossed by the last price, including the ones crossed
+// by the trades of those placed before
+void _orderbook_trigger(struct orderbook* ob) {
+  struct trigger_order trigger;
+  while (ob->triggers->size != 0 && ob->last_price != 0 &&
+         trigger_book_pop(ob->triggers, ob->last_price, &trigger)) {
+    struct order order = trigger.order;
     _orderbook_handle_order_event(
-        ob,
-        (struct order_event){.status = ORDER_STATUS_PARTIALLY_FILLED_CANCELLED,
-                             .order_id = order_id,
-                             .side = side,
-                             .filled_size = 0,
-                             .cum_filled_size = cum_filled_size,
-                             .remaining_size = execute_size,
-                             .price = 0});
+        ob, (struct order_event){.status = ORDER_STATUS_TRIGGERED,
+                                 .order_id = order.order_id,
+                                 .side = order.side,
+                                 .remaining_size = order.size,
+                                 .price = order.price});
+
+    switch (trigger.type) {
+      case TRIGGER_TYPE_STOP:
+      case TRIGGER_TYPE_TAKE_PROFIT:
+        _orderbook_execute(ob, order.order_id, order.side, order.size,
+                           order.size, true);
+        break;
+      case TRIGGER_TYPE_STOP_LIMIT:
+      case TRIGGER_TYPE_TAKE_PROFIT_LIMIT:
+        order.price = trigger.price;
+        order.limit = NULL;
+        order.prev = order.next = NULL;
+        _orderbook_place(ob, order, TIME_IN_FORCE_GTC, false);
+        break;
+    }
+  }
+}
+
+uint64_t orderbook_execute(struct orderbook* ob,
+                           const uint64_t order_id,
+                           const enum side side,
+                           const uint64_t size,
+                           uint64_t execute_size,
+                           bool is_market) {
+  uint64_t remaining_size =
+      _orderbook_execute(ob, order_id, side, size, execute_size, is_market);
+  _orderbook_trigger(ob);
+  _orderbook_flush_events(ob);
+  return remaining_size;
+}
 
-  return size - cum_filled_size;
+uint64_t orderbook_place(struct orderbook* ob,
+                         struct order order,
+                         enum time_in_force time_in_force,
+                         bool post_only) {
+  uint64_t remaining_size =
+      _orderbook_place(ob, order, time_in_force, post_only);
+  _orderbook_trigger(ob);
+  _orderbook_flush_events(ob);
+  return remaining_size;
 }
 
-enum orderbook_error orderbook_cancel(struct orderbook* ob,
-                                      const uint64_t order_id) {
-  struct order_metadata* order_metadata =
-      (struct order_metadata*)uint64_hashmap_get(&ob->order_metadata_map,
-                                                 order_id);
-  if (order_metadata == NULL)
-    return OBERR_ORDER_NOT_FOUND;
+void orderbook_place_trigger(struct orderbook* ob,
+                             struct order order,
+                             enum trigger_type type,
+                             uint64_t trigger_price) {
+  struct trigger_order trigger = {.order = order,
+                                  .price = order.price,
+                                  .type = type};
+  trigger.order.price = trigger_price;
+  trigger_book_add(ob->triggers, trigger);
 
-  if (order_metadata->order == NULL) {
-    fprintf(stderr, "order is NULL orderbook_cancel: order_id: %ld\n",
-            order_id);
-    exit(EXIT_FAILURE);
-  }
-  if (order_metadata->order->limit == NULL) {
-    fprintf(stderr, "order->limit is NULL orderbook_cancel: order_id: %ld\n",
-            order_id);
-    exit(EXIT_FAILURE);
-  }
-  struct order* order = order_metadata->order;
-  struct limit* limit = order->limit;
-  struct order_event event = {.status = ORDER_STATUS_CANCELLED,
+  _orderbook_handle_order_event(
+      ob, (struct order_event){.status = ORDER_STATUS_PENDING_TRIGGER,
+                               .order_id = order.order_id,
+                               .side = order.side,
+                               .remaining_size = order.size,
+                               .price = trigger_price});
+
+  _orderbook_trigger(ob);  // already crossed
+  _orderbook_flush_events(ob);
+}
+
+// the event reporting that a resting order has been cancelled
+static inline struct order_event _orderbook_cancelled_event(
+    const struct order* order) {
+  return (struct order_event){.status = ORDER_STATUS_CANCELLED,
                               .order_id = order->order_id,
                               .side = order->side,
                               .filled_size = 0,
                               .cum_filled_size = order->cum_filled_size,
                               .remaining_size = order->size,
                               .price = order->price};
+}
 
-  struct limit_tree* tree;
-  switch (order->side) {
-    case SIDE_BID:
-      tree = ob->bid;
-      break;
-    case SIDE_ASK:
-      tree = ob->ask;
-      break;
-    default:
-      fprintf(stderr, "received unrecognised order side");
-      exit(1);
-  }
+// takes the order out of its limit and releases it, the limit too if empty
+void _orderbook_unlink_order(struct orderbook* ob,
+                             struct limit_tree* tree,
+                             struct order* order) {
+  struct limit* limit = _orderbook_order_limit(ob, order);
+  _orderbook_level_changed(ob, order->side, order->price);
 
   if (limit->order_count == 1) {  // only order in the limit
 
-    bool is_best = tree->best == limit;  // check if limit is best
-    uint64_hashmap_remove(&tree->price_limit_map,
-                          limit->price);  // remove price
-    limit_tree_remove(tree, limit);       // remove the limit
-
-    if (is_best)                           // if the limit is previous best
-      limit_tree_update_best(tree, NULL);  // find next best
+    limit_tree_remove(tree, limit);  // remove the limit, updates the best
 
   } else {  // has other orders in the limit
 
-    if (order == limit->order_head) {   // order is head
-      limit->order_head = order->next;  // replace head with next in queue
-      limit->order_head->prev = NULL;   // remove dangling pointer
+    if (limit->ring.slots != NULL) {  // leaves a tombstone in the ring
+      order_ring_remove(&limit->ring, order);
+      limit->order_head = order_ring_first(&limit->ring);
+      limit->order_tail = order_ring_last(&limit->ring);
+
+    } else if (order == limit->order_head) {  // order is head
+      limit->order_head = order->next;        // replace head with next in queue
+      limit->order_head->prev = NULL;         // remove dangling pointer
 
     } else if (order == limit->order_tail) {  // order is tail
       limit->order_tail = order->prev;        // replace tail with prev in queue
@@ -322,73 +747,392 @@ enum orderbook_error orderbook_cancel(struct orderbook* ob,
       order->next->prev = order->prev;  // replace prev with order prev
     }
 
-    limit->volume -= order->size;  // decrease total limit volume
-    limit->order_count--;          // decrement order count
-    free(order);                   // free cancelled order
+    limit->volume -= order->size;                // decrease total limit volume
+    limit->order_count--;                        // decrement order count
+    limit_tree_aggregate(tree, limit, -(int64_t)order->size, -1);
+    if (ob->queue_positions)
+      order_fenwick_add(&limit->queue, order->queue_slot,
+                        -(int64_t)order->size, -1);
+    object_pool_release(ob->order_pool, order);  // free cancelled order
   }
+}
+
+// cancels a stop or take profit order that has not been triggered yet
+enum orderbook_error _orderbook_cancel_trigger(struct orderbook* ob,
+                                               uint64_t order_id) {
+  struct trigger_order trigger;
+  if (ob->triggers->size == 0 ||
+      !trigger_book_remove(ob->triggers, order_id, &trigger))
+    return OBERR_ORDER_NOT_FOUND;
+
+  _orderbook_handle_order_event(ob, _orderbook_cancelled_event(&trigger.order));
+  _orderbook_flush_events(ob);
+  return OBERR_OKAY;
+}
+
+enum orderbook_error orderbook_cancel(struct orderbook* ob,
+                                      const uint64_t order_id) {
+  struct order* order = _orderbook_find_order(ob, order_id);
+  if (order == NULL)
+    return _orderbook_cancel_trigger(ob, order_id);
+
+  if (_orderbook_order_limit(ob, order) == NULL) {
+    fprintf(stderr, "order->limit is NULL orderbook_cancel: order_id: %ld\n",
+            order_id);
+    exit(EXIT_FAILURE);
+  }
+  struct order_event event = _orderbook_cancelled_event(order);
+
+  _orderbook_unlink_order(ob, _orderbook_tree(ob, order->side), order);
 
-  free(uint64_hashmap_remove(&ob->order_metadata_map,
-                             order_id));     // remove order metadata
-  _orderbook_handle_order_event(ob, event);  // emit order cancelled event
+  _orderbook_unindex_order(ob, order_id);    // unindex the order
+  _orderbook_handle_order_event(ob, event);  // emit cancelled event
+  _orderbook_flush_events(ob);
 
   return OBERR_OKAY;
 }
 
+void _orderbook_handle_mass_cancel_event(struct orderbook* ob,
+                                         struct mass_cancel_event event) {
+  if (ob->handler && ob->handler->handle_batch)
+    *_orderbook_next_event(ob) = (struct event){
+        .type = EVENT_TYPE_MASS_CANCEL, .mass_cancel_event = event};
+  else if (ob->handler && ob->handler->handle_mass_cancel_event)
+    ob->handler->handle_mass_cancel_event(ob->id, event,
+                                          ob->handler->user_data);
+}
+
+// unindexes a cancelled order and reports it, on its own or in `summary`
+void _orderbook_mass_cancelled(struct orderbook* ob,
+                               struct order* order,
+                               struct mass_cancel_event* summary,
+                               bool summarise) {
+  _orderbook_unindex_order(ob, order->order_id);
+  summary->order_count++;
+  summary->size += order->size;
+
+  if (!summarise)
+    _orderbook_handle_order_event(ob, _orderbook_cancelled_event(order));
+}
+
+// reports every order queued at `limit` as cancelled, without releasing them
+void _orderbook_mass_cancel_limit(struct orderbook* ob,
+                                  struct limit* limit,
+                                  struct mass_cancel_event* summary,
+                                  bool summarise) {
+  _orderbook_level_changed(ob, limit->order_head->side, limit->price);
+  for (struct order* order = limit->order_head; order != NULL;
+       order = limit_next_order(limit, order))
+    _orderbook_mass_cancelled(ob, order, summary, summarise);
+}
+
+// emits the summary of a side, if asked for and anything was cancelled
+/**
+ * A mass cancel of the pending triggers on one side, of any owner unless
+ * `by_owner` is set
+ */
+struct _orderbook_trigger_cancel {
+  struct orderbook* ob;
+  struct mass_cancel_event* summary;
+  bool summarise;
+  enum side side;
+  bool by_owner;
+  void* user_data;
+};
+
+bool _orderbook_trigger_cancel_filter(const struct trigger_order* trigger,
+                                      void* context) {
+  struct _orderbook_trigger_cancel* cancel = context;
+  return trigger->order.side == cancel->side &&
+         (!cancel->by_owner || trigger->order.user_data == cancel->user_data);
+}
+
+void _orderbook_trigger_cancelled(const struct trigger_order* trigger,
+                                  void* context) {
+  struct _orderbook_trigger_cancel* cancel = context;
+  cancel->summary->order_count++;
+  cancel->summary->size += trigger->order.size;
+  if (!cancel->summarise)
+    _orderbook_handle_order_event(cancel->ob,
+                                  _orderbook_cancelled_event(&trigger->order));
+}
+
+// cancels the pending triggers a mass cancel covers, after its resting orders
+void _orderbook_mass_cancel_triggers(struct orderbook* ob,
+                                     struct _orderbook_trigger_cancel cancel) {
+  if (ob->triggers->size != 0)
+    trigger_book_remove_all(ob->triggers, _orderbook_trigger_cancel_filter,
+                            _orderbook_trigger_cancelled, &cancel);
+}
+
+uint64_t _orderbook_mass_cancel_done(struct orderbook* ob,
+                                     struct mass_cancel_event summary,
+                                     bool summarise) {
+  if (summarise && summary.order_count != 0)
+    _orderbook_handle_mass_cancel_event(ob, summary);
+  return summary.order_count;
+}
+
+uint64_t _orderbook_cancel_side(struct orderbook* ob,
+                                enum side side,
+                                bool summarise) {
+  struct limit_tree* tree = _orderbook_tree(ob, side);
+  struct mass_cancel_event summary = {.side = side};
+
+  // Best first, so the events come in the same order as cancelling each. The
+  // pools are shared with the other side, so the orders go back one by one
+  struct limit* limit = tree->best;
+  while (limit != NULL) {
+    _orderbook_level_changed(ob, side, limit->price);
+    struct order* order = limit->order_head;
+    while (order != NULL) {
+      struct order* next = limit_next_order(limit, order);
+      _orderbook_mass_cancelled(ob, order, &summary, summarise);
+      object_pool_release(ob->order_pool, order);
+      order = next;
+    }
+    limit_free_queues(limit);  // the only part not in the pools
+    limit = side == SIDE_BID ? limit_tree_prev(tree, limit)
+                             : limit_tree_next(tree, limit);
+  }
+
+  // Then drop every level at once, handing the heap ones back too
+  if (tree->size != 0)
+    limit_tree_clear(tree, true);
+
+  _orderbook_mass_cancel_triggers(
+      ob, (struct _orderbook_trigger_cancel){.ob = ob,
+                                              .summary = &summary,
+                                              .summarise = summarise,
+                                              .side = side});
+
+  return _orderbook_mass_cancel_done(ob, summary, summarise);
+}
+
+// empties the pools and the id maps, once every order in them has been taken
+// out of the trees
+void _orderbook_release_all(struct orderbook* ob) {
+  object_pool_reset(ob->order_pool);
+  object_pool_reset(ob->limit_pool);
+  uint64_swissmap_clear(&ob->order_map);
+  uint64_swissmap_clear(&ob->user_data_map);
+  if (ob->order_index != NULL)
+    order_index_clear(ob->order_index);
+}
+
+uint64_t orderbook_cancel_all(struct orderbook* ob, bool summarise) {
+  uint64_t cancelled = 0;
+  for (enum side side = SIDE_BID; side <= SIDE_ASK; side++) {
+    struct limit_tree* tree = _orderbook_tree(ob, side);
+    struct mass_cancel_event summary = {.side = side};
+
+    // Nothing is left to unindex or release one by one, a summary only needs
+    // the totals of each level
+    struct limit* limit = tree->best;
+    while (limit != NULL) {
+      summary.order_count += limit->order_count;
+      summary.size += limit->volume;
+      _orderbook_level_changed(ob, side, limit->price);
+      if (!summarise)
+        for (struct order* order = limit->order_head; order != NULL;
+             order = limit_next_order(limit, order))
+          _orderbook_handle_order_event(ob, _orderbook_cancelled_event(order));
+      limit_free_queues(limit);  // the only part not in the pools
+      limit = side == SIDE_BID ? limit_tree_prev(tree, limit)
+                               : limit_tree_next(tree, limit);
+    }
+
+    limit_tree_clear(tree, false);
+    _orderbook_mass_cancel_triggers(
+        ob, (struct _orderbook_trigger_cancel){.ob = ob,
+                                                .summary = &summary,
+                                                .summarise = summarise,
+                                                .side = side});
+    cancelled += _orderbook_mass_cancel_done(ob, summary, summarise);
+  }
+
+  // Every order and heap limit in the pools was in the book
+  _orderbook_release_all(ob);
+
+  _orderbook_flush_events(ob);
+  return cancelled;
+}
+
+void orderbook_reset(struct orderbook* ob) {
+  _orderbook_free_queues(ob);
+  limit_tree_clear(ob->bid, false);
+  limit_tree_clear(ob->ask, false);
+  _orderbook_release_all(ob);
+  trigger_book_clear(ob->triggers);
+  ob->last_price = 0;
+  top_of_book_publish(ob->top_of_book, NULL, NULL);
+  if (ob->depth_publisher != NULL)
+    depth_publisher_flush(ob->depth_publisher, ob->bid, ob->ask, true);
+}
+
+uint64_t orderbook_cancel_side(struct orderbook* ob,
+                               enum side side,
+                               bool summarise) {
+  uint64_t cancelled = _orderbook_cancel_side(ob, side, summarise);
+  _orderbook_flush_events(ob);
+  return cancelled;
+}
+
+uint64_t orderbook_cancel_range(struct orderbook* ob,
+                                enum side side,
+                                uint64_t min_price,
+                                uint64_t max_price,
+                                bool summarise) {
+  struct limit_tree* tree = _orderbook_tree(ob, side);
+  struct mass_cancel_event summary = {.side = side};
+
+  struct limit* limit = limit_tree_ceil(tree, min_price);
+  while (limit != NULL && limit->price <= max_price) {
+    struct limit* next = limit_tree_next(tree, limit);
+    _orderbook_mass_cancel_limit(ob, limit, &summary, summarise);
+    limit_tree_remove(tree, limit);  // drops the level with all its orders
+    limit = next;
+  }
+
+  uint64_t cancelled = _orderbook_mass_cancel_done(ob, summary, summarise);
+  _orderbook_flush_events(ob);
+  return cancelled;
+}
+
+uint64_t orderbook_cancel_owner(struct orderbook* ob,
+                                void* user_data,
+                                bool summarise) {
+  uint64_t cancelled = 0;
+  for (enum side side = SIDE_BID; side <= SIDE_ASK; side++) {
+    struct limit_tree* tree = _orderbook_tree(ob, side);
+    struct mass_cancel_event summary = {.side = side};
+
+    struct limit* limit = limit_tree_min(tree);
+    while (limit != NULL) {
+      // the limit goes away with its last order, so step past it first
+      struct limit* next = limit_tree_next(tree, limit);
+      struct order* order = limit->order_head;
+      while (order != NULL) {
+        struct order* next_order = limit_next_order(limit, order);
+        if (_orderbook_order_user_data(ob, order) == user_data) {
+          _orderbook_mass_cancelled(ob, order, &summary, summarise);
+          _orderbook_unlink_order(ob, tree, order);
+        }
+        order = next_order;
+      }
+      limit = next;
+    }
+
+    _orderbook_mass_cancel_triggers(
+        ob, (struct _orderbook_trigger_cancel){.ob = ob,
+                                                .summary = &summary,
+                                                .summarise = summarise,
+                                                .side = side,
+                                                .by_owner = true,
+                                                .user_data = user_data});
+    cancelled += _orderbook_mass_cancel_done(ob, summary, summarise);
+  }
+  _orderbook_flush_events(ob);
+  return cancelled;
+}
+
 enum orderbook_error orderbook_amend_size(struct orderbook* ob,
                                           const uint64_t order_id,
                                           uint64_t size) {
   if (size <= 0)
     return OBERR_INVALID_ORDER_SIZE;
 
-  struct order_metadata* order_metadata =
-      (struct order_metadata*)uint64_hashmap_get(&ob->order_metadata_map,
-                                                 order_id);
-  if (order_metadata == NULL)
+  struct order* order = _orderbook_find_order(ob, order_id);
+  if (order == NULL)
     return OBERR_ORDER_NOT_FOUND;
 
-  struct order* order = order_metadata->order;
-  struct limit* limit = order->limit;
+  struct limit* limit = _orderbook_order_limit(ob, order);
 
   limit->volume += size - order->size;
+  limit_tree_aggregate(_orderbook_tree(ob, order->side), limit,
+                       (int64_t)(size - order->size), 0);
+  if (ob->queue_positions)
+    order_fenwick_add(&limit->queue, order->queue_slot,
+                      (int64_t)(size - order->size), 0);
   order->size = size;
 
+  _orderbook_level_changed(ob, order->side, order->price);
+  _orderbook_flush_events(ob);
   return OBERR_OKAY;
 }
 
-/**
- * Traverse (post-order) the limit tree to find the top n bids.
- */
-void _orderbook_top_n_bid(struct limit* node,
-                          uint32_t* i,
-                          const uint32_t n,
-                          struct limit* buffer) {
-  if (node == NULL)
-    return;
-
-  _orderbook_top_n_bid(node->right, i, n, buffer);
+// how many commands ahead the index entry, then the order, are prefetched
+#define ORDERBOOK_BATCH_PREFETCH_ENTRY 16
+#define ORDERBOOK_BATCH_PREFETCH_ORDER 8
 
-  if (*i < n)
-    buffer[(*i)++] = *node;
-
-  _orderbook_top_n_bid(node->left, i, n, buffer);
+static inline bool _orderbook_looks_up(const struct ob_command* command) {
+  return command->type == OB_COMMAND_CANCEL ||
+         command->type == OB_COMMAND_AMEND_SIZE;
 }
 
-/**
- * Traverse (in-order) the limit tree to find the top n asks.
- */
-void _orderbook_top_n_ask(struct limit* node,
-                          uint32_t* i,
-                          const uint32_t n,
-                          struct limit* buffer) {
-  if (node == NULL)
-    return;
+void _orderbook_prefetch_entry(struct orderbook* ob, uint64_t order_id) {
+  if (ob->order_index == NULL ||
+      !order_index_prefetch(ob->order_index, order_id))
+    uint64_swissmap_prefetch(&ob->order_map, order_id);
+}
 
-  _orderbook_top_n_ask(node->left, i, n, buffer);
+void orderbook_process_batch(struct orderbook* ob,
+                             const struct ob_command* commands,
+                             size_t n,
+                             struct ob_result* results) {
+  for (size_t i = 0; i < n; i++) {
+    // the entry was prefetched earlier, so the order can be found cheaply
+    if (i + ORDERBOOK_BATCH_PREFETCH_ENTRY < n &&
+        _orderbook_looks_up(&commands[i + ORDERBOOK_BATCH_PREFETCH_ENTRY]))
+      _orderbook_prefetch_entry(
+          ob, commands[i + ORDERBOOK_BATCH_PREFETCH_ENTRY].order_id);
+    if (i + ORDERBOOK_BATCH_PREFETCH_ORDER < n &&
+        _orderbook_looks_up(&commands[i + ORDERBOOK_BATCH_PREFETCH_ORDER])) {
+      struct order* order = _orderbook_find_order(
+          ob, commands[i + ORDERBOOK_BATCH_PREFETCH_ORDER].order_id);
+      if (order != NULL)
+        __builtin_prefetch(order);
+    }
 
-  if (*i < n)
-    buffer[(*i)++] = *node;
+    const struct ob_command* command = &commands[i];
+    struct ob_result result = {.error = OBERR_OKAY};
+
+    switch (command->type) {
+      case OB_COMMAND_LIMIT:
+        orderbook_limit(ob, (struct order){.order_id = command->order_id,
+                                           .side = command->side,
+                                           .price = command->price,
+                                           .size = command->size});
+        break;
+      case OB_COMMAND_MARKET:
+        result.remaining_size =
+            orderbook_execute(ob, command->order_id, command->side,
+                              command->size, command->size, true);
+        break;
+      case OB_COMMAND_PLACE:
+        result.remaining_size =
+            orderbook_place(ob,
+                            (struct order){.order_id = command->order_id,
+                                           .side = command->side,
+                                           .price = command->price,
+                                           .size = command->size},
+                            command->time_in_force, command->post_only);
+        break;
+      case OB_COMMAND_CANCEL:
+        result.error = orderbook_cancel(ob, command->order_id);
+        break;
+      case OB_COMMAND_AMEND_SIZE:
+        result.error =
+            orderbook_amend_size(ob, command->order_id, command->size);
+        break;
+      default:
+        fprintf(stderr, "received unrecognised command type");
+        exit(1);
+    }
 
-  _orderbook_top_n_ask(node->right, i, n, buffer);
+    if (results != NULL)
+      results[i] = result;
+  }
 }
 
 uint32_t orderbook_top_n(struct orderbook* ob,
@@ -398,11 +1142,15 @@ uint32_t orderbook_top_n(struct orderbook* ob,
   uint32_t i = 0;
 
   switch (side) {
-    case SIDE_BID:
-      _orderbook_top_n_bid(ob->bid->root, &i, n, buffer);
+    case SIDE_BID:  // highest price first
+      for (struct limit* limit = limit_tree_max(ob->bid);
+           limit != NULL && i < n; limit = limit_tree_prev(ob->bid, limit))
+        buffer[i++] = *limit;
       break;
-    case SIDE_ASK:
-      _orderbook_top_n_ask(ob->ask->root, &i, n, buffer);
+    case SIDE_ASK:  // lowest price first
+      for (struct limit* limit = limit_tree_min(ob->ask);
+           limit != NULL && i < n; limit = limit_tree_next(ob->ask, limit))
+        buffer[i++] = *limit;
       break;
     default:
       fprintf(stderr, "received unrecognised order side");
@@ -412,16 +1160,59 @@ uint32_t orderbook_top_n(struct orderbook* ob,
   return i;
 }
 
-// a helper function to traverse the tree reverse in-order
-void _orderbook_print_limit_tree(char* str, size_t* len, struct limit* node) {
-  if (node == NULL)
-    return;
+uint64_t orderbook_volume_to_price(struct orderbook* ob,
+                                   enum side side,
+                                   uint64_t price) {
+  return limit_tree_volume_to(side == SIDE_BID ? ob->ask : ob->bid, price);
+}
+
+struct limit_tree_fill orderbook_cost_to_fill(struct orderbook* ob,
+                                              enum side side,
+                                              uint64_t size) {
+  return limit_tree_cost_to_fill(side == SIDE_BID ? ob->ask : ob->bid, size);
+}
 
-  _orderbook_print_limit_tree(str, len, node->right);
-  // *len += sprintf(str + *len, "%ld (%ld) [%ld]\n", node->price, node->volume,
-  //                 node->order_count);
-  *len += sprintf(str + *len, "%ld (%ld)\n", node->price, node->volume);
-  _orderbook_print_limit_tree(str, len, node->left);
+struct orderbook_fork orderbook_fork(struct orderbook* ob, uint32_t depth) {
+  struct orderbook_fork fork = orderbook_fork_new(ob->bid, ob->ask, depth);
+  fork.last_price = ob->last_price;
+  return fork;
+}
+
+enum orderbook_error orderbook_queue_position(struct orderbook* ob,
+                                              uint64_t order_id,
+                                              struct queue_position* position) {
+  struct order* order = _orderbook_find_order(ob, order_id);
+  if (order == NULL)
+    return OBERR_ORDER_NOT_FOUND;
+
+  struct limit* limit = _orderbook_order_limit(ob, order);
+  if (ob->queue_positions) {
+    struct order_fenwick_sum ahead =
+        order_fenwick_prefix(&limit->queue, order->queue_slot);
+    *position = (struct queue_position){.orders_ahead = ahead.count,
+                                        .volume_ahead = ahead.volume};
+    return OBERR_OKAY;
+  }
+
+  *position = (struct queue_position){0};
+  for (struct order* curr = limit->order_head; curr != order;
+       curr = limit_next_order(limit, curr)) {
+    position->orders_ahead++;
+    position->volume_ahead += curr->size;
+  }
+  return OBERR_OKAY;
+}
+
+// a helper function to traverse the tree from the highest price
+void _orderbook_print_limit_tree(char* str,
+                                 size_t* len,
+                                 struct limit_tree* tree) {
+  for (struct limit* limit = limit_tree_max(tree); limit != NULL;
+       limit = limit_tree_prev(tree, limit)) {
+    // *len += sprintf(str + *len, "%ld (%ld) [%ld]\n", limit->price,
+    //                 limit->volume, limit->order_count);
+    *len += sprintf(str + *len, "%ld (%ld)\n", limit->price, limit->volume);
+  }
 }
 
 char* orderbook_print(struct orderbook* ob) {
@@ -429,9 +1220,9 @@ char* orderbook_print(struct orderbook* ob) {
   char* str = malloc(size * sizeof(char));
   size_t len = 0;
 
-  _orderbook_print_limit_tree(str, &len, ob->ask->root);
+  _orderbook_print_limit_tree(str, &len, ob->ask);
   len += sprintf(str + len, "-----------------------\n");
-  _orderbook_print_limit_tree(str, &len, ob->bid->root);
+  _orderbook_print_limit_tree(str, &len, ob->bid);
 
   return str;
-}
+}
\ No newline at end of file
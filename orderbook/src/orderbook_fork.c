@@ -0,0 +1,140 @@
+#include "orderbook_fork.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct orderbook_snapshot {
+  atomic_uint_fast32_t refs;  // forks sharing it
+  uint32_t count[2];          // levels of each side
+  struct orderbook_fork_level* levels[2];
+  struct orderbook_fork_level buffer[];  // bids then asks, best first
+};
+
+/**
+ * Copy the `depth` best limits of `tree` to `buffer`, returns how many
+ */
+uint32_t _orderbook_fork_copy(struct limit_tree* tree,
+                              uint32_t depth,
+                              struct orderbook_fork_level* buffer) {
+  uint32_t i = 0;
+  for (struct limit* limit = tree->best; limit != NULL && i < depth;
+       limit = tree->side == SIDE_BID ? limit_tree_prev(tree, limit)
+                                      : limit_tree_next(tree, limit))
+    buffer[i++] = (struct orderbook_fork_level){.price = limit->price,
+                                                .volume = limit->volume};
+  return i;
+}
+
+struct orderbook_fork orderbook_fork_new(struct limit_tree* bid,
+                                         struct limit_tree* ask,
+                                         uint32_t depth) {
+  uint32_t bid_depth = depth == 0 || depth > bid->size ? bid->size : depth;
+  uint32_t ask_depth = depth == 0 || depth > ask->size ? ask->size : depth;
+
+  struct orderbook_snapshot* snapshot =
+      malloc(sizeof(struct orderbook_snapshot) +
+             (bid_depth + ask_depth) * sizeof(struct orderbook_fork_level));
+  if (snapshot == NULL) {
+    fprintf(stderr, "failed to allocate orderbook snapshot\n");
+    exit(1);
+  }
+
+  atomic_init(&snapshot->refs, 1);
+  snapshot->levels[SIDE_BID] = snapshot->buffer;
+  snapshot->count[SIDE_BID] =
+      _orderbook_fork_copy(bid, bid_depth, snapshot->levels[SIDE_BID]);
+  snapshot->levels[SIDE_ASK] = snapshot->buffer + snapshot->count[SIDE_BID];
+  snapshot->count[SIDE_ASK] =
+      _orderbook_fork_copy(ask, ask_depth, snapshot->levels[SIDE_ASK]);
+
+  return (struct orderbook_fork){.snapshot = snapshot};
+}
+
+struct orderbook_fork orderbook_fork_clone(struct orderbook_fork* fork) {
+  atomic_fetch_add_explicit(&fork->snapshot->refs, 1, memory_order_relaxed);
+  return *fork;
+}
+
+void orderbook_fork_free(struct orderbook_fork* fork) {
+  if (fork->snapshot == NULL)
+    return;
+
+  // the last fork out frees it, and has to see every write of the others
+  if (atomic_fetch_sub_explicit(&fork->snapshot->refs, 1,
+                                memory_order_acq_rel) == 1)
+    free(fork->snapshot);
+  fork->snapshot = NULL;
+}
+
+/**
+ * Walk the levels left on `side` of the fork filling `size`, and take what
+ * was filled off the fork if `take` is set
+ */
+struct limit_tree_fill _orderbook_fork_fill(struct orderbook_fork* fork,
+                                            enum side side,
+                                            uint64_t size,
+                                            bool take) {
+  struct limit_tree_fill fill = {0};
+  const struct orderbook_fork_level* levels = fork->snapshot->levels[side];
+  uint32_t i = fork->taken[side];
+  uint64_t taken = fork->taken_volume[side];
+
+  while (i < fork->snapshot->count[side] && fill.size < size) {
+    uint64_t left = levels[i].volume - taken;
+    uint64_t amount = size - fill.size;
+    if (amount > left)
+      amount = left;
+
+    fill.size += amount;
+    fill.cost += levels[i].price * amount;
+    fill.worst_price = levels[i].price;
+    if (amount == left) {
+      i++;
+      taken = 0;
+    } else {
+      taken += amount;
+    }
+  }
+
+  if (take) {
+    fork->taken[side] = i;
+    fork->taken_volume[side] = taken;
+    if (fill.size != 0)
+      fork->last_price = fill.worst_price;
+  }
+  return fill;
+}
+
+struct limit_tree_fill orderbook_fork_execute(struct orderbook_fork* fork,
+                                              enum side side,
+                                              uint64_t size) {
+  return _orderbook_fork_fill(fork, side == SIDE_BID ? SIDE_ASK : SIDE_BID,
+                              size, true);
+}
+
+struct limit_tree_fill orderbook_fork_cost_to_fill(struct orderbook_fork* fork,
+                                                   enum side side,
+                                                   uint64_t size) {
+  return _orderbook_fork_fill(fork, side == SIDE_BID ? SIDE_ASK : SIDE_BID,
+                              size, false);
+}
+
+uint32_t orderbook_fork_top_n(struct orderbook_fork* fork,
+                              enum side side,
+                              uint32_t n,
+                              struct orderbook_fork_level* buffer) {
+  if (side != SIDE_BID && side != SIDE_ASK) {
+    fprintf(stderr, "received unrecognised order side");
+    exit(1);
+  }
+
+  const struct orderbook_fork_level* levels = fork->snapshot->levels[side];
+  uint32_t first = fork->taken[side];
+  uint32_t i = 0;
+  for (; i < n && first + i < fork->snapshot->count[side]; i++)
+    buffer[i] = levels[first + i];
+  if (i != 0)  // the best level left may have been partly taken
+    buffer[0].volume -= fork->taken_volume[side];
+  return i;
+}
@@ -0,0 +1,104 @@
+#include "page_reservation.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * Map `size` bytes of normal pages aligned to the huge page size, which
+ * transparent huge pages need to back all of it. A huge page more is mapped
+ * and whatever is left over on either side is unmapped again.
+ */
+unsigned char* _page_reservation_map_aligned(size_t size) {
+  const size_t huge = PAGE_RESERVATION_HUGE_PAGE_SIZE;
+  size_t padded = size + huge;
+  unsigned char* mapped = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED)
+    return NULL;
+
+  uintptr_t start = ((uintptr_t)mapped + huge - 1) & ~(uintptr_t)(huge - 1);
+  size_t head = start - (uintptr_t)mapped;
+  if (head != 0)
+    munmap(mapped, head);
+  munmap((unsigned char*)start + size, padded - head - size);
+  return (unsigned char*)start;
+}
+
+/**
+ * Whether advising `MADV_HUGEPAGE` gets transparent huge pages at all. The
+ * advice is accepted even with them turned off, the setting in use is the one
+ * in brackets, eg. "always [madvise] never".
+ */
+bool _page_reservation_transparent_enabled() {
+  FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (file == NULL)
+    return false;
+
+  char setting[64] = {0};
+  bool read = fgets(setting, sizeof(setting), file) != NULL;
+  fclose(file);
+  return read && (strstr(setting, "[always]") != NULL ||
+                  strstr(setting, "[madvise]") != NULL);
+}
+
+struct page_reservation page_reservation_new(size_t bytes, bool lock) {
+  const size_t huge = PAGE_RESERVATION_HUGE_PAGE_SIZE;
+  struct page_reservation reservation = {
+      .size = bytes == 0 ? huge : (bytes + huge - 1) & ~(huge - 1)};
+
+#ifdef MAP_HUGETLB
+  // fails right away unless enough huge pages are reserved in the system
+  void* mapped =
+      mmap(NULL, reservation.size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mapped != MAP_FAILED) {
+    reservation.base = mapped;
+    reservation.kind = PAGE_KIND_HUGETLB;
+  }
+#endif
+
+  if (reservation.base == NULL) {
+    reservation.base = _page_reservation_map_aligned(reservation.size);
+    if (reservation.base == NULL) {
+      fprintf(stderr, "failed to map %zu bytes for page reservation\n",
+              reservation.size);
+      exit(EXIT_FAILURE);
+    }
+
+    reservation.kind = PAGE_KIND_NORMAL;
+#ifdef MADV_HUGEPAGE
+    if (madvise(reservation.base, reservation.size, MADV_HUGEPAGE) == 0 &&
+        _page_reservation_transparent_enabled())
+      reservation.kind = PAGE_KIND_TRANSPARENT;
+#endif
+  }
+
+  // Fault every page in now, the mapping is zeroed so it stays that way
+  const size_t page = sysconf(_SC_PAGESIZE);
+  for (size_t offset = 0; offset < reservation.size; offset += page)
+    ((volatile unsigned char*)reservation.base)[offset] = 0;
+
+  reservation.locked = lock && mlock(reservation.base, reservation.size) == 0;
+  return reservation;
+}
+
+void page_reservation_free(struct page_reservation* reservation) {
+  if (reservation->base != NULL)
+    munmap(reservation->base, reservation->size);  // unlocks it too
+  *reservation = (struct page_reservation){0};
+}
+
+void* page_reservation_alloc(struct page_reservation* reservation,
+                             size_t bytes) {
+  size_t offset = (reservation->used + PAGE_RESERVATION_ALIGN - 1) &
+                  ~(size_t)(PAGE_RESERVATION_ALIGN - 1);
+  if (reservation->base == NULL || offset + bytes > reservation->size)
+    return NULL;
+
+  reservation->used = offset + bytes;
+  return reservation->base + offset;
+}
@@ -0,0 +1,76 @@
+#include "top_of_book.h"
+
+#include <stdbool.h>
+
+struct top_of_book top_of_book_new() {
+  return (struct top_of_book){0};
+}
+
+static inline struct top_of_book_level _top_of_book_level(
+    const struct limit* limit) {
+  if (limit == NULL)
+    return (struct top_of_book_level){0};
+  return (struct top_of_book_level){.price = limit->price,
+                                    .volume = limit->volume,
+                                    .order_count = limit->order_count};
+}
+
+// only the writer calls these, so the levels it reads back are its own
+static inline bool _top_of_book_level_eq(const struct top_of_book_level* a,
+                                         const struct top_of_book_level* b) {
+  return a->price == b->price && a->volume == b->volume &&
+         a->order_count == b->order_count;
+}
+
+static inline void _top_of_book_store(struct top_of_book_level* level,
+                                      struct top_of_book_level value) {
+  __atomic_store_n(&level->price, value.price, __ATOMIC_RELAXED);
+  __atomic_store_n(&level->volume, value.volume, __ATOMIC_RELAXED);
+  __atomic_store_n(&level->order_count, value.order_count, __ATOMIC_RELAXED);
+}
+
+static inline struct top_of_book_level _top_of_book_load(
+    const struct top_of_book_level* level) {
+  return (struct top_of_book_level){
+      .price = __atomic_load_n(&level->price, __ATOMIC_RELAXED),
+      .volume = __atomic_load_n(&level->volume, __ATOMIC_RELAXED),
+      .order_count = __atomic_load_n(&level->order_count, __ATOMIC_RELAXED)};
+}
+
+void top_of_book_publish(struct top_of_book* top,
+                         const struct limit* bid,
+                         const struct limit* ask) {
+  struct top_of_book_level best_bid = _top_of_book_level(bid);
+  struct top_of_book_level best_ask = _top_of_book_level(ask);
+  if (_top_of_book_level_eq(&top->bid, &best_bid) &&
+      _top_of_book_level_eq(&top->ask, &best_ask))
+    return;
+
+  // the odd sequence has to be visible before any of the levels change
+  uint64_t sequence = top->sequence;
+  __atomic_store_n(&top->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  _top_of_book_store(&top->bid, best_bid);
+  _top_of_book_store(&top->ask, best_ask);
+
+  // and the levels before the even one
+  __atomic_store_n(&top->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+struct top_of_book_quote top_of_book_read(const struct top_of_book* top) {
+  struct top_of_book_quote quote;
+  for (;;) {
+    quote.sequence = __atomic_load_n(&top->sequence, __ATOMIC_ACQUIRE);
+    if (quote.sequence & 1)  // the writer is halfway through an update
+      continue;
+
+    quote.bid = _top_of_book_load(&top->bid);
+    quote.ask = _top_of_book_load(&top->ask);
+
+    // the levels have to be read before the sequence is checked again
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&top->sequence, __ATOMIC_RELAXED) == quote.sequence)
+      return quote;
+  }
+}
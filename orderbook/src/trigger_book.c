@@ -0,0 +1,173 @@
+#include "trigger_book.h"
+
+#include <stdlib.h>
+
+struct trigger_book trigger_book_new() {
+  struct object_pool* trigger_pool = malloc(sizeof(struct object_pool));
+  struct object_pool* limit_pool = malloc(sizeof(struct object_pool));
+  *trigger_pool = object_pool_new(sizeof(struct trigger_order), 0);
+  *limit_pool = object_pool_new(sizeof(struct limit), 0);
+
+  // the best ask is the lowest price and the best bid the highest, which is
+  // the next trigger crossed by a rise and a fall respectively
+  struct trigger_book book = {.rising = limit_tree_new(SIDE_ASK),
+                              .falling = limit_tree_new(SIDE_BID),
+                              .trigger_map = uint64_swissmap_new(),
+                              .trigger_pool = trigger_pool,
+                              .limit_pool = limit_pool};
+  book.rising.order_pool = book.falling.order_pool = trigger_pool;
+  book.rising.limit_pool = book.falling.limit_pool = limit_pool;
+  return book;
+}
+
+void trigger_book_free(struct trigger_book* book) {
+  // every trigger and limit goes back to the system with the pools
+  limit_tree_free_index(&book->rising);
+  limit_tree_free_index(&book->falling);
+  uint64_swissmap_free(&book->trigger_map);
+  object_pool_free(book->trigger_pool);
+  object_pool_free(book->limit_pool);
+  free(book->trigger_pool);
+  free(book->limit_pool);
+}
+
+void trigger_book_clear(struct trigger_book* book) {
+  limit_tree_clear(&book->rising, false);
+  limit_tree_clear(&book->falling, false);
+  uint64_swissmap_clear(&book->trigger_map);
+  object_pool_reset(book->trigger_pool);
+  object_pool_reset(book->limit_pool);
+  book->size = 0;
+}
+
+/**
+ * Returns the tree `trigger` is queued in, a buy stop triggers on a rise and
+ * a buy take profit on a fall, the other way around for a sell.
+ */
+static inline struct limit_tree* _trigger_book_tree(
+    struct trigger_book* book,
+    const struct trigger_order* trigger) {
+  bool stop = trigger->type == TRIGGER_TYPE_STOP ||
+              trigger->type == TRIGGER_TYPE_STOP_LIMIT;
+  bool rising = (trigger->order.side == SIDE_BID) == stop;
+  return rising ? &book->rising : &book->falling;
+}
+
+void trigger_book_add(struct trigger_book* book, struct trigger_order trigger) {
+  struct limit_tree* tree = _trigger_book_tree(book, &trigger);
+
+  struct trigger_order* queued = object_pool_alloc(book->trigger_pool);
+  *queued = trigger;
+  struct order* order = &queued->order;
+  order->prev = order->next = NULL;
+
+  struct limit* limit = limit_tree_get(tree, order->price);
+  if (limit != NULL) {
+    limit->order_tail->next = order;  // append to the queue
+    order->prev = limit->order_tail;
+    limit->order_tail = order;
+    limit->order_count++;
+  } else {
+    limit = limit_tree_insert(tree, order->price);
+    limit->order_head = limit->order_tail = order;
+    limit->order_count = 1;
+    limit_tree_update_best(tree, limit);
+  }
+  limit->volume += order->size;
+  order->limit = limit;
+
+  uint64_swissmap_put(&book->trigger_map, order->order_id, queued);
+  book->size++;
+}
+
+/**
+ * Copy `order` out and take it off its limit, the limit goes too once empty.
+ */
+void _trigger_book_take(struct trigger_book* book,
+                        struct limit_tree* tree,
+                        struct order* order,
+                        struct trigger_order* trigger) {
+  *trigger = *(struct trigger_order*)order;
+  uint64_swissmap_remove(&book->trigger_map, order->order_id);
+  book->size--;
+
+  struct limit* limit = order->limit;
+  if (limit->order_count == 1) {
+    limit_tree_remove(tree, limit);  // releases the order with the limit
+    return;
+  }
+
+  if (order->prev != NULL)
+    order->prev->next = order->next;
+  else
+    limit->order_head = order->next;
+  if (order->next != NULL)
+    order->next->prev = order->prev;
+  else
+    limit->order_tail = order->prev;
+
+  limit->order_count--;
+  limit->volume -= order->size;
+  object_pool_release(book->trigger_pool, order);
+}
+
+bool trigger_book_pop(struct trigger_book* book,
+                      uint64_t last_price,
+                      struct trigger_order* trigger) {
+  struct limit* best = book->rising.best;
+  if (best != NULL && best->price <= last_price) {
+    _trigger_book_take(book, &book->rising, best->order_head, trigger);
+    return true;
+  }
+
+  best = book->falling.best;
+  if (best != NULL && best->price >= last_price) {
+    _trigger_book_take(book, &book->falling, best->order_head, trigger);
+    return true;
+  }
+
+  return false;
+}
+
+bool trigger_book_remove(struct trigger_book* book,
+                         uint64_t order_id,
+                         struct trigger_order* trigger) {
+  struct trigger_order* queued =
+      uint64_swissmap_get(&book->trigger_map, order_id);
+  if (queued == NULL)
+    return false;
+
+  _trigger_book_take(book, _trigger_book_tree(book, queued), &queued->order,
+                     trigger);
+  return true;
+}
+
+uint64_t trigger_book_remove_all(
+    struct trigger_book* book,
+    bool (*filter)(const struct trigger_order* trigger, void* context),
+    void (*removed)(const struct trigger_order* trigger, void* context),
+    void* context) {
+  uint64_t count = 0;
+  struct limit_tree* trees[] = {&book->rising, &book->falling};
+  for (int i = 0; i < 2 && book->size != 0; i++) {
+    struct limit_tree* tree = trees[i];
+    struct limit* limit = limit_tree_min(tree);
+    while (limit != NULL) {
+      // the limit goes away with its last trigger, so step past it first
+      struct limit* next = limit_tree_next(tree, limit);
+      struct order* order = limit->order_head;
+      while (order != NULL) {
+        struct order* next_order = order->next;
+        if (filter((struct trigger_order*)order, context)) {
+          struct trigger_order trigger;
+          _trigger_book_take(book, tree, order, &trigger);
+          removed(&trigger, context);
+          count++;
+        }
+        order = next_order;
+      }
+      limit = next;
+    }
+  }
+  return count;
+}
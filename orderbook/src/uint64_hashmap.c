@@ -26,6 +26,11 @@ uint32_t find_next_positive_power_of_two(uint32_t value) {
 void _uint64_hashmap_compact_chain(struct uint64_hashmap* map,
                                    uint64_t delete_index);
 void _uint64_hashmap_resize(struct uint64_hashmap* map, uint32_t capacity);
+void _uint64_hashmap_start_resize(struct uint64_hashmap* map,
+                                  uint32_t capacity);
+void _uint64_hashmap_migrate(struct uint64_hashmap* map, uint32_t buckets);
+void* _uint64_hashmap_old_get(struct uint64_hashmap* map, uint64_t key);
+void* _uint64_hashmap_old_take(struct uint64_hashmap* map, uint64_t key);
 
 struct uint64_hashmap uint64_hashmap_with_capacity(uint32_t capacity) {
   capacity = find_next_positive_power_of_two(capacity);
@@ -42,8 +47,16 @@ struct uint64_hashmap uint64_hashmap_new() {
   return uint64_hashmap_with_capacity(UINT64_HASHMAP_DEFAULT_CAPACITY);
 }
 
+struct uint64_hashmap uint64_hashmap_incremental_with_capacity(
+    uint32_t capacity) {
+  struct uint64_hashmap map = uint64_hashmap_with_capacity(capacity);
+  map.incremental = true;
+  return map;
+}
+
 void uint64_hashmap_free(struct uint64_hashmap* map) {
   free(map->table);
+  free(map->old_table);
 }
 
 void* uint64_hashmap_put(struct uint64_hashmap* map,
@@ -52,6 +65,9 @@ void* uint64_hashmap_put(struct uint64_hashmap* map,
   if (value == NULL)
     return NULL;
 
+  if (map->old_table != NULL)
+    _uint64_hashmap_migrate(map, UINT64_HASHMAP_MIGRATE_BUCKETS);
+
   const uint64_t mask = map->capacity - 1;
   uint64_t index = uint64_hash(key) & mask;
 
@@ -64,14 +80,22 @@ void* uint64_hashmap_put(struct uint64_hashmap* map,
   }
 
   if (previous_value == NULL) {
-    ++map->size;
+    // the key may not have been migrated yet, it moves over now
+    if (map->old_table != NULL)
+      previous_value = _uint64_hashmap_old_take(map, key);
+    if (previous_value == NULL)
+      ++map->size;
     map->table[index].key = key;
   }
 
   map->table[index].value = value;
 
-  if (map->size > (UINT64_HASHMAP_MAX_LOAD_FACTOR * map->capacity) / 100)
-    _uint64_hashmap_resize(map, map->capacity << 1);
+  if (map->size > (UINT64_HASHMAP_MAX_LOAD_FACTOR * map->capacity) / 100) {
+    if (map->incremental)
+      _uint64_hashmap_start_resize(map, map->capacity << 1);
+    else
+      _uint64_hashmap_resize(map, map->capacity << 1);
+  }
 
   return previous_value;
 }
@@ -87,10 +111,16 @@ void* uint64_hashmap_get(struct uint64_hashmap* map, uint64_t key) {
     index = (index + 1) & mask;
   }
 
+  if (value == NULL && map->old_table != NULL)
+    return _uint64_hashmap_old_get(map, key);
+
   return value;
 }
 
 void* uint64_hashmap_remove(struct uint64_hashmap* map, uint64_t key) {
+  if (map->old_table != NULL)
+    _uint64_hashmap_migrate(map, UINT64_HASHMAP_MIGRATE_BUCKETS);
+
   const uint64_t mask = map->capacity - 1;
   uint64_t index = uint64_hash(key) & mask;
 
@@ -105,10 +135,19 @@ void* uint64_hashmap_remove(struct uint64_hashmap* map, uint64_t key) {
     index = (index + 1) & mask;
   }
 
+  if (value == NULL && map->old_table != NULL) {
+    value = _uint64_hashmap_old_take(map, key);
+    if (value != NULL)
+      map->size--;
+  }
+
   return value;
 }
 
 char* uint64_hashmap_print(struct uint64_hashmap* map) {
+  if (map->old_table != NULL)  // print a single table
+    _uint64_hashmap_migrate(map, map->old_capacity);
+
   char* str = malloc(map->capacity * sizeof(char) * 100);
   size_t len = 0;
 
@@ -173,4 +212,94 @@ void _uint64_hashmap_resize(struct uint64_hashmap* map, uint32_t capacity) {
       uint64_hashmap_put(map, temp[i].key, temp[i].value);
 
   free(temp);
-}
\ No newline at end of file
+}
+
+/**
+ * Marks an old table entry that has been moved to the new table. It is not
+ * cleared since that would cut the probe chains running through it.
+ */
+static char _uint64_hashmap_moved;
+#define MOVED ((void*)&_uint64_hashmap_moved)
+
+/**
+ * Swap in an empty table of `capacity` and keep the current one to be
+ * migrated bit by bit.
+ */
+void _uint64_hashmap_start_resize(struct uint64_hashmap* map,
+                                  uint32_t capacity) {
+  if (map->old_table != NULL)  // still migrating, finish that first
+    _uint64_hashmap_migrate(map, map->old_capacity);
+
+  map->old_table = map->table;
+  map->old_capacity = map->capacity;
+  map->migrate_index = 0;
+
+  map->table = calloc(capacity, sizeof(struct uint64_hashmap_entry));
+  map->capacity = capacity;
+}
+
+/**
+ * Move up to `buckets` buckets of the old table into the new one, the old
+ * table is freed once all of it has been moved.
+ */
+void _uint64_hashmap_migrate(struct uint64_hashmap* map, uint32_t buckets) {
+  const uint64_t mask = map->capacity - 1;
+  uint32_t end = map->migrate_index + buckets;
+  if (end > map->old_capacity)
+    end = map->old_capacity;
+
+  for (; map->migrate_index < end; map->migrate_index++) {
+    struct uint64_hashmap_entry* entry = &map->old_table[map->migrate_index];
+    if (entry->value == NULL || entry->value == MOVED)
+      continue;
+
+    // a key lives in one table only, so it is not in the new one yet
+    uint64_t index = uint64_hash(entry->key) & mask;
+    while (map->table[index].value != NULL)
+      index = (index + 1) & mask;
+    map->table[index] = *entry;
+    entry->value = MOVED;
+  }
+
+  if (map->migrate_index == map->old_capacity) {
+    free(map->old_table);
+    map->old_table = NULL;
+  }
+}
+
+/**
+ * Returns the entry of `key` in the old table, or NULL if it is not there.
+ */
+struct uint64_hashmap_entry* _uint64_hashmap_old_find(
+    struct uint64_hashmap* map,
+    uint64_t key) {
+  const uint64_t mask = map->old_capacity - 1;
+  uint64_t index = uint64_hash(key) & mask;
+
+  while (map->old_table[index].value != NULL) {
+    if (key == map->old_table[index].key)
+      return map->old_table[index].value == MOVED ? NULL
+                                                  : &map->old_table[index];
+    index = (index + 1) & mask;
+  }
+
+  return NULL;
+}
+
+void* _uint64_hashmap_old_get(struct uint64_hashmap* map, uint64_t key) {
+  struct uint64_hashmap_entry* entry = _uint64_hashmap_old_find(map, key);
+  return entry != NULL ? entry->value : NULL;
+}
+
+/**
+ * Removes `key` from the old table, returning its value.
+ */
+void* _uint64_hashmap_old_take(struct uint64_hashmap* map, uint64_t key) {
+  struct uint64_hashmap_entry* entry = _uint64_hashmap_old_find(map, key);
+  if (entry == NULL)
+    return NULL;
+
+  void* value = entry->value;
+  entry->value = MOVED;
+  return value;
+}
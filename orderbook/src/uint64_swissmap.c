@@ -0,0 +1,404 @@
+#include "uint64_swissmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CTRL_EMPTY ((int8_t)0x80)    // never used since the last rehash
+#define CTRL_DELETED ((int8_t)0xfe)  // tombstone, probes continue past it
+
+/**
+ * Group operations, each returns a bitmask with bit `i` set if control byte
+ * `i` of the group matches.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+#define GROUP_WIDTH 32
+
+static inline uint32_t _group_match(const int8_t* group, int8_t byte) {
+  __m256i ctrl = _mm256_loadu_si256((const __m256i*)group);
+  return _mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(byte)));
+}
+
+// empty and deleted are the only control bytes with the sign bit set
+static inline uint32_t _group_match_free(const int8_t* group) {
+  return _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)group));
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define GROUP_WIDTH 16
+
+static inline uint32_t _group_match(const int8_t* group, int8_t byte) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+}
+
+static inline uint32_t _group_match_free(const int8_t* group) {
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+#else
+#define GROUP_WIDTH 16
+
+static inline uint32_t _group_match(const int8_t* group, int8_t byte) {
+  uint32_t mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    mask |= (uint32_t)(group[i] == byte) << i;
+  return mask;
+}
+
+static inline uint32_t _group_match_free(const int8_t* group) {
+  uint32_t mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    mask |= (uint32_t)(group[i] < 0) << i;
+  return mask;
+}
+#endif
+
+// the top 57 bits pick the first slot, the low 7 bits go in the control byte
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash) & 0x7f))
+
+static inline uint32_t _uint64_swissmap_growth(uint32_t capacity) {
+  return (uint64_t)capacity * UINT64_SWISSMAP_MAX_LOAD_FACTOR / 100;
+}
+
+/**
+ * Allocate an empty table of exactly `capacity` slots, a power of 2 and at
+ * least one group.
+ */
+struct uint64_swissmap _uint64_swissmap_alloc(uint32_t capacity) {
+  int8_t* ctrl = malloc(capacity + GROUP_WIDTH - 1);
+  memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH - 1);
+
+  return (struct uint64_swissmap){
+      .capacity = capacity,
+      .growth_left = _uint64_swissmap_growth(capacity),
+      .ctrl = ctrl,
+      .slots = malloc(sizeof(struct uint64_swissmap_slot) * capacity)};
+}
+
+/**
+ * Returns the slots of a table with room for `capacity` entries below the
+ * load factor, in whole groups.
+ */
+static inline uint32_t _uint64_swissmap_slots(uint32_t capacity) {
+  capacity = (uint64_t)capacity * 100 / UINT64_SWISSMAP_MAX_LOAD_FACTOR + 1;
+  if (capacity < GROUP_WIDTH)
+    capacity = GROUP_WIDTH;
+  return find_next_positive_power_of_two(capacity);
+}
+
+struct uint64_swissmap uint64_swissmap_with_capacity(uint32_t capacity) {
+  return _uint64_swissmap_alloc(_uint64_swissmap_slots(capacity));
+}
+
+size_t uint64_swissmap_memory_size(uint32_t capacity) {
+  capacity = _uint64_swissmap_slots(capacity);
+  return sizeof(struct uint64_swissmap_slot) * capacity + capacity +
+         GROUP_WIDTH - 1;
+}
+
+struct uint64_swissmap uint64_swissmap_with_memory(uint32_t capacity,
+                                                   void* memory) {
+  capacity = _uint64_swissmap_slots(capacity);
+  struct uint64_swissmap_slot* slots = memory;
+  int8_t* ctrl = (int8_t*)(slots + capacity);  // the slots keep it aligned
+  memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH - 1);
+
+  return (struct uint64_swissmap){
+      .capacity = capacity,
+      .growth_left = _uint64_swissmap_growth(capacity),
+      .ctrl = ctrl,
+      .slots = slots,
+      .borrowed = true};
+}
+
+struct uint64_swissmap uint64_swissmap_new() {
+  return uint64_swissmap_with_capacity(UINT64_SWISSMAP_DEFAULT_CAPACITY);
+}
+
+struct uint64_swissmap uint64_swissmap_incremental_with_capacity(
+    uint32_t capacity) {
+  struct uint64_swissmap map = uint64_swissmap_with_capacity(capacity);
+  map.incremental = true;
+  return map;
+}
+
+void uint64_swissmap_free(struct uint64_swissmap* map) {
+  if (!map->borrowed) {
+    free(map->ctrl);
+    free(map->slots);
+  }
+  if (map->old != NULL) {
+    uint64_swissmap_free(map->old);
+    free(map->old);
+  }
+}
+
+void uint64_swissmap_clear(struct uint64_swissmap* map) {
+  memset(map->ctrl, CTRL_EMPTY, map->capacity + GROUP_WIDTH - 1);
+  map->size = map->tombstones = 0;
+  map->growth_left = _uint64_swissmap_growth(map->capacity);
+  if (map->old != NULL) {
+    uint64_swissmap_free(map->old);
+    free(map->old);
+    map->old = NULL;
+  }
+}
+
+/**
+ * Set the control byte of slot `index`. The first bytes are cloned past the
+ * end so that a group starting near the end of the table wraps around.
+ */
+static inline void _uint64_swissmap_set_ctrl(struct uint64_swissmap* map,
+                                             uint64_t index,
+                                             int8_t ctrl) {
+  map->ctrl[index] = ctrl;
+  if (index < GROUP_WIDTH - 1)
+    map->ctrl[map->capacity + index] = ctrl;
+}
+
+/**
+ * Returns the slot index of `key`, or -1 if it is absent. A probe starts at
+ * the slot picked by the hash and moves a group further each step, in a
+ * triangular sequence which visits every group once.
+ */
+static inline int64_t _uint64_swissmap_find(struct uint64_swissmap* map,
+                                            uint64_t key,
+                                            uint64_t hash) {
+  const uint64_t mask = map->capacity - 1;
+  uint64_t offset = H1(hash) & mask;
+
+  // a key mostly sits at its first slot, load it alongside the control bytes
+  __builtin_prefetch(&map->slots[offset]);
+
+  for (uint64_t step = 1;; step++) {
+    const int8_t* ctrl = map->ctrl + offset;
+
+    for (uint32_t match = _group_match(ctrl, H2(hash)); match != 0;
+         match &= match - 1) {
+      uint64_t index = (offset + __builtin_ctz(match)) & mask;
+      if (map->slots[index].key == key)
+        return index;
+    }
+
+    // an empty slot means the key would have been placed in this group
+    if (_group_match(ctrl, CTRL_EMPTY) != 0)
+      return -1;
+
+    offset = (offset + step * GROUP_WIDTH) & mask;
+  }
+}
+
+/**
+ * Returns the first empty or deleted slot on the probe sequence of `hash`.
+ */
+static inline uint64_t _uint64_swissmap_find_free(struct uint64_swissmap* map,
+                                                  uint64_t hash) {
+  const uint64_t mask = map->capacity - 1;
+  uint64_t offset = H1(hash) & mask;
+
+  for (uint64_t step = 1;; step++) {
+    uint32_t available = _group_match_free(map->ctrl + offset);
+    if (available != 0)
+      return (offset + __builtin_ctz(available)) & mask;
+
+    offset = (offset + step * GROUP_WIDTH) & mask;
+  }
+}
+
+/**
+ * Place `key`, known to be absent, in the first free slot of its probe. The
+ * table must have a free slot, ie. `growth_left` > 0 or a tombstone to reuse.
+ */
+static inline void _uint64_swissmap_insert(struct uint64_swissmap* map,
+                                           uint64_t hash,
+                                           struct uint64_swissmap_slot slot) {
+  uint64_t index = _uint64_swissmap_find_free(map, hash);
+
+  if (map->ctrl[index] == CTRL_EMPTY)
+    map->growth_left--;
+  else
+    map->tombstones--;
+
+  _uint64_swissmap_set_ctrl(map, index, H2(hash));
+  map->slots[index] = slot;
+}
+
+/**
+ * Rebuild the table with `capacity` slots, dropping every tombstone.
+ */
+void _uint64_swissmap_rehash(struct uint64_swissmap* map, uint32_t capacity) {
+  struct uint64_swissmap old = *map;
+  *map = _uint64_swissmap_alloc(capacity);
+
+  for (uint64_t i = 0; i < old.capacity; i++)
+    if (old.ctrl[i] >= 0)
+      _uint64_swissmap_insert(map, uint64_hash(old.slots[i].key),
+                              old.slots[i]);
+
+  map->size = old.size;
+  uint64_swissmap_free(&old);
+}
+
+/**
+ * Move up to `count` slots of the old table into the current one, the old
+ * table is freed once all of it has been moved.
+ */
+void _uint64_swissmap_migrate(struct uint64_swissmap* map, uint32_t count) {
+  struct uint64_swissmap* old = map->old;
+  uint32_t end = map->migrate_index + count;
+  if (end > old->capacity)
+    end = old->capacity;
+
+  for (; map->migrate_index < end; map->migrate_index++) {
+    uint32_t i = map->migrate_index;
+    if (old->ctrl[i] < 0)
+      continue;
+
+    _uint64_swissmap_insert(map, uint64_hash(old->slots[i].key),
+                            old->slots[i]);
+    _uint64_swissmap_set_ctrl(old, i, CTRL_DELETED);  // keeps probes intact
+  }
+
+  if (map->migrate_index == old->capacity) {
+    uint64_swissmap_free(old);
+    free(old);
+    map->old = NULL;
+  }
+}
+
+/**
+ * Swap in an empty table of `capacity` slots and keep the current one to be
+ * migrated bit by bit.
+ */
+void _uint64_swissmap_start_rehash(struct uint64_swissmap* map,
+                                   uint32_t capacity) {
+  if (map->old != NULL)  // still migrating, finish that first
+    _uint64_swissmap_migrate(map, map->old->capacity);
+
+  struct uint64_swissmap* old = malloc(sizeof(struct uint64_swissmap));
+  *old = *map;
+
+  *map = _uint64_swissmap_alloc(capacity);
+  map->size = old->size;
+  map->incremental = true;
+  map->old = old;
+}
+
+void* uint64_swissmap_put(struct uint64_swissmap* map,
+                          uint64_t key,
+                          void* value) {
+  if (value == NULL)
+    return NULL;
+
+  if (map->old != NULL)
+    _uint64_swissmap_migrate(map, UINT64_SWISSMAP_MIGRATE_SLOTS);
+
+  const uint64_t hash = uint64_hash(key);
+
+  int64_t found = _uint64_swissmap_find(map, key, hash);
+  if (found >= 0) {  // already exist, replace the value
+    void* previous_value = map->slots[found].value;
+    map->slots[found].value = value;
+    return previous_value;
+  }
+
+  // the key may not have been migrated yet, it moves over now
+  void* previous_value = NULL;
+  if (map->old != NULL) {
+    found = _uint64_swissmap_find(map->old, key, hash);
+    if (found >= 0) {
+      previous_value = map->old->slots[found].value;
+      _uint64_swissmap_set_ctrl(map->old, found, CTRL_DELETED);
+    }
+  }
+
+  // reusing a tombstone never needs a rehash
+  uint64_t index = _uint64_swissmap_find_free(map, hash);
+  if (map->ctrl[index] == CTRL_EMPTY && map->growth_left == 0) {
+    // mostly tombstones, clean them up in place, otherwise grow
+    uint32_t capacity =
+        map->size <= _uint64_swissmap_growth(map->capacity) / 2
+            ? map->capacity
+            : map->capacity << 1;
+    if (map->incremental)
+      _uint64_swissmap_start_rehash(map, capacity);
+    else
+      _uint64_swissmap_rehash(map, capacity);
+  }
+
+  _uint64_swissmap_insert(
+      map, hash, (struct uint64_swissmap_slot){.key = key, .value = value});
+  if (previous_value == NULL)
+    map->size++;
+
+  return previous_value;
+}
+
+void* uint64_swissmap_get(struct uint64_swissmap* map, uint64_t key) {
+  const uint64_t hash = uint64_hash(key);
+
+  int64_t index = _uint64_swissmap_find(map, key, hash);
+  if (index >= 0)
+    return map->slots[index].value;
+
+  if (map->old != NULL) {
+    index = _uint64_swissmap_find(map->old, key, hash);
+    if (index >= 0)
+      return map->old->slots[index].value;
+  }
+
+  return NULL;
+}
+
+void* uint64_swissmap_remove(struct uint64_swissmap* map, uint64_t key) {
+  if (map->old != NULL)
+    _uint64_swissmap_migrate(map, UINT64_SWISSMAP_MIGRATE_SLOTS);
+
+  const uint64_t hash = uint64_hash(key);
+
+  int64_t index = _uint64_swissmap_find(map, key, hash);
+  if (index < 0) {
+    if (map->old == NULL)
+      return NULL;
+
+    // not migrated yet, the old table is only read so leave a tombstone
+    index = _uint64_swissmap_find(map->old, key, hash);
+    if (index < 0)
+      return NULL;
+    _uint64_swissmap_set_ctrl(map->old, index, CTRL_DELETED);
+    map->size--;
+    return map->old->slots[index].value;
+  }
+
+  // A probe only moves past a group of full slots. If every group of
+  // GROUP_WIDTH slots covering `index` has an empty slot, none ever did.
+  const uint64_t mask = map->capacity - 1;
+  uint32_t empty_after = _group_match(map->ctrl + index, CTRL_EMPTY);
+  uint32_t empty_before = _group_match(
+      map->ctrl + ((index - GROUP_WIDTH) & mask), CTRL_EMPTY);
+  uint32_t full_after = empty_after ? __builtin_ctz(empty_after) : GROUP_WIDTH;
+  uint32_t full_before =
+      empty_before ? __builtin_clz(empty_before) - (32 - GROUP_WIDTH)
+                   : GROUP_WIDTH;
+
+  if (full_before + full_after < GROUP_WIDTH) {
+    _uint64_swissmap_set_ctrl(map, index, CTRL_EMPTY);
+    map->growth_left++;
+  } else {
+    _uint64_swissmap_set_ctrl(map, index, CTRL_DELETED);
+    map->tombstones++;
+  }
+
+  map->size--;
+  return map->slots[index].value;
+}
+
+void uint64_swissmap_prefetch(struct uint64_swissmap* map, uint64_t key) {
+  const uint64_t offset = H1(uint64_hash(key)) & (map->capacity - 1);
+  __builtin_prefetch(map->ctrl + offset);
+  __builtin_prefetch(&map->slots[offset]);
+}
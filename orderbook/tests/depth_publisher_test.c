@@ -0,0 +1,132 @@
+#include <criterion/criterion.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "orderbook.h"
+
+#define DEPTH 3
+
+struct orderbook published;
+struct depth_publisher publisher;
+struct depth_reader reader;
+char segment_name[64];
+
+void depth_publisher_setup(void) {
+  snprintf(segment_name, sizeof(segment_name), "/orderbook-test-%d",
+           getpid());
+  published = orderbook_new();
+  publisher = depth_publisher_new(segment_name, 7, DEPTH);
+  orderbook_set_depth_publisher(&published, &publisher);
+  cr_assert(depth_reader_open(segment_name, &reader));
+}
+
+void depth_publisher_teardown(void) {
+  depth_reader_close(&reader);
+  depth_publisher_free(&publisher);
+  orderbook_free(&published);
+}
+
+void depth_publisher_add(uint64_t order_id, enum side side, uint64_t price) {
+  orderbook_limit(&published, (struct order){.order_id = order_id,
+                                             .side = side,
+                                             .price = price,
+                                             .size = order_id});
+}
+
+Test(depth_publisher,
+     read,
+     .init = depth_publisher_setup,
+     .fini = depth_publisher_teardown) {
+  struct depth_level levels[2 * DEPTH];
+  uint32_t count[2];
+  cr_assert_eq(reader.snapshot->book_id, 7);
+  cr_assert_eq(reader.snapshot->depth, DEPTH);
+  uint64_t sequence;
+  cr_assert(depth_reader_read(&reader, levels, count, &sequence));
+  cr_assert_eq(sequence, 2);
+  cr_assert_eq(count[SIDE_BID], 0);
+  cr_assert_eq(count[SIDE_ASK], 0);
+
+  // bids at 99 to 95 and asks at 101 and 102, only 3 bids show
+  for (uint64_t id = 1; id <= 5; id++)
+    depth_publisher_add(id, SIDE_BID, 100 - id);
+  depth_publisher_add(6, SIDE_ASK, 101);
+  depth_publisher_add(7, SIDE_ASK, 102);
+  depth_publisher_add(8, SIDE_BID, 99);
+
+  cr_assert(depth_reader_read(&reader, levels, count, &sequence));
+  cr_assert_eq(count[SIDE_BID], 3);
+  cr_assert_eq(levels[0].price, 99);
+  cr_assert_eq(levels[0].volume, 1 + 8);
+  cr_assert_eq(levels[0].order_count, 2);
+  cr_assert_eq(levels[2].price, 97);
+  cr_assert_eq(count[SIDE_ASK], 2);
+  cr_assert_eq(levels[DEPTH].price, 101);
+  cr_assert_eq(levels[DEPTH + 1].volume, 7);
+
+  // a level below the published ones changes nothing
+  depth_publisher_add(9, SIDE_BID, 90);
+  cr_assert_eq(orderbook_cancel(&published, 5), OBERR_OKAY);
+  uint64_t unchanged;
+  cr_assert(depth_reader_read(&reader, levels, count, &unchanged));
+  cr_assert_eq(unchanged, sequence);
+
+  // the best bid going brings the next one in
+  orderbook_execute(&published, 10, SIDE_ASK, 9, 9, true);
+  uint64_t changed;
+  cr_assert(depth_reader_read(&reader, levels, count, &changed));
+  cr_assert(changed > sequence);
+  cr_assert_eq(count[SIDE_BID], 3);
+  cr_assert_eq(levels[0].price, 98);
+  cr_assert_eq(levels[2].price, 96);
+  cr_assert_eq(count[SIDE_ASK], 2);
+
+  orderbook_reset(&published);
+  cr_assert(depth_reader_read(&reader, levels, count, &sequence));
+  cr_assert_eq(count[SIDE_BID], 0);
+  cr_assert_eq(count[SIDE_ASK], 0);
+}
+
+Test(depth_publisher,
+     close,
+     .init = depth_publisher_setup,
+     .fini = depth_publisher_teardown) {
+  depth_publisher_add(1, SIDE_ASK, 101);
+  orderbook_set_depth_publisher(&published, NULL);
+  depth_publisher_free(&publisher);
+
+  // a reader that has it mapped still sees the last levels
+  struct depth_level levels[2 * DEPTH];
+  uint32_t count[2];
+  uint64_t sequence;
+  cr_assert(reader.snapshot->closed);
+  cr_assert(depth_reader_read(&reader, levels, count, &sequence));
+  cr_assert_eq(count[SIDE_ASK], 1);
+  cr_assert_eq(levels[DEPTH].price, 101);
+
+  struct depth_reader missing;
+  cr_assert_not(depth_reader_open(segment_name, &missing));
+  cr_assert_eq(missing.snapshot, NULL);
+}
+
+Test(depth_publisher,
+     unfinished_update,
+     .init = depth_publisher_setup,
+     .fini = depth_publisher_teardown) {
+  struct depth_level levels[2 * DEPTH];
+  uint32_t count[2];
+  uint64_t sequence;
+
+  // a publisher that died halfway through an update never finishes it
+  __atomic_store_n(&publisher.snapshot->sequence, 3, __ATOMIC_RELEASE);
+  cr_assert_not(depth_reader_read(&reader, levels, count, &sequence));
+
+  // and one that closed the segment halfway is not waited for at all
+  __atomic_store_n(&publisher.snapshot->closed, true, __ATOMIC_RELEASE);
+  cr_assert_not(depth_reader_read(&reader, levels, count, &sequence));
+
+  __atomic_store_n(&publisher.snapshot->sequence, 4, __ATOMIC_RELEASE);
+  cr_assert(depth_reader_read(&reader, levels, count, &sequence));
+  cr_assert_eq(sequence, 4);
+}
@@ -0,0 +1,124 @@
+#include <criterion/criterion.h>
+
+#include <stdlib.h>
+
+#include "limit_tree.h"
+
+struct limit_tree bptree;
+
+void limit_bptree_setup(void) {
+  bptree = limit_tree_new_bptree(SIDE_ASK);
+}
+
+void limit_bptree_teardown(void) {
+  limit_tree_free(&bptree);
+}
+
+Test(limit_bptree,
+     add_split_root,
+     .init = limit_bptree_setup,
+     .fini = limit_bptree_teardown) {
+  cr_assert_eq(limit_tree_min(&bptree), NULL);
+
+  // one more than a leaf holds splits the root leaf
+  for (int i = 0; i <= LIMIT_BPTREE_LEAF_KEYS; i++) {
+    limit_tree_insert(&bptree, 10 * (i + 1));
+    cr_assert_eq(bptree.size, i + 1);
+  }
+  cr_assert_eq(bptree.bptree->height, 2);
+  cr_assert_neq(bptree.bptree->head, bptree.bptree->tail);
+  cr_assert_eq(bptree.bptree->head->next, bptree.bptree->tail);
+  cr_assert_eq(bptree.price_limit_map.size, LIMIT_BPTREE_LEAF_KEYS + 1);
+
+  cr_assert_eq(limit_tree_min(&bptree)->price, 10);
+  cr_assert_eq(limit_tree_max(&bptree)->price,
+               10 * (LIMIT_BPTREE_LEAF_KEYS + 1));
+  cr_assert_eq(limit_tree_get(&bptree, 30)->price, 30);
+
+  // adding an existing price is a no-op
+  struct limit* existing = limit_tree_get(&bptree, 30);
+  limit_tree_add(&bptree, existing);
+  cr_assert_eq(bptree.size, LIMIT_BPTREE_LEAF_KEYS + 1);
+}
+
+Test(limit_bptree,
+     remove_collapse,
+     .init = limit_bptree_setup,
+     .fini = limit_bptree_teardown) {
+  const int n = 1000;
+  for (int i = 1; i <= n; i++)
+    limit_tree_insert(&bptree, i);
+  cr_assert_gt(bptree.bptree->height, 2);
+
+  // remove from the best end, as a sweep would
+  for (int i = 1; i <= n; i++) {
+    cr_assert_eq(limit_tree_min(&bptree)->price, i);
+    limit_tree_remove(&bptree, limit_tree_min(&bptree));
+  }
+  cr_assert_eq(bptree.size, 0);
+  cr_assert_eq(bptree.bptree->root, NULL);
+  cr_assert_eq(bptree.bptree->head, NULL);
+  cr_assert_eq(bptree.bptree->tail, NULL);
+  cr_assert_eq(limit_tree_max(&bptree), NULL);
+
+  // and it can grow again
+  limit_tree_insert(&bptree, 5);
+  cr_assert_eq(limit_tree_max(&bptree)->price, 5);
+}
+
+Test(limit_bptree,
+     ordered_random,
+     .init = limit_bptree_setup,
+     .fini = limit_bptree_teardown) {
+  const int range = 4096;
+  bool* present = calloc(range, sizeof(bool));
+  srand(7);
+
+  for (int round = 0; round < 20'000; round++) {
+    uint64_t price = 1 + rand() % range;
+    struct limit* limit = limit_tree_get(&bptree, price);
+    if (limit != NULL) {
+      limit_tree_remove(&bptree, limit);
+      present[price - 1] = false;
+    } else {
+      limit_tree_insert(&bptree, price);
+      present[price - 1] = true;
+    }
+  }
+
+  // walk up, then down, comparing against the expected prices
+  uint64_t count = 0;
+  struct limit* limit = limit_tree_min(&bptree);
+  for (uint64_t price = 1; price <= range; price++) {
+    if (!present[price - 1])
+      continue;
+    cr_assert_eq(limit->price, price);
+    limit = limit_tree_next(&bptree, limit);
+    count++;
+  }
+  cr_assert_eq(limit, NULL);
+  cr_assert_eq(count, bptree.size);
+
+  limit = limit_tree_max(&bptree);
+  for (uint64_t price = range; price >= 1; price--) {
+    if (!present[price - 1])
+      continue;
+    cr_assert_eq(limit->price, price);
+    limit = limit_tree_prev(&bptree, limit);
+  }
+  cr_assert_eq(limit, NULL);
+
+  // lookups between the existing prices
+  for (uint64_t price = 1; price < range; price++) {
+    struct limit* higher = limit_bptree_higher(bptree.bptree, price);
+    uint64_t expected = price + 1;
+    while (expected <= range && !present[expected - 1])
+      expected++;
+    if (expected > range)
+      cr_assert_eq(higher, NULL);
+    else
+      cr_assert_eq(higher->price, expected);
+  }
+
+  free(present);
+}
@@ -0,0 +1,186 @@
+#include <criterion/criterion.h>
+
+#include <stdlib.h>
+
+#include "limit_tree.h"
+
+struct limit_tree ladder_tree;
+
+void limit_ladder_setup(void) {
+  ladder_tree = limit_tree_new_ladder(SIDE_BID, 1, 64);
+}
+
+void limit_ladder_teardown(void) {
+  limit_tree_free(&ladder_tree);
+}
+
+Test(limit_ladder,
+     insert_in_window,
+     .init = limit_ladder_setup,
+     .fini = limit_ladder_teardown) {
+  struct limit* limit = limit_tree_insert(&ladder_tree, 100);
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, limit));
+  cr_assert_eq(limit->price, 100);
+  cr_assert_eq(ladder_tree.size, 1);
+  cr_assert_eq(ladder_tree.ladder->size, 1);
+  cr_assert_eq(ladder_tree.ladder->base, 100 - 32);  // centered on the price
+  cr_assert_eq(ladder_tree.root, NULL);
+  cr_assert_eq(ladder_tree.price_limit_map.size, 0);
+
+  cr_assert_eq(limit_tree_get(&ladder_tree, 100), limit);
+  cr_assert_eq(limit_tree_get(&ladder_tree, 101), NULL);
+
+  limit_tree_remove(&ladder_tree, limit);
+  cr_assert_eq(ladder_tree.size, 0);
+  cr_assert_eq(ladder_tree.ladder->size, 0);
+  cr_assert_eq(limit_tree_get(&ladder_tree, 100), NULL);
+  cr_assert_eq(limit_tree_max(&ladder_tree), NULL);
+}
+
+Test(limit_ladder,
+     fallback_outside_window,
+     .init = limit_ladder_setup,
+     .fini = limit_ladder_teardown) {
+  struct limit* inside = limit_tree_insert(&ladder_tree, 100);
+  struct limit* above = limit_tree_insert(&ladder_tree, 1000);
+  struct limit* below = limit_tree_insert(&ladder_tree, 10);
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, inside));
+  cr_assert_not(limit_ladder_owns(ladder_tree.ladder, above));
+  cr_assert_not(limit_ladder_owns(ladder_tree.ladder, below));
+  cr_assert_eq(ladder_tree.size, 3);
+  cr_assert_eq(ladder_tree.price_limit_map.size, 2);
+
+  cr_assert_eq(limit_tree_get(&ladder_tree, 1000), above);
+  cr_assert_eq(limit_tree_min(&ladder_tree), below);
+  cr_assert_eq(limit_tree_max(&ladder_tree), above);
+  cr_assert_eq(limit_tree_next(&ladder_tree, below), inside);
+  cr_assert_eq(limit_tree_next(&ladder_tree, inside), above);
+  cr_assert_eq(limit_tree_next(&ladder_tree, above), NULL);
+  cr_assert_eq(limit_tree_prev(&ladder_tree, above), inside);
+  cr_assert_eq(limit_tree_prev(&ladder_tree, inside), below);
+  cr_assert_eq(limit_tree_prev(&ladder_tree, below), NULL);
+
+  limit_tree_remove(&ladder_tree, above);
+  cr_assert_eq(limit_tree_max(&ladder_tree), inside);
+  cr_assert_eq(ladder_tree.price_limit_map.size, 1);
+}
+
+Test(limit_ladder, fallback_off_tick, .fini = limit_ladder_teardown) {
+  ladder_tree = limit_tree_new_ladder(SIDE_ASK, 5, 64);
+
+  struct limit* on_tick = limit_tree_insert(&ladder_tree, 100);
+  struct limit* off_tick = limit_tree_insert(&ladder_tree, 102);
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, on_tick));
+  cr_assert_not(limit_ladder_owns(ladder_tree.ladder, off_tick));
+  cr_assert_eq(limit_tree_next(&ladder_tree, on_tick), off_tick);
+  cr_assert_eq(limit_tree_prev(&ladder_tree, off_tick), on_tick);
+}
+
+Test(limit_ladder,
+     anchor_moves_tree_limits,
+     .init = limit_ladder_setup,
+     .fini = limit_ladder_teardown) {
+  struct limit* inside = limit_tree_insert(&ladder_tree, 100);
+  struct limit* outside = limit_tree_insert(&ladder_tree, 1000);
+
+  struct order* order = malloc(sizeof(struct order));
+  *order = (struct order){.order_id = 1, .price = 1000, .size = 5};
+  order->limit = outside;
+  outside->order_head = outside->order_tail = order;
+  outside->order_count = 1;
+  outside->volume = 5;
+  ladder_tree.best = outside;
+
+  // the ladder is empty, so the window follows the next price
+  limit_tree_remove(&ladder_tree, inside);
+  struct limit* limit = limit_tree_insert(&ladder_tree, 990);
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, limit));
+  cr_assert_eq(ladder_tree.size, 2);
+  cr_assert_eq(ladder_tree.root, NULL);
+
+  // the heap limit at 1000 now lives in the ladder
+  struct limit* moved = limit_tree_get(&ladder_tree, 1000);
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, moved));
+  cr_assert_eq(moved->volume, 5);
+  cr_assert_eq(moved->order_head, order);
+  cr_assert_eq(order->limit, moved);
+  cr_assert_eq(ladder_tree.best, moved);
+  cr_assert_eq(limit_tree_max(&ladder_tree), moved);
+}
+
+Test(limit_ladder,
+     window_slides_with_best,
+     .init = limit_ladder_setup,
+     .fini = limit_ladder_teardown) {
+  struct limit* best = limit_tree_insert(&ladder_tree, 100);
+  limit_tree_update_best(&ladder_tree, best);
+  struct limit* stale = limit_tree_insert(&ladder_tree, 70);
+
+  struct order* order = malloc(sizeof(struct order));
+  *order = (struct order){.order_id = 1, .price = 70, .size = 5};
+  order->limit = stale;
+  stale->order_head = stale->order_tail = order;
+  stale->order_count = 1;
+  stale->volume = 5;
+
+  // the best bid trends far out of the first window, one tick at a time
+  for (uint64_t price = 101; price <= 300; price++) {
+    struct limit* limit = limit_tree_insert(&ladder_tree, price);
+    cr_assert(limit_ladder_owns(ladder_tree.ladder, limit));
+    limit_tree_update_best(&ladder_tree, limit);
+    limit_tree_remove(&ladder_tree, limit_tree_get(&ladder_tree, price - 1));
+  }
+  cr_assert_eq(ladder_tree.size, 2);
+  cr_assert_eq(ladder_tree.ladder->size, 1);
+  cr_assert_eq(ladder_tree.best->price, 300);
+
+  // the stale level left the window for the red-black tree, orders and all
+  stale = limit_tree_get(&ladder_tree, 70);
+  cr_assert_not(limit_ladder_owns(ladder_tree.ladder, stale));
+  cr_assert_eq(stale->volume, 5);
+  cr_assert_eq(stale->order_head, order);
+  cr_assert_eq(order->limit, stale);
+  cr_assert_eq(limit_tree_min(&ladder_tree), stale);
+  cr_assert_eq(limit_tree_next(&ladder_tree, stale), ladder_tree.best);
+
+  // a price far below the best does not drag the window back
+  struct limit* far = limit_tree_insert(&ladder_tree, 80);
+  cr_assert_not(limit_ladder_owns(ladder_tree.ladder, far));
+  cr_assert(limit_ladder_owns(ladder_tree.ladder, ladder_tree.best));
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+Test(limit_ladder, ordered_across_levels, .fini = limit_ladder_teardown) {
+  // 8192 slots need three levels of bitmap
+  ladder_tree = limit_tree_new_ladder(SIDE_BID, 1, 8192);
+  cr_assert_eq(ladder_tree.ladder->levels, 3);
+
+  const int n = 300;
+  uint64_t prices[300];
+  srand(42);
+  for (int i = 0; i < n; i++) {
+    uint64_t price;
+    do {  // unique prices, mostly in the window around the first one
+      price = i == 0 ? 50'000 : 45'000 + rand() % 12'000;
+    } while (limit_tree_get(&ladder_tree, price) != NULL);
+    prices[i] = price;
+    limit_tree_insert(&ladder_tree, price);
+  }
+  qsort(prices, n, sizeof(uint64_t), cmp_u64);
+  cr_assert_eq(ladder_tree.size, n);
+
+  int i = 0;
+  for (struct limit* limit = limit_tree_min(&ladder_tree); limit != NULL;
+       limit = limit_tree_next(&ladder_tree, limit))
+    cr_assert_eq(limit->price, prices[i++]);
+  cr_assert_eq(i, n);
+
+  for (struct limit* limit = limit_tree_max(&ladder_tree); limit != NULL;
+       limit = limit_tree_prev(&ladder_tree, limit))
+    cr_assert_eq(limit->price, prices[--i]);
+  cr_assert_eq(i, 0);
+}
@@ -40,7 +40,9 @@ Test(limit_tree,
   *limit3 = (struct limit){.price = 3};
   limit_tree_add(&tree, limit3);
   cr_assert_eq(tree.size, 3);
-  cr_assert_eq(tree.root->right->right->price, 3);
+  cr_assert_eq(tree.root->price, 2);  // rebalanced
+  cr_assert_eq(tree.root->left->price, 1);
+  cr_assert_eq(tree.root->right->price, 3);
 }
 
 Test(limit_tree,
@@ -65,7 +67,9 @@ Test(limit_tree,
   *limit3 = (struct limit){.price = 1};
   limit_tree_add(&tree, limit3);
   cr_assert_eq(tree.size, 3);
-  cr_assert_eq(tree.root->left->left->price, 1);
+  cr_assert_eq(tree.root->price, 2);  // rebalanced
+  cr_assert_eq(tree.root->left->price, 1);
+  cr_assert_eq(tree.root->right->price, 3);
 }
 
 Test(limit_tree,
@@ -409,3 +413,149 @@ Test(limit_tree,
 
   cr_assert_eq(limit_tree_max(&tree)->price, 5);
 }
+
+/**
+ * Check the red-black properties of the subtree and return its black height.
+ */
+static int assert_red_black(struct limit* node, struct limit* parent) {
+  if (node == NULL)
+    return 1;
+
+  cr_assert_eq(node->parent, parent);
+  if (node->color == LIMIT_COLOR_RED) {
+    cr_assert(node->left == NULL || node->left->color == LIMIT_COLOR_BLACK);
+    cr_assert(node->right == NULL || node->right->color == LIMIT_COLOR_BLACK);
+  }
+
+  int left = assert_red_black(node->left, node);
+  int right = assert_red_black(node->right, node);
+  cr_assert_eq(left, right);
+
+  return left + (node->color == LIMIT_COLOR_BLACK);
+}
+
+static int height(struct limit* node) {
+  if (node == NULL)
+    return 0;
+  int left = height(node->left);
+  int right = height(node->right);
+  return 1 + (left > right ? left : right);
+}
+
+Test(limit_tree,
+     balanced_monotonic,
+     .init = limit_tree_setup_bid,
+     .fini = limit_tree_teardown) {
+  const int n = 1 << 12;
+  struct limit** limits = malloc(sizeof(struct limit*) * n);
+
+  // a trending market adds prices in increasing order
+  for (int i = 0; i < n; i++) {
+    limits[i] = malloc(sizeof(struct limit));
+    *limits[i] = (struct limit){.price = i + 1};
+    limit_tree_add(&tree, limits[i]);
+  }
+  cr_assert_eq(tree.size, n);
+  cr_assert_eq(tree.root->color, LIMIT_COLOR_BLACK);
+  assert_red_black(tree.root, NULL);
+  cr_assert_leq(height(tree.root), 2 * 12);  // 2 * log2(n)
+  cr_assert_eq(limit_tree_max(&tree)->price, n);
+
+  // remove every other limit from the top
+  for (int i = n - 1; i >= 0; i -= 2)
+    limit_tree_remove(&tree, limits[i]);
+  cr_assert_eq(tree.size, n / 2);
+  assert_red_black(tree.root, NULL);
+  cr_assert_leq(height(tree.root), 2 * 11);
+  cr_assert_eq(limit_tree_max(&tree)->price, n - 1);
+  cr_assert_eq(limit_tree_min(&tree)->price, 1);
+
+  free(limits);
+}
+
+Test(limit_tree,
+     remove_best_promotes_neighbour,
+     .init = limit_tree_setup_ask,
+     .fini = limit_tree_teardown) {
+  const uint64_t prices[] = {5, 3, 8, 1, 4, 7, 9, 2, 6};
+  for (int i = 0; i < 9; i++) {
+    struct limit* limit = malloc(sizeof(struct limit));
+    *limit = (struct limit){.price = prices[i]};
+    limit_tree_add(&tree, limit);
+    limit_tree_update_best(&tree, limit);
+  }
+
+  // the threaded links walk the prices in order
+  uint64_t expected = 1;
+  for (struct limit* limit = tree.lowest; limit != NULL; limit = limit->next)
+    cr_assert_eq(limit->price, expected++);
+  cr_assert_eq(tree.highest->price, 9);
+
+  // sweeping the best level hands over to the next higher price
+  for (uint64_t price = 1; price <= 9; price++) {
+    cr_assert_eq(tree.best->price, price);
+    limit_tree_remove(&tree, tree.best);
+  }
+  cr_assert_eq(tree.best, NULL);
+  cr_assert_eq(tree.lowest, NULL);
+  cr_assert_eq(tree.highest, NULL);
+}
+
+/**
+ * Check the subtree totals of every limit and return the subtree volume.
+ */
+uint64_t assert_aggregates(struct limit* node) {
+  if (node == NULL)
+    return 0;
+
+  uint64_t volume = node->volume + assert_aggregates(node->left) +
+                    assert_aggregates(node->right);
+  cr_assert_eq(node->subtree_volume, volume);
+  return volume;
+}
+
+Test(limit_tree,
+     aggregates,
+     .init = limit_tree_setup_ask,
+     .fini = limit_tree_teardown) {
+  tree.aggregates = true;
+  const int n = 1 << 10;
+  struct limit** limits = malloc(sizeof(struct limit*) * n);
+
+  // a volume of 1 at every price, rotations keep the totals right
+  for (int i = 0; i < n; i++) {
+    limits[i] = malloc(sizeof(struct limit));
+    *limits[i] = (struct limit){.price = i + 1, .volume = 1, .order_count = 1};
+    limit_tree_add(&tree, limits[i]);
+    limit_tree_update_best(&tree, limits[i]);
+  }
+  assert_aggregates(tree.root);
+  cr_assert_eq(tree.root->subtree_volume, n);
+  cr_assert_eq(tree.root->subtree_order_count, n);
+
+  // and so does removing every other limit and growing another one
+  for (int i = 1; i < n; i += 2)
+    limit_tree_remove(&tree, limits[i]);
+  limits[0]->volume += 9;
+  limit_tree_aggregate(&tree, limits[0], 9, 0);
+  assert_aggregates(tree.root);
+  cr_assert_eq(tree.root->subtree_volume, n / 2 + 9);
+
+  // asks at 1 (10), 3, 5, 7, ...
+  cr_assert_eq(limit_tree_volume_to(&tree, 0), 0);
+  cr_assert_eq(limit_tree_volume_to(&tree, 4), 11);
+  cr_assert_eq(limit_tree_volume_to(&tree, 5), 12);
+  cr_assert_eq(limit_tree_volume_to(&tree, n), n / 2 + 9);
+
+  struct limit_tree_fill fill = limit_tree_cost_to_fill(&tree, 12);
+  cr_assert_eq(fill.size, 12);
+  cr_assert_eq(fill.worst_price, 5);
+  cr_assert_eq(fill.cost, 10 + 3 + 5);
+
+  // more than there is fills what there is
+  fill = limit_tree_cost_to_fill(&tree, n);
+  cr_assert_eq(fill.size, n / 2 + 9);
+  cr_assert_eq(fill.worst_price, n - 1);
+
+  free(limits);
+}
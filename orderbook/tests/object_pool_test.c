@@ -0,0 +1,107 @@
+#include <criterion/criterion.h>
+
+#include "limit.h"
+#include "object_pool.h"
+
+struct object_pool pool;
+
+void object_pool_setup(void) {
+  pool = object_pool_new(sizeof(struct order), 64);
+}
+
+void object_pool_teardown(void) {
+  object_pool_free(&pool);
+}
+
+Test(object_pool,
+     alloc_release_reuse,
+     .init = object_pool_setup,
+     .fini = object_pool_teardown) {
+  cr_assert_eq(pool.capacity, 64);
+  cr_assert_eq(pool.slab_allocations, 1);
+  cr_assert_eq(pool.object_size % _Alignof(max_align_t), 0);
+
+  // smaller objects are not padded to `max_align_t`
+  struct object_pool compact = object_pool_new(ORDER_HOT_SIZE, 1);
+  cr_assert_eq(compact.object_size, ORDER_HOT_SIZE);
+  object_pool_free(&compact);
+
+  struct order* first = object_pool_alloc(&pool);
+  struct order* second = object_pool_alloc(&pool);
+  cr_assert_neq(first, second);
+  cr_assert_eq(pool.in_use, 2);
+
+  // the last released object is handed out first
+  object_pool_release(&pool, first);
+  cr_assert_eq(pool.in_use, 1);
+  cr_assert_eq(object_pool_alloc(&pool), first);
+  cr_assert_eq(pool.allocations, 3);
+  cr_assert_eq(pool.slab_allocations, 1);
+}
+
+Test(object_pool,
+     grow_when_full,
+     .init = object_pool_setup,
+     .fini = object_pool_teardown) {
+  struct order* orders[200];
+  for (int i = 0; i < 200; i++) {
+    orders[i] = object_pool_alloc(&pool);
+    *orders[i] = (struct order){.order_id = i};  // objects do not overlap
+  }
+  for (int i = 0; i < 200; i++)
+    cr_assert_eq(orders[i]->order_id, i);
+
+  // 64, then 64 more, then 128 more
+  cr_assert_eq(pool.slab_allocations, 3);
+  cr_assert_eq(pool.capacity, 256);
+
+  // releasing everything and allocating again does not grow the pool
+  for (int i = 0; i < 200; i++)
+    object_pool_release(&pool, orders[i]);
+  cr_assert_eq(pool.in_use, 0);
+  for (int i = 0; i < 200; i++)
+    orders[i] = object_pool_alloc(&pool);
+  cr_assert_eq(pool.slab_allocations, 3);
+}
+
+Test(object_pool,
+     reset,
+     .init = object_pool_setup,
+     .fini = object_pool_teardown) {
+  struct order* orders[200];
+  for (int i = 0; i < 200; i++)
+    orders[i] = object_pool_alloc(&pool);
+  object_pool_release(&pool, orders[0]);
+
+  // every slab is carved again before the pool grows
+  object_pool_reset(&pool);
+  cr_assert_eq(pool.in_use, 0);
+  for (int i = 0; i < 256; i++) {
+    orders[i % 200] = object_pool_alloc(&pool);
+    *orders[i % 200] = (struct order){.order_id = i};
+  }
+  cr_assert_eq(pool.slab_allocations, 3);
+  cr_assert_eq(pool.in_use, 256);
+
+  object_pool_alloc(&pool);
+  cr_assert_eq(pool.slab_allocations, 4);
+}
+
+Test(object_pool, adopt) {
+  pool = object_pool_new(sizeof(struct order), 0);
+  size_t bytes = object_pool_slab_size(sizeof(struct order), 4);
+  _Alignas(max_align_t) unsigned char memory[bytes];
+  object_pool_adopt(&pool, memory, bytes);
+  cr_assert_eq(pool.capacity, 4);
+
+  // carved out of the memory, and only then out of slabs of its own
+  for (int i = 0; i < 4; i++) {
+    unsigned char* order = object_pool_alloc(&pool);
+    cr_assert(order >= memory && order < memory + bytes);
+  }
+  cr_assert_eq(pool.slab_allocations, 0);
+  object_pool_alloc(&pool);
+  cr_assert_eq(pool.slab_allocations, 1);
+
+  object_pool_free(&pool);  // does not free the memory it did not allocate
+}
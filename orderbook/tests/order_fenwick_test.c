@@ -0,0 +1,46 @@
+#include <criterion/criterion.h>
+
+#include "order_fenwick.h"
+
+struct order_fenwick fenwick;
+
+void order_fenwick_setup(void) {
+  fenwick = (struct order_fenwick){0};
+  order_fenwick_reset(&fenwick, 4);
+}
+
+void order_fenwick_teardown(void) {
+  order_fenwick_free(&fenwick);
+}
+
+Test(order_fenwick,
+     push_add_prefix,
+     .init = order_fenwick_setup,
+     .fini = order_fenwick_teardown) {
+  cr_assert_eq(fenwick.capacity, 8);  // rounded up to the minimum
+
+  for (uint64_t volume = 1; volume <= 8; volume++)
+    cr_assert_eq(order_fenwick_push(&fenwick, volume), volume - 1);
+  cr_assert_eq(fenwick.len, fenwick.capacity);
+
+  struct order_fenwick_sum sum = order_fenwick_prefix(&fenwick, 0);
+  cr_assert_eq(sum.count, 0);
+  cr_assert_eq(sum.volume, 0);
+  sum = order_fenwick_prefix(&fenwick, 5);
+  cr_assert_eq(sum.count, 5);
+  cr_assert_eq(sum.volume, 1 + 2 + 3 + 4 + 5);
+
+  // a fill at the front and a cancel in the middle
+  order_fenwick_add(&fenwick, 0, -1, -1);
+  order_fenwick_add(&fenwick, 3, -4, -1);
+  order_fenwick_add(&fenwick, 4, -2, 0);
+  sum = order_fenwick_prefix(&fenwick, 7);
+  cr_assert_eq(sum.count, 5);
+  cr_assert_eq(sum.volume, 2 + 3 + 3 + 6 + 7);
+
+  // starting over hands out the slots from 0 again
+  order_fenwick_reset(&fenwick, 16);
+  cr_assert_eq(fenwick.capacity, 16);
+  cr_assert_eq(order_fenwick_push(&fenwick, 9), 0);
+  cr_assert_eq(order_fenwick_prefix(&fenwick, 16).volume, 9);
+}
@@ -0,0 +1,70 @@
+#include <criterion/criterion.h>
+
+#include "order_index.h"
+
+struct order_index index_;
+
+void order_index_setup(void) {
+  index_ = order_index_new(4);
+}
+
+void order_index_teardown(void) {
+  order_index_free(&index_);
+}
+
+Test(order_index,
+     put_get_remove,
+     .init = order_index_setup,
+     .fini = order_index_teardown) {
+  struct order first = {.order_id = 1}, second = {.order_id = 2};
+  cr_assert(order_index_put(&index_, 1, &first));
+  cr_assert(order_index_put(&index_, 2, &second));
+  cr_assert_eq(index_.size, 2);
+
+  cr_assert_eq(order_index_get(&index_, 1), &first);
+  cr_assert_eq(order_index_get(&index_, 2), &second);
+  cr_assert_eq(order_index_get(&index_, 3), NULL);
+
+  // replacing keeps the count
+  cr_assert(order_index_put(&index_, 2, &first));
+  cr_assert_eq(index_.size, 2);
+
+  cr_assert_eq(order_index_remove(&index_, 2), &first);
+  cr_assert_eq(order_index_remove(&index_, 2), NULL);
+  cr_assert_eq(index_.size, 1);
+
+  // far outside of the window
+  cr_assert_eq(order_index_get(&index_, UINT64_MAX), NULL);
+  cr_assert_eq(order_index_remove(&index_, UINT64_MAX), NULL);
+}
+
+Test(order_index,
+     slide_window,
+     .init = order_index_setup,
+     .fini = order_index_teardown) {
+  const uint64_t window = 4 * ORDER_INDEX_PAGE_SIZE;
+  struct order order = {};
+
+  // a resting order on the first page pins the window
+  cr_assert(order_index_put(&index_, 1, &order));
+  cr_assert(order_index_put(&index_, window - 1, &order));
+  cr_assert_not(order_index_put(&index_, window, &order));
+
+  // once it is gone the window slides and the page is reused
+  struct order_index_page* front = index_.pages[0];
+  order_index_remove(&index_, 1);
+  cr_assert(order_index_put(&index_, window, &order));
+  cr_assert_eq(index_.base, 1);
+  cr_assert_eq(index_.pages[0], front);
+  cr_assert_eq(order_index_get(&index_, window), &order);
+  cr_assert_eq(order_index_get(&index_, 1), NULL);
+
+  // ids behind the window are never placed
+  cr_assert_not(order_index_put(&index_, 1, &order));
+
+  // an empty index jumps straight to the new id
+  order_index_remove(&index_, window - 1);
+  order_index_remove(&index_, window);
+  cr_assert(order_index_put(&index_, 1'000'000 * window, &order));
+  cr_assert_eq(order_index_get(&index_, 1'000'000 * window), &order);
+}
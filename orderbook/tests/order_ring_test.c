@@ -0,0 +1,75 @@
+#include <criterion/criterion.h>
+
+#include "limit.h"
+
+struct order_ring ring;
+struct order orders[32];
+
+void order_ring_setup(void) {
+  ring = order_ring_new();
+  for (int i = 0; i < 32; i++)
+    orders[i] = (struct order){.order_id = i};
+}
+
+void order_ring_teardown(void) {
+  order_ring_free(&ring);
+}
+
+Test(order_ring,
+     push_remove_next,
+     .init = order_ring_setup,
+     .fini = order_ring_teardown) {
+  cr_assert_eq(order_ring_first(&ring), NULL);
+  for (int i = 0; i < 4; i++)
+    order_ring_push(&ring, &orders[i]);
+  cr_assert_eq(order_ring_first(&ring), &orders[0]);
+  cr_assert_eq(order_ring_last(&ring), &orders[3]);
+
+  // a tombstone in the middle is skipped
+  order_ring_remove(&ring, &orders[1]);
+  cr_assert_eq(ring.size, 3);
+  cr_assert_eq(order_ring_next(&ring, &orders[0]), &orders[2]);
+
+  // the ends move past tombstones
+  order_ring_remove(&ring, &orders[0]);
+  cr_assert_eq(order_ring_first(&ring), &orders[2]);
+  order_ring_remove(&ring, &orders[3]);
+  cr_assert_eq(order_ring_last(&ring), &orders[2]);
+  cr_assert_eq(order_ring_next(&ring, &orders[2]), NULL);
+
+  order_ring_remove(&ring, &orders[2]);
+  cr_assert_eq(order_ring_first(&ring), NULL);
+  cr_assert_eq(ring.head, ring.tail);
+}
+
+Test(order_ring,
+     compact_then_grow,
+     .init = order_ring_setup,
+     .fini = order_ring_teardown) {
+  for (int i = 0; i < 8; i++)
+    order_ring_push(&ring, &orders[i]);
+  int removed[] = {1, 2, 3, 5, 6};
+  for (int i = 0; i < 5; i++)
+    order_ring_remove(&ring, &orders[removed[i]]);
+
+  // full but mostly tombstones, compacted in place
+  order_ring_push(&ring, &orders[8]);
+  cr_assert_eq(ring.capacity, 8);
+  cr_assert_eq(orders[4].ring_slot, 1);
+  cr_assert_eq(orders[8].ring_slot, 3);
+
+  // full again with no tombstones, doubled
+  for (int i = 9; i < 14; i++)
+    order_ring_push(&ring, &orders[i]);
+  cr_assert_eq(ring.capacity, 16);
+  cr_assert_eq(ring.size, 9);
+
+  // the order of the queue is kept throughout
+  int expected[] = {0, 4, 7, 8, 9, 10, 11, 12, 13};
+  struct order* order = order_ring_first(&ring);
+  for (int i = 0; i < 9; i++) {
+    cr_assert_eq(order, &orders[expected[i]]);
+    order = order_ring_next(&ring, order);
+  }
+  cr_assert_eq(order, NULL);
+}
@@ -0,0 +1,121 @@
+#include <criterion/criterion.h>
+
+#include <pthread.h>
+
+#include "orderbook.h"
+
+struct orderbook parent;
+
+void orderbook_fork_setup(void) {
+  parent = orderbook_new();
+  // bids of 1, 2, 3 at 99, 98, 97 and asks of 1, 2, 3 at 101, 102, 103
+  for (uint64_t id = 1; id <= 3; id++) {
+    orderbook_limit(&parent, (struct order){.side = SIDE_BID,
+                                            .order_id = id,
+                                            .price = 100 - id,
+                                            .size = id});
+    orderbook_limit(&parent, (struct order){.side = SIDE_ASK,
+                                            .order_id = 10 + id,
+                                            .price = 100 + id,
+                                            .size = id});
+  }
+}
+
+void orderbook_fork_teardown(void) {
+  orderbook_free(&parent);
+}
+
+Test(orderbook_fork,
+     execute,
+     .init = orderbook_fork_setup,
+     .fini = orderbook_fork_teardown) {
+  struct orderbook_fork fork = orderbook_fork(&parent, 0);
+  struct orderbook_fork_level asks[3];
+
+  // the buy takes the level at 101 and half of the one at 102
+  struct limit_tree_fill fill = orderbook_fork_execute(&fork, SIDE_BID, 2);
+  cr_assert_eq(fill.size, 2);
+  cr_assert_eq(fill.worst_price, 102);
+  cr_assert_eq(fill.cost, 101 + 102);
+  cr_assert_eq(fork.last_price, 102);
+  cr_assert_eq(orderbook_fork_top_n(&fork, SIDE_ASK, 3, asks), 2);
+  cr_assert_eq(asks[0].price, 102);
+  cr_assert_eq(asks[0].volume, 1);
+  cr_assert_eq(asks[1].price, 103);
+  cr_assert_eq(asks[1].volume, 3);
+
+  // costing does not take anything, running out fills what is left
+  fill = orderbook_fork_cost_to_fill(&fork, SIDE_BID, 10);
+  cr_assert_eq(fill.size, 4);
+  cr_assert_eq(fill.cost, 102 + 3 * 103);
+  fill = orderbook_fork_execute(&fork, SIDE_BID, 10);
+  cr_assert_eq(fill.size, 4);
+  cr_assert_eq(orderbook_fork_top_n(&fork, SIDE_ASK, 3, asks), 0);
+  fill = orderbook_fork_execute(&fork, SIDE_BID, 1);
+  cr_assert_eq(fill.size, 0);
+  cr_assert_eq(fork.last_price, 103);
+
+  // the bids and the book itself are untouched
+  struct orderbook_fork_level bids[3];
+  cr_assert_eq(orderbook_fork_top_n(&fork, SIDE_BID, 3, bids), 3);
+  cr_assert_eq(bids[0].price, 99);
+  cr_assert_eq(bids[2].volume, 3);
+  cr_assert_eq(parent.ask->best->price, 101);
+  cr_assert_eq(parent.ask->best->volume, 1);
+  orderbook_fork_free(&fork);
+}
+
+Test(orderbook_fork,
+     clone,
+     .init = orderbook_fork_setup,
+     .fini = orderbook_fork_teardown) {
+  struct orderbook_fork fork = orderbook_fork(&parent, 2);
+  orderbook_fork_execute(&fork, SIDE_ASK, 2);
+
+  // the clone starts where the fork is, then each goes its own way
+  struct orderbook_fork clone = orderbook_fork_clone(&fork);
+  cr_assert_eq(clone.snapshot, fork.snapshot);
+  orderbook_fork_execute(&clone, SIDE_ASK, 1);
+  orderbook_fork_execute(&fork, SIDE_BID, 1);
+
+  struct orderbook_fork_level levels[3];
+  cr_assert_eq(orderbook_fork_top_n(&fork, SIDE_BID, 3, levels), 1);
+  cr_assert_eq(levels[0].volume, 1);
+  cr_assert_eq(orderbook_fork_top_n(&clone, SIDE_BID, 3, levels), 0);
+  cr_assert_eq(orderbook_fork_top_n(&clone, SIDE_ASK, 3, levels), 2);
+  cr_assert_eq(orderbook_fork_top_n(&fork, SIDE_ASK, 3, levels), 1);
+  cr_assert_eq(levels[0].price, 102);
+
+  // only 2 levels a side were copied
+  cr_assert_eq(orderbook_fork_cost_to_fill(&clone, SIDE_BID, 10).size, 3);
+
+  orderbook_fork_free(&fork);
+  orderbook_fork_free(&clone);
+  orderbook_fork_free(&clone);  // freeing twice is harmless
+}
+
+void* orderbook_fork_simulate(void* arg) {
+  struct orderbook_fork* fork = arg;
+  struct limit_tree_fill fill = orderbook_fork_execute(fork, SIDE_BID, 6);
+  orderbook_fork_free(fork);
+  return (void*)(uintptr_t)fill.cost;
+}
+
+Test(orderbook_fork,
+     other_thread,
+     .init = orderbook_fork_setup,
+     .fini = orderbook_fork_teardown) {
+  struct orderbook_fork fork = orderbook_fork(&parent, 0);
+  struct orderbook_fork clone = orderbook_fork_clone(&fork);
+
+  // the book keeps matching while the fork is used elsewhere
+  pthread_t thread;
+  pthread_create(&thread, NULL, orderbook_fork_simulate, &clone);
+  orderbook_execute(&parent, 11, SIDE_BID, 1, 1, true);
+  orderbook_fork_free(&fork);
+
+  void* cost;
+  pthread_join(thread, &cost);
+  cr_assert_eq((uintptr_t)cost, 101 + 2 * 102 + 3 * 103);
+  cr_assert_eq(parent.ask->best->price, 102);
+}
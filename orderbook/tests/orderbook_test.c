@@ -1,6 +1,8 @@
 #include <criterion/criterion.h>
 #include <criterion/new/assert.h>
 
+#include <string.h>
+
 #include "orderbook.h"
 #include "tests/orderbook_message.h"
 
@@ -833,4 +835,835 @@ Test(orderbook,
   cr_assert(eq(events.trade_events[0].size, 1));
   cr_assert(eq(events.trade_events[0].side, SIDE_ASK));
   cr_assert(eq(events.trade_events[0].price, order.price));
-}
\ No newline at end of file
+}
+
+Test(orderbook, order_index_fallback, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.order_index_pages = 2;
+  ob = orderbook_new_with_config(config);
+
+  // the first order pins the window, the last one is past its end
+  const uint64_t far = 2 * ORDER_INDEX_PAGE_SIZE;
+  const uint64_t order_ids[] = {1, 2, 3, far};
+  for (int i = 0; i < 4; i++)
+    orderbook_limit(&ob, (struct order){.side = SIDE_BID,
+                                        .order_id = order_ids[i],
+                                        .price = 100,
+                                        .size = 1});
+  cr_assert(eq(ob.order_index->size, 3));
+  cr_assert(eq(ob.order_map.size, 1));
+
+  // both are found wherever they were indexed
+  cr_assert(eq(orderbook_amend_size(&ob, 2, 5), OBERR_OKAY));
+  cr_assert(eq(orderbook_amend_size(&ob, far, 5), OBERR_OKAY));
+  cr_assert(eq(orderbook_cancel(&ob, far), OBERR_OKAY));
+  cr_assert(eq(orderbook_cancel(&ob, far), OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(ob.order_map.size, 0));
+
+  // fills unindex the orders too
+  orderbook_execute(&ob, far + 1, SIDE_ASK, 10, 10, true);
+  cr_assert(eq(ob.order_index->size, 0));
+  cr_assert(eq(orderbook_cancel(&ob, 1), OBERR_ORDER_NOT_FOUND));
+}
+
+struct batches {
+  struct event events[MAX_EVENT];
+  uint32_t events_len;
+  uint32_t calls;
+} batches;
+
+void handle_batch(uint64_t ob_id,
+                  struct event* events,
+                  uint32_t n,
+                  void* user_data) {
+  for (uint32_t i = 0; i < n; i++)
+    batches.events[batches.events_len++] = events[i];
+  batches.calls++;
+}
+
+Test(orderbook, batch_events, .fini = orderbook_teardown) {
+  struct event batch[8];
+  ob = orderbook_new();
+  events.handler = event_handler_with_batch(handle_batch, batch, 8);
+  orderbook_set_event_handler(&ob, &events.handler);
+  batches.events_len = batches.calls = 0;
+
+  for (uint64_t id = 1; id <= 3; id++)
+    orderbook_limit(&ob, (struct order){.side = SIDE_BID,
+                                        .order_id = id,
+                                        .price = 10000 + id,
+                                        .size = 1});
+  cr_assert(eq(batches.calls, 3));
+
+  // a sweep of 3 orders is one created event and 3 events per fill, that is
+  // more than the buffer holds so it is handed over twice
+  orderbook_execute(&ob, 4, SIDE_ASK, 3, 3, true);
+  cr_assert(eq(batches.calls, 5));
+  cr_assert(eq(batches.events_len, 3 + 10));
+
+  cr_assert(eq(batches.events[3].type, EVENT_TYPE_ORDER));
+  cr_assert(eq(batches.events[3].order_event.status, ORDER_STATUS_CREATED));
+  cr_assert(eq(batches.events[4].order_event.order_id, 3));
+  cr_assert(eq(batches.events[6].type, EVENT_TYPE_TRADE));
+  cr_assert(eq(batches.events[6].trade_event.seller_order_id, 4));
+  cr_assert(eq(batches.events[6].trade_event.buyer_order_id, 3));
+  cr_assert(eq(batches.events[11].order_event.status, ORDER_STATUS_FILLED));
+  cr_assert(eq(batches.events[11].order_event.order_id, 4));
+
+  // nothing is left behind in the buffer
+  cr_assert(eq(events.handler.batch_len, 0));
+  cr_assert(eq(orderbook_cancel(&ob, 1), OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(batches.calls, 5));
+}
+
+// a compile-time sink writing straight into the same buffers as the handler
+#define ORDERBOOK_SINK_EXECUTE orderbook_execute_static
+#define ORDERBOOK_SINK_ORDER_EVENT(ob, event) \
+  events.order_events[events.order_events_len++] = event
+#define ORDERBOOK_SINK_TRADE_EVENT(ob, event) \
+  events.trade_events[events.trade_events_len++] = event
+#include "orderbook_sink.h"
+
+Test(orderbook,
+     compile_time_sink,
+     .init = orderbook_setup_with_event_handler,
+     .fini = orderbook_teardown) {
+  struct order_event order_events[MAX_EVENT];
+  struct trade_event trade_events[MAX_EVENT];
+
+  // the same sweep through the handler, then through the sink
+  for (int run = 0; run < 2; run++) {
+    events.order_events_len = events.trade_events_len = 0;
+    for (uint64_t id = 1; id <= 3; id++)
+      orderbook_limit(&ob, (struct order){.side = SIDE_ASK,
+                                          .order_id = id,
+                                          .price = 100 + id,
+                                          .size = 2});
+    events.order_events_len = events.trade_events_len = 0;
+
+    if (run == 0) {
+      cr_assert(eq(orderbook_execute(&ob, 4, SIDE_BID, 7, 7, true), 1));
+      memcpy(order_events, events.order_events, sizeof(order_events));
+      memcpy(trade_events, events.trade_events, sizeof(trade_events));
+    } else {
+      orderbook_set_event_handler(&ob, NULL);
+      cr_assert(eq(orderbook_execute_static(&ob, 4, SIDE_BID, 7, 7, true), 1));
+    }
+  }
+  // the sink publishes the asks it swept too
+  cr_assert(eq(top_of_book_read(ob.top_of_book).ask.price, 0));
+
+  cr_assert(eq(events.order_events_len, 8));
+  cr_assert(eq(events.trade_events_len, 3));
+  for (int i = 0; i < 8; i++) {
+    cr_assert(eq(events.order_events[i].status, order_events[i].status));
+    cr_assert(eq(events.order_events[i].order_id, order_events[i].order_id));
+    cr_assert(eq(events.order_events[i].filled_size,
+                 order_events[i].filled_size));
+    cr_assert(eq(events.order_events[i].remaining_size,
+                 order_events[i].remaining_size));
+    cr_assert(eq(events.order_events[i].price, order_events[i].price));
+  }
+  for (int i = 0; i < 3; i++) {
+    cr_assert(eq(events.trade_events[i].size, trade_events[i].size));
+    cr_assert(eq(events.trade_events[i].price, trade_events[i].price));
+    cr_assert(eq(events.trade_events[i].seller_order_id,
+                 trade_events[i].seller_order_id));
+  }
+}
+
+// asks of size 2 at 101, 102 and 103
+void orderbook_setup_asks(void) {
+  orderbook_setup_with_event_handler();
+  for (uint64_t id = 1; id <= 3; id++)
+    orderbook_limit(&ob, (struct order){.side = SIDE_ASK,
+                                        .order_id = id,
+                                        .price = 100 + id,
+                                        .size = 2});
+  events.order_events_len = events.trade_events_len = 0;
+}
+
+Test(orderbook,
+     place_gtc_crosses_then_rests,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  struct order order = {
+      .side = SIDE_BID, .order_id = 4, .price = 102, .size = 5};
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_GTC, false), 1));
+
+  // both levels up to the limit price are taken, the rest is the new best bid
+  cr_assert(eq(events.trade_events_len, 2));
+  cr_assert(eq(events.trade_events[1].price, 102));
+  cr_assert(eq(ob.ask->best->price, 103));
+  cr_assert(eq(ob.bid->best->price, 102));
+  cr_assert(eq(ob.bid->best->volume, 1));
+  cr_assert(eq(ob.bid->best->order_head->cum_filled_size, 4));
+
+  cr_assert(eq(events.order_events[0].status, ORDER_STATUS_CREATED));
+  cr_assert(eq(events.order_events[0].price, 102));
+  cr_assert(eq(events.order_events_len, 5));
+
+  // the resting part can be cancelled as usual
+  cr_assert(eq(orderbook_cancel(&ob, 4), OBERR_OKAY));
+  cr_assert(eq(ob.bid->best, NULL));
+}
+
+Test(orderbook,
+     place_ioc,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  struct order order = {
+      .side = SIDE_BID, .order_id = 4, .price = 101, .size = 3};
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_IOC, false), 1));
+  cr_assert(eq(ob.bid->best, NULL));
+  cr_assert(eq(ob.ask->best->price, 102));
+
+  struct order_event last = events.order_events[events.order_events_len - 1];
+  cr_assert(eq(last.status, ORDER_STATUS_PARTIALLY_FILLED_CANCELLED));
+  cr_assert(eq(last.cum_filled_size, 2));
+  cr_assert(eq(last.remaining_size, 1));
+
+  // nothing crosses, it is cancelled outright
+  order.order_id = 5, order.price = 100;
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_IOC, false), 3));
+  last = events.order_events[events.order_events_len - 1];
+  cr_assert(eq(last.status, ORDER_STATUS_CANCELLED));
+  cr_assert(eq(events.trade_events_len, 1));
+}
+
+Test(orderbook,
+     place_fok,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  // 4 is available up to 102, not 5
+  struct order order = {
+      .side = SIDE_BID, .order_id = 4, .price = 102, .size = 5};
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_FOK, false), 5));
+  cr_assert(eq(events.order_events_len, 1));
+  cr_assert(eq(events.order_events[0].status, ORDER_STATUS_REJECTED));
+  cr_assert(eq(events.order_events[0].reject_reason,
+               REJECT_REASON_NO_LIQUIDITY));
+  cr_assert(eq(ob.ask->best->volume, 2));
+
+  order.order_id = 5, order.price = 103;
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_FOK, false), 0));
+  cr_assert(eq(events.trade_events_len, 3));
+  cr_assert(eq(ob.ask->best->volume, 1));
+  cr_assert(eq(ob.bid->best, NULL));
+}
+
+Test(orderbook,
+     place_post_only,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  struct order order = {
+      .side = SIDE_BID, .order_id = 4, .price = 101, .size = 1};
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_GTC, true), 1));
+  cr_assert(eq(events.order_events[0].reject_reason,
+               REJECT_REASON_WOULD_CROSS));
+  cr_assert(eq(ob.bid->best, NULL));
+
+  order.order_id = 5, order.price = 100;
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_GTC, true), 1));
+  cr_assert(eq(ob.bid->best->price, 100));
+  cr_assert(eq(events.trade_events_len, 0));
+}
+
+Test(orderbook,
+     process_batch,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  // more than the prefetch distance, so the look ahead runs too
+  struct ob_command commands[40];
+  for (int i = 0; i < 40; i++)
+    commands[i] = (struct ob_command){.type = OB_COMMAND_LIMIT,
+                                      .side = SIDE_BID,
+                                      .order_id = 10 + i,
+                                      .price = 50,
+                                      .size = 1};
+  commands[30] = (struct ob_command){
+      .type = OB_COMMAND_AMEND_SIZE, .order_id = 12, .size = 5};
+  commands[31] = (struct ob_command){.type = OB_COMMAND_CANCEL, .order_id = 11};
+  commands[32] = (struct ob_command){.type = OB_COMMAND_CANCEL, .order_id = 99};
+  commands[33] = (struct ob_command){
+      .type = OB_COMMAND_MARKET, .side = SIDE_BID, .order_id = 100, .size = 3};
+  commands[34] = (struct ob_command){.type = OB_COMMAND_PLACE,
+                                     .side = SIDE_BID,
+                                     .order_id = 101,
+                                     .price = 103,
+                                     .size = 4,
+                                     .time_in_force = TIME_IN_FORCE_IOC};
+  commands[35] = (struct ob_command){
+      .type = OB_COMMAND_AMEND_SIZE, .order_id = 13, .size = 0};
+
+  struct ob_result results[40];
+  orderbook_process_batch(&ob, commands, 40, results);
+
+  cr_assert(eq(results[0].error, OBERR_OKAY));
+  cr_assert(eq(results[30].error, OBERR_OKAY));
+  cr_assert(eq(results[31].error, OBERR_OKAY));
+  cr_assert(eq(results[32].error, OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(results[33].remaining_size, 0));
+  cr_assert(eq(results[34].remaining_size, 1));
+  cr_assert(eq(results[35].error, OBERR_INVALID_ORDER_SIZE));
+
+  // 34 limits, one cancelled and one amended from 1 to 5
+  cr_assert(eq(ob.bid->best->price, 50));
+  cr_assert(eq(ob.bid->best->order_count, 33));
+  cr_assert(eq(ob.bid->best->volume, 37));
+  cr_assert(eq(ob.ask->best, NULL));
+
+  // results are optional
+  commands[0] = (struct ob_command){.type = OB_COMMAND_CANCEL, .order_id = 10};
+  orderbook_process_batch(&ob, commands, 1, NULL);
+  cr_assert(eq(ob.bid->best->order_count, 32));
+}
+
+struct mass_cancels {
+  struct mass_cancel_event events[2];
+  size_t len;
+} mass_cancels;
+
+void handle_mass_cancel_event(uint64_t ob_id,
+                              struct mass_cancel_event event,
+                              void* user_data) {
+  mass_cancels.events[mass_cancels.len++] = event;
+}
+
+// two owners with an order each at bids 10, 11, 12 and asks 20, 21, 22
+int owners[2];
+void orderbook_setup_owners(void) {
+  orderbook_setup_with_event_handler();
+  events.handler.handle_mass_cancel_event = handle_mass_cancel_event;
+  for (uint64_t i = 0; i < 12; i++)
+    orderbook_limit(&ob, (struct order){.side = i < 6 ? SIDE_BID : SIDE_ASK,
+                                        .order_id = 1 + i,
+                                        .price = (i < 6 ? 10 : 17) + i / 2,
+                                        .size = 1 + i,
+                                        .user_data = &owners[i % 2]});
+  events.order_events_len = mass_cancels.len = 0;
+}
+
+Test(orderbook,
+     cancel_range,
+     .init = orderbook_setup_owners,
+     .fini = orderbook_teardown) {
+  cr_assert(eq(orderbook_cancel_range(&ob, SIDE_BID, 11, 15, false), 4));
+
+  // one event per order, lowest price first and in queue order
+  cr_assert(eq(events.order_events_len, 4));
+  for (size_t i = 0; i < 4; i++) {
+    cr_assert(eq(events.order_events[i].status, ORDER_STATUS_CANCELLED));
+    cr_assert(eq(events.order_events[i].order_id, 3 + i));
+    cr_assert(eq(events.order_events[i].remaining_size, 3 + i));
+  }
+  cr_assert(eq(mass_cancels.len, 0));
+
+  cr_assert(eq(ob.bid->best->price, 10));
+  cr_assert(eq(ob.bid->size, 1));
+  cr_assert(eq(orderbook_cancel(&ob, 3), OBERR_ORDER_NOT_FOUND));
+
+  // nothing in range
+  cr_assert(eq(orderbook_cancel_range(&ob, SIDE_ASK, 0, 19, false), 0));
+  cr_assert(eq(ob.ask->size, 3));
+}
+
+Test(orderbook,
+     cancel_owner,
+     .init = orderbook_setup_owners,
+     .fini = orderbook_teardown) {
+  cr_assert(eq(orderbook_cancel_owner(&ob, &owners[1], true), 6));
+
+  // a summary per side instead of an event per order
+  cr_assert(eq(events.order_events_len, 0));
+  cr_assert(eq(mass_cancels.len, 2));
+  cr_assert(eq(mass_cancels.events[0].side, SIDE_BID));
+  cr_assert(eq(mass_cancels.events[0].order_count, 3));
+  cr_assert(eq(mass_cancels.events[0].size, 2 + 4 + 6));
+  cr_assert(eq(mass_cancels.events[1].side, SIDE_ASK));
+  cr_assert(eq(mass_cancels.events[1].size, 8 + 10 + 12));
+
+  // the levels keep the orders of the other owner
+  cr_assert(eq(ob.bid->size, 3));
+  cr_assert(eq(ob.bid->best->order_count, 1));
+  cr_assert(eq(ob.bid->best->order_head->order_id, 5));
+  cr_assert(eq(ob.bid->best->volume, 5));
+  cr_assert(eq(orderbook_cancel(&ob, 2), OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(orderbook_cancel(&ob, 1), OBERR_OKAY));
+  cr_assert(eq(ob.bid->size, 2));
+}
+
+Test(orderbook,
+     cancel_all,
+     .init = orderbook_setup_owners,
+     .fini = orderbook_teardown) {
+  cr_assert(eq(orderbook_cancel_side(&ob, SIDE_ASK, false), 6));
+  cr_assert(eq(events.order_events_len, 6));
+  cr_assert(eq(events.order_events[0].order_id, 7));
+  cr_assert(eq(events.order_events[5].order_id, 12));
+  cr_assert(eq(ob.ask->best, NULL));
+
+  // the side's orders and levels went back to the pools the bids share
+  cr_assert(eq(ob.order_pool->in_use, 6));
+  cr_assert(eq(ob.limit_pool->in_use, ob.bid->size));
+
+  cr_assert(eq(orderbook_cancel_all(&ob, true), 6));
+  cr_assert(eq(mass_cancels.len, 1));
+  cr_assert(eq(mass_cancels.events[0].order_count, 6));
+  cr_assert(eq(ob.bid->best, NULL));
+  cr_assert(eq(ob.bid->size, 0));
+  cr_assert(eq(ob.order_map.size, 0));
+
+  // the cleared book is usable again
+  orderbook_limit(
+      &ob, (struct order){
+               .side = SIDE_BID, .order_id = 1, .price = 9, .size = 1});
+  cr_assert(eq(ob.bid->best->price, 9));
+  cr_assert(eq(orderbook_cancel(&ob, 1), OBERR_OKAY));
+}
+
+Test(orderbook,
+     mass_cancel_triggers,
+     .init = orderbook_setup_owners,
+     .fini = orderbook_teardown) {
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_BID,
+                                         .order_id = 20,
+                                         .size = 1,
+                                         .user_data = &owners[0]},
+                          TRIGGER_TYPE_STOP, 30);
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_ASK,
+                                         .order_id = 21,
+                                         .size = 2,
+                                         .user_data = &owners[1]},
+                          TRIGGER_TYPE_STOP, 5);
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_BID,
+                                         .order_id = 22,
+                                         .size = 3,
+                                         .user_data = &owners[1]},
+                          TRIGGER_TYPE_TAKE_PROFIT, 5);
+  events.order_events_len = 0;
+
+  // the owner's pending triggers go with its resting orders, after them
+  cr_assert(eq(orderbook_cancel_owner(&ob, &owners[1], false), 8));
+  cr_assert(eq(events.order_events_len, 8));
+  cr_assert(eq(events.order_events[3].order_id, 22));
+  cr_assert(eq(events.order_events[3].status, ORDER_STATUS_CANCELLED));
+  cr_assert(eq(events.order_events[7].order_id, 21));
+  cr_assert(eq(ob.triggers->size, 1));
+
+  // and a side's with the side, counted in its summary
+  cr_assert(eq(orderbook_cancel_side(&ob, SIDE_BID, true), 4));
+  cr_assert(eq(mass_cancels.len, 1));
+  cr_assert(eq(mass_cancels.events[0].order_count, 4));
+  cr_assert(eq(mass_cancels.events[0].size, 1 + 3 + 5 + 1));
+  cr_assert(eq(ob.triggers->size, 0));
+  cr_assert(eq(orderbook_cancel(&ob, 20), OBERR_ORDER_NOT_FOUND));
+
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_ASK,
+                                         .order_id = 23,
+                                         .size = 1},
+                          TRIGGER_TYPE_STOP, 5);
+  cr_assert(eq(orderbook_cancel_all(&ob, true), 3 + 1));
+  cr_assert(eq(ob.triggers->size, 0));
+}
+
+Test(orderbook, cancel_side_keeps_sizing, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_sized(1 << 12, 1 << 10);
+  ob = orderbook_new_with_config(config);
+  uint32_t map_capacity = ob.ask->price_limit_map.capacity;
+  for (uint64_t id = 1; id <= 100; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = SIDE_ASK, .order_id = id,
+                             .price = 100 + id, .size = 1});
+
+  cr_assert(eq(orderbook_cancel_side(&ob, SIDE_ASK, true), 100));
+  cr_assert(eq(ob.ask->price_limit_map.capacity, map_capacity));
+  cr_assert(eq(ob.ask->size, 0));
+  cr_assert(eq(ob.order_pool->in_use, 0));
+  cr_assert(eq(ob.limit_pool->in_use, 0));
+}
+
+Test(orderbook,
+     trigger_cascade,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  orderbook_place_trigger(
+      &ob, (struct order){.side = SIDE_BID, .order_id = 10, .size = 2},
+      TRIGGER_TYPE_STOP, 101);
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_BID,
+                                         .order_id = 11,
+                                         .price = 103,
+                                         .size = 1},
+                          TRIGGER_TYPE_STOP_LIMIT, 102);
+  cr_assert(eq(events.order_events_len, 2));
+  cr_assert(eq(events.order_events[0].status, ORDER_STATUS_PENDING_TRIGGER));
+  cr_assert(eq(events.order_events[1].price, 102));
+  events.order_events_len = 0;
+
+  // trades at 101, which triggers 10 that trades at 102, which triggers 11
+  cr_assert(eq(orderbook_execute(&ob, 20, SIDE_BID, 1, 1, true), 0));
+  cr_assert(eq(ob.last_price, 102));
+  cr_assert(eq(ob.triggers->size, 0));
+  cr_assert(eq(events.trade_events_len, 4));
+  cr_assert(eq(events.trade_events[1].buyer_order_id, 10));
+  cr_assert(eq(events.trade_events[1].price, 101));
+  cr_assert(eq(events.trade_events[2].buyer_order_id, 10));
+  cr_assert(eq(events.trade_events[2].price, 102));
+  cr_assert(eq(events.trade_events[3].buyer_order_id, 11));
+  cr_assert(eq(events.trade_events[3].price, 102));
+
+  size_t triggered = 0;
+  for (size_t i = 0; i < events.order_events_len; i++)
+    if (events.order_events[i].status == ORDER_STATUS_TRIGGERED)
+      cr_assert(eq(events.order_events[i].order_id, 10 + triggered++));
+  cr_assert(eq(triggered, 2));
+
+  cr_assert(eq(ob.ask->best->price, 103));
+  cr_assert(eq(ob.ask->best->volume, 2));
+  cr_assert(eq(ob.bid->best, NULL));
+}
+
+Test(orderbook,
+     trigger_cancel_and_crossed,
+     .init = orderbook_setup_asks,
+     .fini = orderbook_teardown) {
+  // nothing has traded yet, so nothing is crossed
+  orderbook_place_trigger(
+      &ob, (struct order){.side = SIDE_ASK, .order_id = 10, .size = 1},
+      TRIGGER_TYPE_STOP, 200);
+  cr_assert(eq(ob.triggers->size, 1));
+
+  events.order_events_len = 0;
+  cr_assert(eq(orderbook_cancel(&ob, 10), OBERR_OKAY));
+  cr_assert(eq(events.order_events[0].status, ORDER_STATUS_CANCELLED));
+  cr_assert(eq(events.order_events[0].price, 200));
+  cr_assert(eq(orderbook_cancel(&ob, 10), OBERR_ORDER_NOT_FOUND));
+
+  // a take profit sell at or below the last price goes straight in
+  cr_assert(eq(orderbook_execute(&ob, 20, SIDE_BID, 1, 1, true), 0));
+  orderbook_place_trigger(&ob,
+                          (struct order){.side = SIDE_ASK,
+                                         .order_id = 11,
+                                         .price = 105,
+                                         .size = 3},
+                          TRIGGER_TYPE_TAKE_PROFIT_LIMIT, 100);
+  cr_assert(eq(ob.triggers->size, 0));
+  cr_assert(eq(ob.ask->size, 4));
+  cr_assert(eq(orderbook_cancel(&ob, 11), OBERR_OKAY));
+}
+
+struct level_updates {
+  struct level_update_event events[MAX_EVENT];
+  size_t len;
+} level_updates;
+
+void handle_level_update_event(uint64_t ob_id,
+                               struct level_update_event event,
+                               void* user_data) {
+  level_updates.events[level_updates.len++] = event;
+}
+
+void orderbook_setup_level_updates(void) {
+  orderbook_setup_asks();
+  events.handler.handle_level_update_event = handle_level_update_event;
+  events.handler.level_updates = true;
+  orderbook_limit(&ob, (struct order){.side = SIDE_ASK,
+                                      .order_id = 4,
+                                      .price = 101,
+                                      .size = 3});
+  level_updates.len = 0;
+}
+
+Test(orderbook,
+     level_updates,
+     .init = orderbook_setup_level_updates,
+     .fini = orderbook_teardown) {
+  // two fills at 101 and one at 102 are reported as one update per level
+  cr_assert(eq(orderbook_execute(&ob, 10, SIDE_BID, 6, 6, true), 0));
+  cr_assert(eq(level_updates.len, 2));
+  cr_assert(eq(level_updates.events[0].side, SIDE_ASK));
+  cr_assert(eq(level_updates.events[0].price, 101));
+  cr_assert(eq(level_updates.events[0].volume, 0));
+  cr_assert(eq(level_updates.events[0].order_count, 0));
+  cr_assert(eq(level_updates.events[1].price, 102));
+  cr_assert(eq(level_updates.events[1].volume, 1));
+  cr_assert(eq(level_updates.events[1].order_count, 1));
+
+  // crossing then resting changes a level on each side
+  level_updates.len = 0;
+  struct order order = {
+      .side = SIDE_BID, .order_id = 11, .price = 102, .size = 3};
+  orderbook_place(&ob, order, TIME_IN_FORCE_GTC, false);
+  cr_assert(eq(level_updates.len, 2));
+  cr_assert(eq(level_updates.events[0].price, 102));
+  cr_assert(eq(level_updates.events[0].volume, 0));
+  cr_assert(eq(level_updates.events[1].side, SIDE_BID));
+  cr_assert(eq(level_updates.events[1].volume, 2));
+
+  level_updates.len = 0;
+  cr_assert(eq(orderbook_amend_size(&ob, 11, 5), OBERR_OKAY));
+  cr_assert(eq(orderbook_cancel(&ob, 3), OBERR_OKAY));
+  cr_assert(eq(level_updates.len, 2));
+  cr_assert(eq(level_updates.events[0].volume, 5));
+  cr_assert(eq(level_updates.events[1].price, 103));
+  cr_assert(eq(level_updates.events[1].order_count, 0));
+
+  // off again, nothing is tracked
+  events.handler.level_updates = false;
+  orderbook_limit(&ob, (struct order){.side = SIDE_ASK,
+                                      .order_id = 12,
+                                      .price = 110,
+                                      .size = 1});
+  cr_assert(eq(level_updates.len, 2));
+}
+
+Test(orderbook, depth_queries, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.depth_aggregates = true;
+  ob = orderbook_new_with_config(config);
+  for (uint64_t id = 1; id <= 3; id++)
+    orderbook_limit(&ob, (struct order){.side = SIDE_ASK,
+                                        .order_id = id,
+                                        .price = 100 + id,
+                                        .size = id});
+
+  // a buy up to 102 would take the 1 at 101 and the 2 at 102
+  cr_assert(eq(orderbook_volume_to_price(&ob, SIDE_BID, 102), 3));
+  cr_assert(eq(orderbook_volume_to_price(&ob, SIDE_BID, 100), 0));
+  cr_assert(eq(orderbook_volume_to_price(&ob, SIDE_ASK, 0), 0));  // no bids
+
+  struct limit_tree_fill fill = orderbook_cost_to_fill(&ob, SIDE_BID, 4);
+  cr_assert(eq(fill.size, 4));
+  cr_assert(eq(fill.worst_price, 103));
+  cr_assert(eq(fill.cost, 101 + 2 * 102 + 103));
+
+  // the totals follow fills, amends and cancels
+  orderbook_execute(&ob, 4, SIDE_BID, 2, 2, true);
+  cr_assert(eq(orderbook_amend_size(&ob, 3, 5), OBERR_OKAY));
+  cr_assert(eq(orderbook_cancel(&ob, 2), OBERR_OKAY));
+  cr_assert(eq(orderbook_volume_to_price(&ob, SIDE_BID, 103), 5));
+  fill = orderbook_cost_to_fill(&ob, SIDE_BID, 10);
+  cr_assert(eq(fill.size, 5));
+  cr_assert(eq(fill.cost, 5 * 103));
+
+  // FOK is checked against the totals too
+  struct order order = {
+      .side = SIDE_BID, .order_id = 5, .price = 103, .size = 6};
+  cr_assert(eq(orderbook_place(&ob, order, TIME_IN_FORCE_FOK, false), 6));
+  cr_assert(eq(ob.ask->root->subtree_volume, 5));
+}
+
+Test(orderbook, queue_position, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.queue_positions = true;
+  ob = orderbook_new_with_config(config);
+  for (uint64_t id = 1; id <= 20; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = SIDE_BID, .order_id = id, .price = 100,
+                             .size = id});
+
+  // orders 1 to 9 are ahead of 10, going through a few resets of the queue
+  struct queue_position position;
+  cr_assert(eq(orderbook_queue_position(&ob, 10, &position), OBERR_OKAY));
+  cr_assert(eq(position.orders_ahead, 9));
+  cr_assert(eq(position.volume_ahead, 45));
+
+  // a partial fill at the front, a cancel ahead and an amend ahead
+  orderbook_execute(&ob, 21, SIDE_ASK, 2, 2, true);
+  cr_assert(eq(orderbook_cancel(&ob, 5), OBERR_OKAY));
+  cr_assert(eq(orderbook_amend_size(&ob, 9, 1), OBERR_OKAY));
+  cr_assert(eq(orderbook_queue_position(&ob, 10, &position), OBERR_OKAY));
+  cr_assert(eq(position.orders_ahead, 7));
+  cr_assert(eq(position.volume_ahead, 45 - 2 - 5 - 8));
+
+  cr_assert(eq(orderbook_queue_position(&ob, 1, &position),
+               OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(orderbook_queue_position(&ob, 2, &position), OBERR_OKAY));
+  cr_assert(eq(position.orders_ahead, 0));
+}
+
+Test(orderbook, order_rings, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.order_rings = true;
+  ob = orderbook_new_with_config(config);
+  events.handler = event_handler_new();
+  events.handler.handle_order_event = handle_order_event;
+  events.handler.handle_trade_event = handle_trade_event;
+  orderbook_set_event_handler(&ob, &events.handler);
+  for (uint64_t id = 1; id <= 20; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = SIDE_ASK, .order_id = id, .price = 100,
+                             .size = 1});
+
+  // cancels from the middle leave tombstones that the fills step over
+  for (uint64_t id = 2; id <= 18; id += 2)
+    cr_assert(eq(orderbook_cancel(&ob, id), OBERR_OKAY));
+  cr_assert(eq(ob.ask->best->order_count, 11));
+  cr_assert(eq(orderbook_amend_size(&ob, 19, 2), OBERR_OKAY));
+
+  events.trade_events_len = 0;
+  cr_assert(eq(orderbook_execute(&ob, 21, SIDE_BID, 10, 10, true), 0));
+  uint64_t filled[] = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19};
+  for (int i = 0; i < 10; i++)
+    cr_assert(eq(events.trade_events[i].seller_order_id, filled[i]));
+
+  // 19 is left with 1 ahead of 20
+  cr_assert(eq(ob.ask->best->order_head->order_id, 19));
+  cr_assert(eq(ob.ask->best->order_tail->order_id, 20));
+  cr_assert(eq(orderbook_cancel(&ob, 20), OBERR_OKAY));
+  cr_assert(eq(ob.ask->best->order_tail->order_id, 19));
+}
+
+Test(orderbook, compact_orders, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.compact_orders = true;
+  config.queue_positions = true;  // not kept for compact orders
+  ob = orderbook_new_with_config(config);
+  cr_assert(eq(ob.order_pool->object_size, ORDER_HOT_SIZE));
+  cr_assert(ob.order_rings);
+  cr_assert_not(ob.queue_positions);
+
+  int alice, bob;
+  for (uint64_t id = 1; id <= 6; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = id % 2 ? SIDE_ASK : SIDE_BID,
+                             .order_id = id,
+                             .price = id % 2 ? 101 : 99,
+                             .size = id,
+                             .user_data = id <= 2 ? &alice : &bob});
+
+  // the limit and the owner are looked up instead of linked to
+  cr_assert(eq(orderbook_amend_size(&ob, 3, 7), OBERR_OKAY));
+  cr_assert(eq(ob.ask->best->volume, 1 + 7 + 5));
+  struct queue_position position;
+  cr_assert(eq(orderbook_queue_position(&ob, 5, &position), OBERR_OKAY));
+  cr_assert(eq(position.orders_ahead, 2));
+  cr_assert(eq(position.volume_ahead, 1 + 7));
+
+  cr_assert(eq(orderbook_cancel_owner(&ob, &alice, false), 2));
+  cr_assert(eq(orderbook_cancel(&ob, 1), OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(ob.user_data_map.size, 4));
+  cr_assert(eq(orderbook_execute(&ob, 7, SIDE_BID, 7, 7, true), 0));
+  cr_assert(eq(ob.user_data_map.size, 3));
+  cr_assert(eq(orderbook_cancel_owner(&ob, &bob, false), 3));
+  cr_assert(eq(ob.user_data_map.size, 0));
+}
+
+Test(orderbook, reset, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_default();
+  config.limit_tree_kind = LIMIT_TREE_KIND_LADDER;
+  config.ladder_capacity = 64;
+  config.order_pool_capacity = 64;
+  config.order_rings = true;
+  ob = orderbook_new_with_config(config);
+
+  // levels in the ladder and outside of it, a trade and a pending trigger
+  for (uint64_t id = 1; id <= 200; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = SIDE_ASK, .order_id = id,
+                             .price = 100 + id % 50 * 10, .size = 1});
+  orderbook_execute(&ob, 201, SIDE_BID, 1, 1, true);
+  orderbook_place_trigger(
+      &ob, (struct order){.order_id = 202, .side = SIDE_BID, .size = 1},
+      TRIGGER_TYPE_STOP, 200);
+  uint32_t map_capacity = ob.order_map.capacity;
+  uint64_t slab_allocations = ob.order_pool->slab_allocations;
+
+  events.handler = event_handler_new();
+  events.handler.handle_order_event = handle_order_event;
+  orderbook_set_event_handler(&ob, &events.handler);
+  events.order_events_len = 0;
+  orderbook_reset(&ob);
+  cr_assert(eq(events.order_events_len, 0));
+  orderbook_set_event_handler(&ob, NULL);
+  cr_assert(eq(ob.ask->size, 0));
+  cr_assert(ob.ask->best == NULL);
+  cr_assert(eq(ob.order_pool->in_use, 0));
+  cr_assert(eq(ob.order_map.size, 0));
+  cr_assert(eq(ob.order_map.capacity, map_capacity));
+  cr_assert(eq(ob.triggers->size, 0));
+  cr_assert(eq(ob.last_price, 0));
+  cr_assert(eq(orderbook_cancel(&ob, 2), OBERR_ORDER_NOT_FOUND));
+  cr_assert(eq(orderbook_cancel(&ob, 202), OBERR_ORDER_NOT_FOUND));
+
+  // the same ids can be used again, and the pool does not grow
+  for (uint64_t id = 1; id <= 200; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = SIDE_BID, .order_id = id,
+                             .price = 1000 + id % 50, .size = 1});
+  cr_assert(eq(ob.order_pool->slab_allocations, slab_allocations));
+  cr_assert(eq(ob.bid->best->price, 1049));
+  cr_assert(eq(orderbook_execute(&ob, 201, SIDE_ASK, 8, 8, true), 0));
+  cr_assert(eq(ob.bid->best->order_count, 4));
+}
+
+Test(orderbook, huge_pages, .fini = orderbook_teardown) {
+  struct orderbook_config config = orderbook_config_sized(1000, 100);
+  config.huge_pages = true;
+  config.lock_memory = true;
+  ob = orderbook_new_with_config(config);
+
+  // whichever pages it got, the pools and maps are all in the reservation
+  cr_assert(ob.reservation.base != NULL);
+  cr_assert(eq(ob.reservation.size % PAGE_RESERVATION_HUGE_PAGE_SIZE, 0));
+  cr_assert(ob.reservation.used <= orderbook_reserved_size(config));
+  cr_assert(eq(ob.order_pool->capacity, 1000));
+  cr_assert(eq(ob.limit_pool->capacity, 200));
+  cr_assert(ob.order_map.borrowed);
+  cr_assert(ob.bid->price_limit_map.borrowed);
+  cr_assert(ob.ask->price_limit_map.borrowed);
+
+  // filling the book to the expected depth allocates nothing
+  for (uint64_t id = 1; id <= 1000; id++)
+    orderbook_limit(&ob, (struct order){
+                             .side = id % 2 ? SIDE_ASK : SIDE_BID,
+                             .order_id = id,
+                             .price = id % 2 ? 1000 + id % 100 : id % 100,
+                             .size = 1});
+  cr_assert(eq(ob.order_pool->slab_allocations, 0));
+  cr_assert(eq(ob.limit_pool->slab_allocations, 0));
+  cr_assert(ob.order_map.borrowed);
+  cr_assert(ob.bid->price_limit_map.borrowed);
+  cr_assert(eq(ob.bid->size, 50));
+}
+
+Test(orderbook,
+     top_of_book,
+     .init = orderbook_setup,
+     .fini = orderbook_teardown) {
+  for (uint64_t id = 1; id <= 3; id++)
+    orderbook_limit(&ob, (struct order){.side = id == 3 ? SIDE_ASK : SIDE_BID,
+                                        .order_id = id,
+                                        .price = id == 3 ? 101 : 99,
+                                        .size = id});
+  struct top_of_book_quote quote = top_of_book_read(ob.top_of_book);
+  cr_assert(eq(quote.bid.price, 99));
+  cr_assert(eq(quote.bid.volume, 3));
+  cr_assert(eq(quote.bid.order_count, 2));
+  cr_assert(eq(quote.ask.price, 101));
+  cr_assert(eq(quote.sequence, 6));
+
+  // a cancel deeper in the book leaves it alone
+  orderbook_limit(&ob, (struct order){
+                           .side = SIDE_ASK, .order_id = 4, .price = 105,
+                           .size = 1});
+  cr_assert(eq(orderbook_cancel(&ob, 4), OBERR_OKAY));
+  cr_assert(eq(top_of_book_read(ob.top_of_book).sequence, 6));
+
+  // a fill of the best ask empties that side
+  orderbook_execute(&ob, 5, SIDE_BID, 3, 3, true);
+  quote = top_of_book_read(ob.top_of_book);
+  cr_assert(eq(quote.ask.price, 0));
+  cr_assert(eq(quote.ask.volume, 0));
+  cr_assert(eq(quote.bid.volume, 3));
+
+  orderbook_amend_size(&ob, 1, 4);
+  cr_assert(eq(top_of_book_read(ob.top_of_book).bid.volume, 6));
+  orderbook_reset(&ob);
+  cr_assert(eq(top_of_book_read(ob.top_of_book).bid.price, 0));
+}
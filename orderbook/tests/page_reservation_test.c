@@ -0,0 +1,45 @@
+#include <criterion/criterion.h>
+
+#include <stdint.h>
+
+#include "page_reservation.h"
+
+struct page_reservation reservation;
+
+void page_reservation_teardown(void) {
+  page_reservation_free(&reservation);
+}
+
+Test(page_reservation, alloc, .fini = page_reservation_teardown) {
+  reservation = page_reservation_new(100, false);
+  cr_assert_neq(reservation.base, NULL);
+  cr_assert_eq(reservation.size, PAGE_RESERVATION_HUGE_PAGE_SIZE);
+  cr_assert_not(reservation.locked);
+
+  // zeroed and aligned, one after the other
+  unsigned char* first = page_reservation_alloc(&reservation, 100);
+  unsigned char* second = page_reservation_alloc(&reservation, 1);
+  cr_assert_eq(first, reservation.base);
+  cr_assert_eq(second, first + 128);
+  cr_assert_eq((uintptr_t)second % PAGE_RESERVATION_ALIGN, 0);
+  for (int i = 0; i < 100; i++)
+    cr_assert_eq(first[i], 0);
+
+  // nothing is handed out past the end
+  size_t left = reservation.size - reservation.used;
+  cr_assert_eq(page_reservation_alloc(&reservation, left), NULL);
+  cr_assert_neq(page_reservation_alloc(&reservation, left - 63), NULL);
+}
+
+Test(page_reservation, huge_page_fallback, .fini = page_reservation_teardown) {
+  reservation = page_reservation_new(3 * PAGE_RESERVATION_HUGE_PAGE_SIZE, true);
+  cr_assert_eq(reservation.size, 3 * PAGE_RESERVATION_HUGE_PAGE_SIZE);
+
+  // whatever the system has, the region is usable and huge page aligned
+  cr_assert(reservation.kind == PAGE_KIND_HUGETLB ||
+            reservation.kind == PAGE_KIND_TRANSPARENT ||
+            reservation.kind == PAGE_KIND_NORMAL);
+  cr_assert_eq((uintptr_t)reservation.base % PAGE_RESERVATION_HUGE_PAGE_SIZE,
+               0);
+  reservation.base[reservation.size - 1] = 1;
+}
@@ -0,0 +1,74 @@
+#include <criterion/criterion.h>
+
+#include <pthread.h>
+
+#include "top_of_book.h"
+
+#define TOP_OF_BOOK_UPDATES 100000
+
+struct top_of_book top;
+
+void top_of_book_setup(void) {
+  top = top_of_book_new();
+}
+
+Test(top_of_book, publish, .init = top_of_book_setup) {
+  struct limit bid = {.price = 99, .volume = 5, .order_count = 2};
+  struct limit ask = {.price = 101, .volume = 3, .order_count = 1};
+
+  struct top_of_book_quote quote = top_of_book_read(&top);
+  cr_assert_eq(quote.sequence, 0);
+  cr_assert_eq(quote.bid.price, 0);
+
+  top_of_book_publish(&top, &bid, &ask);
+  quote = top_of_book_read(&top);
+  cr_assert_eq(quote.sequence, 2);
+  cr_assert_eq(quote.bid.price, 99);
+  cr_assert_eq(quote.bid.volume, 5);
+  cr_assert_eq(quote.bid.order_count, 2);
+  cr_assert_eq(quote.ask.price, 101);
+  cr_assert_eq(quote.ask.volume, 3);
+
+  // nothing changed, nothing is written
+  top_of_book_publish(&top, &bid, &ask);
+  cr_assert_eq(top_of_book_read(&top).sequence, 2);
+
+  // an empty side reads as all 0
+  ask.volume = 2;
+  top_of_book_publish(&top, NULL, &ask);
+  quote = top_of_book_read(&top);
+  cr_assert_eq(quote.sequence, 4);
+  cr_assert_eq(quote.bid.price, 0);
+  cr_assert_eq(quote.bid.order_count, 0);
+  cr_assert_eq(quote.ask.volume, 2);
+}
+
+void* top_of_book_write(void* arg) {
+  for (uint64_t i = 1; i <= TOP_OF_BOOK_UPDATES; i++) {
+    struct limit bid = {.price = i, .volume = 2 * i, .order_count = 3 * i};
+    struct limit ask = {.price = i + 1, .volume = i, .order_count = 1};
+    top_of_book_publish(&top, &bid, &ask);
+  }
+  return NULL;
+}
+
+Test(top_of_book, concurrent_readers, .init = top_of_book_setup) {
+  pthread_t writer;
+  pthread_create(&writer, NULL, top_of_book_write, NULL);
+
+  // every read is of one whole update, and they only ever move forward
+  uint64_t last = 0;
+  while (last != 2 * TOP_OF_BOOK_UPDATES) {
+    struct top_of_book_quote quote = top_of_book_read(&top);
+    cr_assert(quote.sequence >= last);
+    cr_assert_eq(quote.sequence % 2, 0);
+    cr_assert_eq(quote.bid.price, quote.sequence / 2);
+    cr_assert_eq(quote.bid.volume, 2 * quote.bid.price);
+    cr_assert_eq(quote.bid.order_count, 3 * quote.bid.price);
+    if (quote.sequence != 0)
+      cr_assert_eq(quote.ask.price, quote.bid.price + 1);
+    last = quote.sequence;
+  }
+
+  pthread_join(writer, NULL);
+}
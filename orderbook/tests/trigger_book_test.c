@@ -0,0 +1,77 @@
+#include <criterion/criterion.h>
+
+#include "trigger_book.h"
+
+struct trigger_book book;
+
+void trigger_book_setup(void) {
+  book = trigger_book_new();
+}
+
+void trigger_book_teardown(void) {
+  trigger_book_free(&book);
+}
+
+void trigger_book_add_at(uint64_t order_id,
+                         enum side side,
+                         enum trigger_type type,
+                         uint64_t trigger_price) {
+  trigger_book_add(
+      &book, (struct trigger_order){.order = {.order_id = order_id,
+                                              .side = side,
+                                              .price = trigger_price,
+                                              .size = 1},
+                                    .type = type});
+}
+
+Test(trigger_book,
+     pop_in_crossing_order,
+     .init = trigger_book_setup,
+     .fini = trigger_book_teardown) {
+  // rising: buy stops and sell take profits, lowest first
+  trigger_book_add_at(1, SIDE_BID, TRIGGER_TYPE_STOP, 110);
+  trigger_book_add_at(2, SIDE_ASK, TRIGGER_TYPE_TAKE_PROFIT_LIMIT, 105);
+  trigger_book_add_at(3, SIDE_BID, TRIGGER_TYPE_STOP_LIMIT, 105);
+  // falling: sell stops and buy take profits, highest first
+  trigger_book_add_at(4, SIDE_ASK, TRIGGER_TYPE_STOP, 90);
+  trigger_book_add_at(5, SIDE_BID, TRIGGER_TYPE_TAKE_PROFIT, 95);
+  cr_assert_eq(book.size, 5);
+
+  struct trigger_order trigger;
+  cr_assert_not(trigger_book_pop(&book, 100, &trigger));
+
+  // oldest first at the same trigger price
+  cr_assert(trigger_book_pop(&book, 107, &trigger));
+  cr_assert_eq(trigger.order.order_id, 2);
+  cr_assert_eq(trigger.type, TRIGGER_TYPE_TAKE_PROFIT_LIMIT);
+  cr_assert(trigger_book_pop(&book, 107, &trigger));
+  cr_assert_eq(trigger.order.order_id, 3);
+  cr_assert_not(trigger_book_pop(&book, 107, &trigger));
+
+  cr_assert(trigger_book_pop(&book, 90, &trigger));
+  cr_assert_eq(trigger.order.order_id, 5);
+  cr_assert(trigger_book_pop(&book, 90, &trigger));
+  cr_assert_eq(trigger.order.order_id, 4);
+  cr_assert_not(trigger_book_pop(&book, 90, &trigger));
+  cr_assert_eq(book.size, 1);
+}
+
+Test(trigger_book,
+     remove,
+     .init = trigger_book_setup,
+     .fini = trigger_book_teardown) {
+  for (uint64_t id = 1; id <= 3; id++)
+    trigger_book_add_at(id, SIDE_ASK, TRIGGER_TYPE_STOP, 90);
+
+  struct trigger_order trigger;
+  cr_assert(trigger_book_remove(&book, 2, &trigger));
+  cr_assert_eq(trigger.order.order_id, 2);
+  cr_assert_not(trigger_book_remove(&book, 2, &trigger));
+  cr_assert_eq(book.falling.best->order_count, 2);
+  cr_assert_eq(book.falling.best->volume, 2);
+
+  cr_assert(trigger_book_remove(&book, 1, &trigger));
+  cr_assert(trigger_book_remove(&book, 3, &trigger));
+  cr_assert_eq(book.falling.best, NULL);
+  cr_assert_eq(book.size, 0);
+}
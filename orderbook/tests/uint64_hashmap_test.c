@@ -86,4 +86,38 @@ Test(uint64_hashmap, resize, .fini = uint64_hashmap_teardown) {
   uint64_hashmap_put(&map, 1002, &(struct limit){.price = 1002, .volume = 5});
   cr_assert_eq(map.size, 3);
   cr_assert_eq(map.capacity, 1 << 3);
-}
\ No newline at end of file
+}
+
+Test(uint64_hashmap, incremental_resize, .fini = uint64_hashmap_teardown) {
+  map = uint64_hashmap_incremental_with_capacity(64);
+  struct limit limits[1000];
+  for (int i = 0; i < 1000; i++)
+    limits[i] = (struct limit){.price = i};
+
+  for (int i = 0; i < 41; i++)
+    uint64_hashmap_put(&map, i, &limits[i]);
+  cr_assert_eq(map.capacity, 64);
+  cr_assert_eq(map.old_table, NULL);
+
+  // crossing the load factor starts a migration instead of rehashing
+  uint64_hashmap_put(&map, 41, &limits[41]);
+  cr_assert_eq(map.capacity, 128);
+  cr_assert_neq(map.old_table, NULL);
+  cr_assert_eq(map.size, 42);
+
+  // every key is reachable while the old table is being drained
+  for (int i = 0; i < 42; i++)
+    cr_assert_eq(uint64_hashmap_get(&map, i), &limits[i]);
+  cr_assert_eq(uint64_hashmap_remove(&map, 3), &limits[3]);
+  cr_assert_eq(uint64_hashmap_put(&map, 5, &limits[500]), &limits[5]);
+  cr_assert_eq(map.size, 41);
+
+  // each of those moved 32 buckets, which drained the old table
+  cr_assert_eq(map.old_table, NULL);
+  uint64_hashmap_put(&map, 42, &limits[42]);
+  cr_assert_eq(map.size, 42);
+  cr_assert_eq(uint64_hashmap_get(&map, 3), NULL);
+  cr_assert_eq(uint64_hashmap_get(&map, 5), &limits[500]);
+  for (int i = 6; i <= 42; i++)
+    cr_assert_eq(uint64_hashmap_get(&map, i), &limits[i]);
+}
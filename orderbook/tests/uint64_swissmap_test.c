@@ -0,0 +1,148 @@
+#include <criterion/criterion.h>
+
+#include <stdlib.h>
+
+#include "uint64_swissmap.h"
+
+struct uint64_swissmap swissmap;
+
+void uint64_swissmap_setup(void) {
+  swissmap = uint64_swissmap_new();
+}
+
+void uint64_swissmap_teardown(void) {
+  uint64_swissmap_free(&swissmap);
+}
+
+Test(uint64_swissmap,
+     put_get_remove,
+     .init = uint64_swissmap_setup,
+     .fini = uint64_swissmap_teardown) {
+  cr_assert_eq(swissmap.size, 0);
+
+  struct limit to_put = {.price = 1000, .volume = 5};
+  cr_assert_eq(uint64_swissmap_put(&swissmap, 1000, &to_put), NULL);
+  cr_assert_eq(swissmap.size, 1);
+
+  struct limit* got = uint64_swissmap_get(&swissmap, 1000);
+  cr_assert_eq(got, &to_put);
+  cr_assert_eq(uint64_swissmap_get(&swissmap, 1001), NULL);
+
+  // replacing returns the previous value
+  struct limit to_update = {.price = 1000, .volume = 10};
+  cr_assert_eq(uint64_swissmap_put(&swissmap, 1000, &to_update), &to_put);
+  cr_assert_eq(swissmap.size, 1);
+
+  cr_assert_eq(uint64_swissmap_remove(&swissmap, 1000), &to_update);
+  cr_assert_eq(uint64_swissmap_remove(&swissmap, 1000), NULL);
+  cr_assert_eq(uint64_swissmap_get(&swissmap, 1000), NULL);
+  cr_assert_eq(swissmap.size, 0);
+}
+
+Test(uint64_swissmap, resize, .fini = uint64_swissmap_teardown) {
+  swissmap = uint64_swissmap_with_capacity(1000);
+  uint32_t capacity = swissmap.capacity;
+  cr_assert_geq(capacity * UINT64_SWISSMAP_MAX_LOAD_FACTOR / 100, 1000);
+
+  // 1000 entries fit without a rehash
+  struct limit limit = {};
+  for (uint64_t key = 1; key <= 1000; key++)
+    uint64_swissmap_put(&swissmap, key, &limit);
+  cr_assert_eq(swissmap.capacity, capacity);
+
+  // but filling it up grows the table
+  for (uint64_t key = 1001; key <= capacity; key++)
+    uint64_swissmap_put(&swissmap, key, &limit);
+  cr_assert_eq(swissmap.capacity, capacity << 1);
+  cr_assert_eq(swissmap.size, capacity);
+  for (uint64_t key = 1; key <= capacity; key++)
+    cr_assert_eq(uint64_swissmap_get(&swissmap, key), &limit);
+}
+
+Test(uint64_swissmap,
+     churn,
+     .init = uint64_swissmap_setup,
+     .fini = uint64_swissmap_teardown) {
+  const int range = 5000;
+  uint64_t* expected = calloc(range, sizeof(uint64_t));
+  srand(3);
+
+  // orders come and go, the map must agree with a plain array throughout
+  for (int round = 0; round < 200'000; round++) {
+    uint64_t key = rand() % range;
+    if (expected[key] != 0 && rand() % 2 == 0) {
+      cr_assert_eq(uint64_swissmap_remove(&swissmap, key),
+                   (void*)expected[key]);
+      expected[key] = 0;
+    } else {
+      uint64_t value = round + 1;
+      cr_assert_eq(uint64_swissmap_put(&swissmap, key, (void*)value),
+                   (void*)expected[key]);
+      expected[key] = value;
+    }
+  }
+
+  uint32_t size = 0;
+  for (uint64_t key = 0; key < range; key++) {
+    cr_assert_eq(uint64_swissmap_get(&swissmap, key), (void*)expected[key]);
+    size += expected[key] != 0;
+  }
+  cr_assert_eq(swissmap.size, size);
+
+  // the churn never needed more than twice the live entries
+  cr_assert_leq(swissmap.capacity, 4 * range);
+
+  free(expected);
+}
+
+Test(uint64_swissmap, incremental_resize, .fini = uint64_swissmap_teardown) {
+  swissmap = uint64_swissmap_incremental_with_capacity(1000);
+  uint32_t capacity = swissmap.capacity;
+  uint64_t n = capacity * UINT64_SWISSMAP_MAX_LOAD_FACTOR / 100 + 1;
+
+  for (uint64_t key = 1; key <= n; key++)
+    uint64_swissmap_put(&swissmap, key, (void*)key);
+
+  // going past the load factor started a migration instead of rehashing
+  cr_assert_eq(swissmap.capacity, capacity << 1);
+  cr_assert_neq(swissmap.old, NULL);
+  cr_assert_eq(swissmap.size, n);
+
+  // every key is reachable while the old table is being drained
+  for (uint64_t key = 1; key <= n; key++)
+    cr_assert_eq(uint64_swissmap_get(&swissmap, key), (void*)key);
+  cr_assert_eq(uint64_swissmap_remove(&swissmap, 1), (void*)1);
+  cr_assert_eq(uint64_swissmap_put(&swissmap, 2, (void*)3), (void*)2);
+  cr_assert_eq(swissmap.size, n - 1);
+
+  // each put or remove moves a few slots, so the old table drains
+  for (uint64_t key = n + 1; swissmap.old != NULL; key++)
+    uint64_swissmap_put(&swissmap, key, (void*)key);
+  cr_assert_eq(uint64_swissmap_get(&swissmap, 1), NULL);
+  cr_assert_eq(uint64_swissmap_get(&swissmap, 2), (void*)3);
+  for (uint64_t key = 3; key <= n; key++)
+    cr_assert_eq(uint64_swissmap_get(&swissmap, key), (void*)key);
+}
+
+Test(uint64_swissmap, with_memory, .fini = uint64_swissmap_teardown) {
+  size_t bytes = uint64_swissmap_memory_size(100);
+  struct uint64_swissmap_slot* memory = malloc(bytes);
+  swissmap = uint64_swissmap_with_memory(100, memory);
+  uint32_t capacity = swissmap.capacity;
+  cr_assert_geq(capacity * UINT64_SWISSMAP_MAX_LOAD_FACTOR / 100, 100);
+  cr_assert_eq(swissmap.slots, memory);
+
+  struct limit limit = {};
+  for (uint64_t key = 1; key <= 100; key++)
+    uint64_swissmap_put(&swissmap, key, &limit);
+  cr_assert(swissmap.borrowed);
+
+  // outgrowing it moves the entries to a table of its own
+  for (uint64_t key = 101; key <= capacity; key++)
+    uint64_swissmap_put(&swissmap, key, &limit);
+  cr_assert_not(swissmap.borrowed);
+  cr_assert_eq(swissmap.capacity, capacity << 1);
+  for (uint64_t key = 1; key <= 100; key++)
+    cr_assert_eq(uint64_swissmap_get(&swissmap, key), &limit);
+  free(memory);
+}